@@ -0,0 +1,104 @@
+/*
+BLIND SOLVER BENCHMARK
+
+Cuts a picture into rows x cols tiles, shuffles them and reassembles them from their pixels alone with every edge
+kernel the CPU supports. Reports the time spent extracting strips, filling the dissimilarity matrices and laying
+out the grid, and how many tiles ended up in the right cell or next to the right neighbours.
+
+usage: blind_bench <picture> [rows] [cols] [threads] [seed]
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "blind_solver.h"
+#include "job_system.h"
+#include "scramble.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cout << "usage: blind_bench <picture> [rows] [cols] [threads] [seed]" << std::endl;
+        return -1;
+    }
+    unsigned int rows = argc > 2 ? std::atoi(argv[2]) : 10;
+    unsigned int cols = argc > 3 ? std::atoi(argv[3]) : rows;
+    unsigned int threads = argc > 4 ? std::atoi(argv[4]) : 0;
+    if (threads != 0) {
+        startJobSystem(threads - 1); // the main thread works while it waits
+    }
+    uint64_t seed = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 1;
+
+    int width, height, nrChannels;
+    unsigned char* image = stbi_load(argv[1], &width, &height, &nrChannels, STBI_rgb_alpha);
+    if (image == nullptr) {
+        std::cout << "[ERROR] could not decode " << argv[1] << ": " << stbi_failure_reason() << std::endl;
+        return -1;
+    }
+    if (rows == 0 || cols == 0 || (unsigned int)width < 2 * cols || (unsigned int)height < 2 * rows) {
+        std::cout << "[ERROR] cannot cut a " << width << "x" << height << " picture into " << rows << "x" << cols
+                  << " tiles" << std::endl;
+        stbi_image_free(image);
+        return -1;
+    }
+
+    // tile order is shuffled so the solver cannot lean on it
+    unsigned int n = rows * cols;
+    std::vector<unsigned int> cellOf(n);
+    for (unsigned int i = 0; i < n; ++i) {
+        cellOf[i] = i;
+    }
+    Rng rng(seed);
+    for (unsigned int i = n - 1; i > 0; --i) {
+        std::swap(cellOf[i], cellOf[rng.below(i + 1)]);
+    }
+    std::vector<BlindTile> tiles(n);
+    for (unsigned int i = 0; i < n; ++i) {
+        unsigned int c = cellOf[i] % cols, r = cellOf[i] / cols;
+        BlindTile t = { c * width / cols, r * height / rows, (c + 1) * width / cols - c * width / cols,
+                        (r + 1) * height / rows - r * height / rows };
+        tiles[i] = t;
+    }
+
+    std::cout << argv[1] << " (" << width << "x" << height << ") as " << rows << "x" << cols << " tiles" << std::endl;
+    int result = 0;
+    for (int k = EDGE_KERNEL_SCALAR; k <= bestEdgeKernel(); ++k) {
+        std::vector<glm::ivec2> cells;
+        BlindSolveStats stats;
+        if (!blindSolve(image, width, height, tiles, rows, cols, cells, &stats, (EdgeKernel)k)) {
+            std::cout << "[ERROR] blind solve failed" << std::endl;
+            result = -1;
+            break;
+        }
+
+        // direct: tile in its own cell; neighbour: the tile right of / below it in the result is its true neighbour
+        std::vector<int> at(n);
+        unsigned int direct = 0, pairs = 0, goodPairs = 0;
+        for (unsigned int i = 0; i < n; ++i) {
+            at[cells[i].y * cols + cells[i].x] = i;
+            direct += (unsigned int)(cells[i].y * cols + cells[i].x) == cellOf[i];
+        }
+        for (unsigned int cell = 0; cell < n; ++cell) {
+            unsigned int a = at[cell];
+            if (cell % cols + 1 < cols) {
+                pairs++;
+                goodPairs += cellOf[at[cell + 1]] == cellOf[a] + 1 && cellOf[a] % cols + 1 < cols;
+            }
+            if (cell / cols + 1 < rows) {
+                pairs++;
+                goodPairs += cellOf[at[cell + cols]] == cellOf[a] + cols;
+            }
+        }
+        double total = stats.extractSeconds + stats.compareSeconds + stats.layoutSeconds;
+        std::cout << edgeKernelName(stats.kernel) << ": " << total * 1000 << "ms (strips " << stats.extractSeconds * 1000
+                  << "ms, " << stats.comparisons << " comparisons " << stats.compareSeconds * 1000 << "ms = "
+                  << stats.comparisons / stats.compareSeconds / 1e6 << "M/s, layout " << stats.layoutSeconds * 1000
+                  << "ms), direct " << 100.0 * direct / n << "%, neighbours " << (pairs ? 100.0 * goodPairs / pairs : 100.0)
+                  << "%" << std::endl;
+    }
+    stbi_image_free(image);
+    return result;
+}
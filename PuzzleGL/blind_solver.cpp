@@ -0,0 +1,354 @@
+#include "blind_solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PUZZLEGL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PUZZLEGL_TARGET(isa)
+#else
+#define PUZZLEGL_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+#include "job_system.h"
+
+namespace sc = std::chrono;
+
+namespace {
+
+const unsigned int MAX_STRIP_LENGTH = 128; // border samples; longer borders are subsampled
+const unsigned int STRIP_ALIGN = 32;       // strips are zero padded to whole AVX2 registers
+const unsigned int CANDIDATES = 3;         // best partners per tile and side that enter the greedy layout
+const unsigned int ROWS_PER_TASK = 16;
+
+typedef uint32_t (*SadFn)(const uint8_t* a, const uint8_t* b, size_t bytes);
+
+uint32_t sadScalar(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    }
+    return sum;
+}
+
+#ifdef PUZZLEGL_X86
+PUZZLEGL_TARGET("sse2")
+uint32_t sadSse2(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    __m128i sum = _mm_setzero_si128();
+    for (size_t i = 0; i < bytes; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+    }
+    return (uint32_t)(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+}
+
+PUZZLEGL_TARGET("avx2")
+uint32_t sadAvx2(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    __m256i sum = _mm256_setzero_si256();
+    for (size_t i = 0; i < bytes; i += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(va, vb));
+    }
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    return (uint32_t)(_mm_cvtsi128_si32(half) + _mm_cvtsi128_si32(_mm_srli_si128(half, 8)));
+}
+#endif
+
+SadFn sadFunction(EdgeKernel kernel) {
+#ifdef PUZZLEGL_X86
+    if (kernel == EDGE_KERNEL_AVX2) return sadAvx2;
+    if (kernel == EDGE_KERNEL_SSE2) return sadSse2;
+#endif
+    return sadScalar;
+}
+
+inline uint8_t predict(uint8_t border, uint8_t inner) {
+    int p = 2 * (int)border - (int)inner;
+    return (uint8_t)std::min(std::max(p, 0), 255);
+}
+
+// samples one border of a tile: `length` pixels starting at (x,y) stepping along (stepX,stepY) across the border,
+// with the inner neighbour of each one (dx,dy) further into the tile. out gets [prediction | border] or
+// [border | prediction] depending on predictionFirst
+void sampleBorder(const unsigned char* rgba, unsigned int width, unsigned int x, unsigned int y, unsigned int span,
+                  bool vertical, int inward, unsigned int length, bool predictionFirst, uint8_t* out) {
+    uint8_t* pred = predictionFirst ? out : out + 3 * length;
+    uint8_t* edge = predictionFirst ? out + 3 * length : out;
+    for (unsigned int i = 0; i < length; ++i) {
+        unsigned int along = length > 1 ? (unsigned int)((uint64_t)i * (span - 1) / (length - 1)) : 0;
+        unsigned int bx = vertical ? x : x + along;
+        unsigned int by = vertical ? y + along : y;
+        const unsigned char* b = rgba + ((size_t)by * width + bx) * 4;
+        const unsigned char* in = vertical ? b + inward * 4 : b + (ptrdiff_t)inward * width * 4;
+        for (int c = 0; c < 3; ++c) {
+            edge[3 * i + c] = b[c];
+            pred[3 * i + c] = predict(b[c], in[c]);
+        }
+    }
+}
+
+struct Candidate {
+    float weight;
+    int a, b;  // b right of / below a
+    int dir;   // 0: left-right, 1: top-bottom
+    bool operator<(const Candidate& o) const { return weight < o.weight; }
+};
+
+// second smallest of each row and of each column (the runner-up a match is measured against)
+void runnersUp(const std::vector<uint32_t>& d, unsigned int n, std::vector<uint32_t>& rowSecond,
+               std::vector<uint32_t>& colSecond) {
+    const uint32_t inf = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> rowFirst(n, inf), colFirst(n, inf);
+    rowSecond.assign(n, inf);
+    colSecond.assign(n, inf);
+    for (unsigned int a = 0; a < n; ++a) {
+        for (unsigned int b = 0; b < n; ++b) {
+            uint32_t v = d[(size_t)a * n + b];
+            if (v < rowFirst[a]) { rowSecond[a] = rowFirst[a]; rowFirst[a] = v; }
+            else if (v < rowSecond[a]) { rowSecond[a] = v; }
+            if (v < colFirst[b]) { colSecond[b] = colFirst[b]; colFirst[b] = v; }
+            else if (v < colSecond[b]) { colSecond[b] = v; }
+        }
+    }
+}
+
+void addCandidates(const std::vector<uint32_t>& d, unsigned int n, int dir, std::vector<Candidate>& out) {
+    std::vector<uint32_t> rowSecond, colSecond;
+    runnersUp(d, n, rowSecond, colSecond);
+    unsigned int k = std::min(CANDIDATES, n - 1);
+    std::vector<int> order(n);
+    auto weigh = [&](int a, int b) {
+        float v = (float)d[(size_t)a * n + b];
+        Candidate c = { v / (rowSecond[a] + 1.0f) + v / (colSecond[b] + 1.0f), a, b, dir };
+        out.push_back(c);
+    };
+    for (unsigned int a = 0; a < n; ++a) {
+        for (unsigned int b = 0; b < n; ++b) order[b] = b;
+        std::partial_sort(order.begin(), order.begin() + k + 1, order.end(),
+                          [&](int l, int r) { return d[(size_t)a * n + l] < d[(size_t)a * n + r]; });
+        for (unsigned int i = 0; i <= k; ++i) if (order[i] != (int)a) weigh(a, order[i]);
+    }
+    for (unsigned int b = 0; b < n; ++b) {
+        for (unsigned int a = 0; a < n; ++a) order[a] = a;
+        std::partial_sort(order.begin(), order.begin() + k + 1, order.end(),
+                          [&](int l, int r) { return d[(size_t)l * n + b] < d[(size_t)r * n + b]; });
+        for (unsigned int i = 0; i <= k; ++i) if (order[i] != (int)b) weigh(order[i], b);
+    }
+}
+
+inline uint64_t cellKey(int cluster, glm::ivec2 cell) {
+    const int bias = 1 << 19;
+    return ((uint64_t)cluster << 40) | ((uint64_t)(cell.x + bias) << 20) | (uint64_t)(cell.y + bias);
+}
+
+} // namespace
+
+EdgeKernel bestEdgeKernel() {
+#ifdef PUZZLEGL_X86
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    if (maxLeaf >= 7 && osSavesYmm) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) return EDGE_KERNEL_AVX2;
+    }
+    return EDGE_KERNEL_SSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return EDGE_KERNEL_AVX2;
+    if (__builtin_cpu_supports("sse2")) return EDGE_KERNEL_SSE2;
+#endif
+#endif
+    return EDGE_KERNEL_SCALAR;
+}
+
+const char* edgeKernelName(EdgeKernel kernel) {
+    switch (kernel) {
+        case EDGE_KERNEL_SCALAR: return "scalar";
+        case EDGE_KERNEL_SSE2: return "sse2";
+        case EDGE_KERNEL_AVX2: return "avx2";
+        default: return "unknown";
+    }
+}
+
+bool blindSolve(const unsigned char* rgba, unsigned int width, unsigned int height, const std::vector<BlindTile>& tiles,
+                unsigned int rows, unsigned int cols, std::vector<glm::ivec2>& cells, BlindSolveStats* stats,
+                EdgeKernel kernel) {
+    unsigned int n = tiles.size();
+    if (rgba == nullptr || n == 0 || n != rows * cols || kernel > bestEdgeKernel()) {
+        return false;
+    }
+    unsigned int minW = ~0u, minH = ~0u;
+    for (auto& t : tiles) {
+        if (t.width < 2 || t.height < 2 || t.x + t.width > width || t.y + t.height > height) {
+            return false;
+        }
+        minW = std::min(minW, t.width);
+        minH = std::min(minH, t.height);
+    }
+    SadFn sad = sadFunction(kernel);
+    auto start = sc::high_resolution_clock::now();
+
+    // border strips: lr for left/right borders (sampled down the tile), tb for top/bottom ones
+    unsigned int lenLR = std::min(minH, MAX_STRIP_LENGTH), lenTB = std::min(minW, MAX_STRIP_LENGTH);
+    size_t strideLR = (6 * lenLR + STRIP_ALIGN - 1) / STRIP_ALIGN * STRIP_ALIGN;
+    size_t strideTB = (6 * lenTB + STRIP_ALIGN - 1) / STRIP_ALIGN * STRIP_ALIGN;
+    std::vector<uint8_t> rightX(n * strideLR, 0), leftY(n * strideLR, 0), bottomX(n * strideTB, 0), topY(n * strideTB, 0);
+    parallelFor("blind strips", n, ROWS_PER_TASK, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            const BlindTile& t = tiles[i];
+            sampleBorder(rgba, width, t.x + t.width - 1, t.y, t.height, true, -1, lenLR, true, &rightX[i * strideLR]);
+            sampleBorder(rgba, width, t.x, t.y, t.height, true, 1, lenLR, false, &leftY[i * strideLR]);
+            sampleBorder(rgba, width, t.x, t.y + t.height - 1, t.width, false, -1, lenTB, true, &bottomX[i * strideTB]);
+            sampleBorder(rgba, width, t.x, t.y, t.width, false, 1, lenTB, false, &topY[i * strideTB]);
+        }
+    });
+    auto extracted = sc::high_resolution_clock::now();
+
+    // all pairs: dLR[a*n+b] is the cost of b right of a, dTB[a*n+b] of b below a
+    const uint32_t inf = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> dLR((size_t)n * n), dTB((size_t)n * n);
+    parallelFor("blind compare", n, ROWS_PER_TASK, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int a = begin; a < end; ++a) {
+            const uint8_t* ra = &rightX[a * strideLR];
+            const uint8_t* ba = &bottomX[a * strideTB];
+            for (unsigned int b = 0; b < n; ++b) {
+                dLR[(size_t)a * n + b] = a == b ? inf : sad(ra, &leftY[b * strideLR], strideLR);
+                dTB[(size_t)a * n + b] = a == b ? inf : sad(ba, &topY[b * strideTB], strideTB);
+            }
+        }
+    });
+    auto compared = sc::high_resolution_clock::now();
+
+    // greedy clustering from the most confident pairs down
+    std::vector<Candidate> candidates;
+    if (n > 1) {
+        addCandidates(dLR, n, 0, candidates);
+        addCandidates(dTB, n, 1, candidates);
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    std::vector<int> clusterOf(n);
+    std::vector<glm::ivec2> pos(n, glm::ivec2(0));
+    std::vector<std::vector<int> > members(n);
+    std::vector<glm::ivec2> lo(n, glm::ivec2(0)), hi(n, glm::ivec2(0));
+    std::unordered_map<uint64_t, int> owner;
+    for (unsigned int i = 0; i < n; ++i) {
+        clusterOf[i] = i;
+        members[i].push_back(i);
+        owner[cellKey(i, glm::ivec2(0))] = i;
+    }
+    for (auto& c : candidates) {
+        int ca = clusterOf[c.a], cb = clusterOf[c.b];
+        if (ca == cb) {
+            continue;
+        }
+        glm::ivec2 step = c.dir == 0 ? glm::ivec2(1, 0) : glm::ivec2(0, 1);
+        glm::ivec2 shift = pos[c.a] + step - pos[c.b]; // moves cluster b into cluster a's frame
+        int big = ca, small = cb;
+        if (members[cb].size() > members[ca].size()) {
+            big = cb;
+            small = ca;
+            shift = -shift;
+        }
+        glm::ivec2 mergedLo = glm::min(lo[big], lo[small] + shift), mergedHi = glm::max(hi[big], hi[small] + shift);
+        if (mergedHi.x - mergedLo.x >= (int)cols || mergedHi.y - mergedLo.y >= (int)rows) {
+            continue;
+        }
+        bool collides = false;
+        for (int m : members[small]) {
+            if (owner.count(cellKey(big, pos[m] + shift))) {
+                collides = true;
+                break;
+            }
+        }
+        if (collides) {
+            continue;
+        }
+        for (int m : members[small]) {
+            owner.erase(cellKey(small, pos[m]));
+            pos[m] += shift;
+            owner[cellKey(big, pos[m])] = m;
+            clusterOf[m] = big;
+            members[big].push_back(m);
+        }
+        members[small].clear();
+        lo[big] = mergedLo;
+        hi[big] = mergedHi;
+    }
+
+    // the largest cluster anchors the grid; everything else fills in around it
+    int largest = 0;
+    for (unsigned int c = 0; c < n; ++c) {
+        if (members[c].size() > members[largest].size()) largest = c;
+    }
+    std::vector<int> grid(n, -1);
+    std::vector<bool> placed(n, false);
+    cells.assign(n, glm::ivec2(0));
+    for (int m : members[largest]) {
+        glm::ivec2 cell = pos[m] - lo[largest];
+        grid[cell.y * cols + cell.x] = m;
+        cells[m] = cell;
+        placed[m] = true;
+    }
+    unsigned int remaining = n - members[largest].size();
+    while (remaining > 0) {
+        // the empty cell with the most placed neighbours
+        int bestCell = -1, bestCount = -1;
+        for (unsigned int cell = 0; cell < n; ++cell) {
+            if (grid[cell] >= 0) continue;
+            unsigned int x = cell % cols, y = cell / cols;
+            int count = (x > 0 && grid[cell - 1] >= 0) + (x + 1 < cols && grid[cell + 1] >= 0) +
+                        (y > 0 && grid[cell - cols] >= 0) + (y + 1 < rows && grid[cell + cols] >= 0);
+            if (count > bestCount) {
+                bestCount = count;
+                bestCell = cell;
+            }
+        }
+        unsigned int x = bestCell % cols, y = bestCell / cols;
+        int left = x > 0 ? grid[bestCell - 1] : -1, right = x + 1 < cols ? grid[bestCell + 1] : -1;
+        int up = y > 0 ? grid[bestCell - cols] : -1, down = y + 1 < rows ? grid[bestCell + cols] : -1;
+        // the unplaced tile that fits them best
+        int bestTile = -1;
+        uint64_t bestCost = ~(uint64_t)0;
+        for (unsigned int t = 0; t < n; ++t) {
+            if (placed[t]) continue;
+            uint64_t cost = 0;
+            if (left >= 0) cost += dLR[(size_t)left * n + t];
+            if (right >= 0) cost += dLR[(size_t)t * n + right];
+            if (up >= 0) cost += dTB[(size_t)up * n + t];
+            if (down >= 0) cost += dTB[(size_t)t * n + down];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestTile = t;
+            }
+        }
+        grid[bestCell] = bestTile;
+        cells[bestTile] = glm::ivec2(x, y);
+        placed[bestTile] = true;
+        remaining--;
+    }
+    auto laidOut = sc::high_resolution_clock::now();
+
+    if (stats != nullptr) {
+        stats->kernel = kernel;
+        stats->stripLength = std::max(lenLR, lenTB);
+        stats->comparisons = 2ull * n * (n - 1);
+        stats->extractSeconds = sc::duration<double>(extracted - start).count();
+        stats->compareSeconds = sc::duration<double>(compared - extracted).count();
+        stats->layoutSeconds = sc::duration<double>(laidOut - compared).count();
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+/*
+BLIND SOLVER
+
+Reassembles the picture from shuffled tiles using only their pixels, without the topology. Every tile border is
+sampled into a fixed-length RGB strip together with a prediction of the next pixel row beyond it (extrapolated
+from the last two rows), so two tiles fit when each one's prediction matches the other's border:
+
+    D_LR(a,b) = SAD(predicted right of a, left border of b) + SAD(right border of a, predicted left of b)
+
+and the same for top/bottom. Strips are stored as [prediction | border] and [border | prediction] byte vectors,
+so a whole dissimilarity is a single sum of absolute differences over two vectors, computed with psadbw (SSE2)
+or vpsadbw (AVX2) as the CPU allows. Both all-pairs matrices (O(n^2) comparisons) are split by rows over the job system.
+
+The layout is built greedily: candidate pairs are taken from the most confident down (dissimilarity relative to
+the runner-up, from both tiles' points of view) and merge clusters of tiles when they do not collide and still
+fit in rows x cols; tiles left over fill the remaining cells next to the most placed neighbours first.
+ */
+#ifndef PUZZLEGL_BLIND_SOLVER_H
+#define PUZZLEGL_BLIND_SOLVER_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+enum EdgeKernel {
+    EDGE_KERNEL_SCALAR = 0,
+    EDGE_KERNEL_SSE2 = 1,
+    EDGE_KERNEL_AVX2 = 2
+};
+
+// the widest kernel this CPU runs
+EdgeKernel bestEdgeKernel();
+const char* edgeKernelName(EdgeKernel kernel);
+
+// a tile's pixel rectangle in the picture
+struct BlindTile {
+    unsigned int x, y, width, height;
+};
+
+struct BlindSolveStats {
+    EdgeKernel kernel;
+    unsigned int stripLength;       // samples per border
+    unsigned long long comparisons; // dissimilarities computed
+    double extractSeconds;
+    double compareSeconds;
+    double layoutSeconds;
+};
+
+// cells[i] is the (column, row) the solver puts tiles[i] in; tiles are about equally sized, at least 2x2 pixels
+bool blindSolve(const unsigned char* rgba, unsigned int width, unsigned int height, const std::vector<BlindTile>& tiles,
+                unsigned int rows, unsigned int cols, std::vector<glm::ivec2>& cells, BlindSolveStats* stats = nullptr,
+                EdgeKernel kernel = bestEdgeKernel());
+
+#endif //PUZZLEGL_BLIND_SOLVER_H
@@ -0,0 +1,767 @@
+#include "board.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+static const float TWO_PI = 6.28318530718f;
+
+static bool compare_pieces (const PuzzlePiece* lhs, const PuzzlePiece* rhs) { // comparison operator for set ordering
+    return lhs->z < rhs->z;
+}
+
+// a world point relative to the piece, in its unturned frame
+static glm::vec2 toPiece(const PuzzlePiece* p, float x, float y) {
+    glm::vec2 local(x - p->x, y - p->y);
+    return p->angle == 0 ? local : rotated(local, -p->angle);
+}
+
+float angleBetween(float a, float b) {
+    float d = std::fmod(b - a, TWO_PI);
+    if (d > TWO_PI / 2) {
+        d -= TWO_PI;
+    } else if (d < -TWO_PI / 2) {
+        d += TWO_PI;
+    }
+    return d;
+}
+
+Board::Board()
+    : numRows(0), numCols(0), width(2.0f), height(2.0f), extent(1.0f),
+      pushApart(false), maxInradius(0.0f), nextSettling(0) {
+    for (auto& pointer : pointers) {
+        pointer.held = nullptr;
+        pointer.grab = glm::vec2(0.0f);
+    }
+}
+
+Board::~Board() {
+    clear();
+}
+
+void Board::clear() {
+    letGo();
+    for (auto p : pieces) {
+        delete p;
+    }
+    pieces.clear();
+    byId.clear();
+    hints.reset(0);
+    moved.clear();
+    movedIds.clear();
+    unsaved.clear();
+    unsavedIds.clear();
+    awake.clear();
+    awakeIds.clear();
+    settling.clear();
+    nextSettling = 0;
+    glide.reset(0);
+    sorting.clear();
+    traySlot.clear();
+    holders.clear();
+}
+
+void Board::setup(unsigned int rows, unsigned int cols, TopologyKind cut) { //cut the board into puzzle pieces
+    clear();
+    numRows = rows;
+    numCols = cols;
+    buildTopology(cut, rows, cols, VORONOI_CUT_SEED, topo);
+    unsigned int numPieces = topo.count();
+    glm::vec2 size = topo.maxPieceSize(); //the board is [-1,1] on both axes
+    width = size.x;
+    height = size.y;
+    extent = numPieces > LARGE_BOARD_PIECES ? LARGE_BOARD_TABLE_SCALE : 1.0f;
+    // cells one piece in size keep a piece's overlaps within the neighbouring cells
+    grid.reset(-extent, -extent, extent, extent, width, height, numPieces);
+    hints.reset(topo.edges());
+    moved.assign(numPieces, 0);
+    unsaved.assign(numPieces, 0);
+    awake.assign(numPieces, 0);
+    glide.reset(numPieces);
+    sorting.assign(numPieces, 0);
+    traySlot.resize(numPieces);
+    holders.assign(numPieces, -1);
+    maxInradius = *std::max_element(topo.inradius.begin(), topo.inradius.end());
+
+    // pieces in reading order (left -> right, top -> bottom)
+    for (unsigned int i = 0; i < numPieces; ++i) {
+        auto p = new PuzzlePiece;
+        p->id = i;
+        glm::vec2 home = homePosition(i);
+        p->x = home.x;
+        p->y = home.y;
+        p->z = i;
+        p->tx = (home.x + topo.boundsMin[i].x + 1) / 2;
+        p->ty = (1 - (home.y + topo.boundsMax[i].y)) / 2;
+        pieces.push_back(p);
+        byId.push_back(p);
+        place(p);
+    }
+}
+
+void Board::scramble(ScrambleMode mode, uint64_t seed, RotationMode rotation) {
+    ScrambleParams params;
+    params.count = count();
+    // turned pieces need room for every way they may be turned
+    float turned = rotation == ROTATION_QUARTER ? std::max(width, height)
+                   : rotation == ROTATION_FREE ? std::sqrt(width * width + height * height) : 0.0f;
+    params.pieceWidth = std::max(width, turned);
+    params.pieceHeight = std::max(height, turned);
+    params.tableExtent = extent;
+    params.edge.resize(count());
+    for (auto p : byId) {
+        params.edge[p->id] = topo.border[p->id];
+    }
+
+    std::vector<glm::vec2> centers;
+    scrambleLayout(mode, seed, params, centers);
+    std::vector<float> angles;
+    scrambleAngles(rotation, seed, count(), angles);
+
+    letGo();
+    glide.reset(count());
+    sorting.assign(count(), 0);
+    for (auto p : pieces) {
+        p->x = centers[p->id].x;
+        p->y = centers[p->id].y;
+        p->angle = angles[p->id];
+        p->group.clear(); //ungroup all pieces
+        place(p);
+    }
+    if (pushApart) {
+        for (auto p : byId) {
+            wake(p);
+        }
+    }
+}
+
+void Board::arrange(const std::vector<glm::vec2>& centers) {
+    letGo();
+    glide.reset(count());
+    sorting.assign(count(), 0);
+    for (auto p : pieces) {
+        p->x = centers[p->id].x;
+        p->y = centers[p->id].y;
+        p->angle = 0;
+        p->group.clear();
+        place(p);
+    }
+    for (auto p : byId) {
+        moveGroup(p);
+        drop(p);
+    }
+}
+
+void Board::capture(BoardSnapshot& snapshot, std::vector<unsigned int>* changed) {
+    unsigned int n = count();
+    snapshot.rows = numRows;
+    snapshot.cols = numCols;
+    snapshot.topology = topo.kind;
+    if (snapshot.x.size() != n) {
+        snapshot.x.resize(n);
+        snapshot.y.resize(n);
+        snapshot.z.resize(n);
+        snapshot.angle.resize(n);
+        snapshot.component.resize(n);
+        unsavedIds.clear();
+        for (auto p : byId) {
+            unsaved[p->id] = 1;
+            unsavedIds.push_back(p->id);
+        }
+    }
+    for (auto& pointer : pointers) {
+        if (pointer.held != nullptr) {
+            // a held group is saved where it is being held
+            moveGroup(pointer.held);
+            markUnsaved(pointer.held);
+            for (auto g : pointer.held->group) {
+                markUnsaved(g.first);
+            }
+        }
+    }
+    for (auto id : unsavedIds) {
+        PuzzlePiece* p = byId[id];
+        unsaved[id] = 0;
+        snapshot.x[id] = p->x;
+        snapshot.y[id] = p->y;
+        snapshot.z[id] = p->z;
+        snapshot.angle[id] = p->angle;
+        // groups are complete and ordered by address, so every member agrees on the lowest address among them
+        PuzzlePiece* label = p;
+        if (!p->group.empty() && std::less<PuzzlePiece*>()(p->group.begin()->first, p)) {
+            label = p->group.begin()->first;
+        }
+        snapshot.component[id] = label->id;
+    }
+    if (changed != nullptr) {
+        changed->insert(changed->end(), unsavedIds.begin(), unsavedIds.end());
+    }
+    unsavedIds.clear();
+}
+
+bool Board::restore(const BoardSnapshot& snapshot) {
+    unsigned int n = count();
+    if (snapshot.rows != numRows || snapshot.cols != numCols || snapshot.topology != (uint32_t)topo.kind
+        || snapshot.x.size() != n || snapshot.y.size() != n || snapshot.z.size() != n || snapshot.angle.size() != n
+        || snapshot.component.size() != n) {
+        return false;
+    }
+    for (auto c : snapshot.component) {
+        if (c >= n) {
+            return false;
+        }
+    }
+    letGo();
+    glide.reset(n);
+    sorting.assign(n, 0);
+    std::vector<std::vector<PuzzlePiece*> > members(n);
+    for (auto p : byId) {
+        p->x = snapshot.x[p->id];
+        p->y = snapshot.y[p->id];
+        p->z = snapshot.z[p->id];
+        p->angle = snapshot.angle[p->id];
+        p->group.clear();
+        members[snapshot.component[p->id]].push_back(p);
+        place(p);
+    }
+    for (auto& group : members) {
+        for (size_t i = 0; i < group.size(); ++i) {
+            for (size_t j = i + 1; j < group.size(); ++j) {
+                addToGroup(group[i], group[j]);
+            }
+        }
+    }
+    std::sort(pieces.begin(), pieces.end(), compare_pieces);
+    return true;
+}
+
+void Board::mirror(const std::vector<PieceState>& states) {
+    // every pose first: joining groups takes the members' offsets from where they lie
+    bool raised = false;
+    for (auto& s : states) {
+        PuzzlePiece* p = piece(s.id);
+        if (p != nullptr) {
+            raised |= p->z != s.z;
+            p->x = s.x;
+            p->y = s.y;
+            p->z = s.z;
+            p->angle = s.angle;
+            place(p);
+        }
+    }
+    for (auto& s : states) {
+        PuzzlePiece* p = piece(s.id);
+        PuzzlePiece* label = piece(s.component);
+        if (p == nullptr || label == nullptr || label == p || p->group.count(label)) {
+            continue;
+        }
+        std::vector<PuzzlePiece*> ownSide(1, p), otherSide(1, label);
+        for (auto g : p->group) {
+            ownSide.push_back(g.first);
+        }
+        for (auto g : label->group) {
+            otherSide.push_back(g.first);
+        }
+        for (auto p1 : ownSide) {
+            for (auto p2 : otherSide) {
+                addToGroup(p1, p2);
+            }
+        }
+    }
+    if (raised) {
+        std::sort(pieces.begin(), pieces.end(), compare_pieces);
+    }
+}
+
+PuzzlePiece* Board::pick(float x, float y) const {
+    // only pieces bucketed around the point can be under it (however they are turned); take the highest Z one
+    PuzzlePiece* hit = nullptr;
+    float reach = std::max(width, height);
+    nearby.clear();
+    grid.query(x - reach, y - reach, x + reach, y + reach, nearby);
+    for (auto id : nearby) {
+        PuzzlePiece* p = byId[id];
+        if (topo.contains(id, toPiece(p, x, y))) {
+            if (hit == nullptr || p->z > hit->z) {
+                hit = p;
+            }
+        }
+    }
+    return hit;
+}
+
+bool Board::press(float x, float y, unsigned int pointer) {
+    if (pointer >= MAX_POINTERS) {
+        return false;
+    }
+    release(glm::vec2(0.0f), pointer); // a press the pointer's release went missing for drops what it still held
+    PuzzlePiece* hit = pick(x, y);
+    if (hit == nullptr || held(hit)) {
+        return false; // the group stays with the pointer that grabbed it first
+    }
+    Pointer& grabbing = pointers[pointer];
+    grabbing.held = hit;
+    grabbing.grab = glm::vec2(x - hit->x, y - hit->y);
+    hold(hit, pointer);
+    // catching a thrown group (or a piece on its way to a tray) stops it
+    glide.remove(hit->id);
+    sorting[hit->id] = 0;
+    for (auto p : hit->group) {
+        glide.remove(p.first->id);
+    }
+
+    // reorder draw order of pieces
+    float top = pieces.back()->z + 1;
+    hit->z = top;
+    for (auto p : hit->group) {
+        p.first->z = top;
+    }
+    std::sort(pieces.begin(), pieces.end(), compare_pieces); //always sort by z value after modifying z
+    return true;
+}
+
+void Board::drag(float x, float y, unsigned int pointer) {
+    if (pointer >= MAX_POINTERS || pointers[pointer].held == nullptr) {
+        return;
+    }
+    // the held piece stays on the table; the rest of its group follows it rigidly and is put in place on release
+    Pointer& dragging = pointers[pointer];
+    dragging.held->x = std::min(std::max(x - dragging.grab.x, -extent), extent);
+    dragging.held->y = std::min(std::max(y - dragging.grab.y, -extent), extent);
+}
+
+void Board::rotate(float radians, unsigned int pointer) {
+    if (pointer >= MAX_POINTERS || pointers[pointer].held == nullptr) {
+        return;
+    }
+    // turn about the grab point so the pointer keeps holding the same spot
+    PuzzlePiece* turning = pointers[pointer].held;
+    glm::vec2& grab = pointers[pointer].grab;
+    glm::vec2 pivot = glm::vec2(turning->x, turning->y) + grab;
+    grab = rotated(grab, radians);
+    turning->x = std::min(std::max(pivot.x - grab.x, -extent), extent);
+    turning->y = std::min(std::max(pivot.y - grab.y, -extent), extent);
+    turning->angle = std::fmod(turning->angle + radians, TWO_PI);
+    if (turning->angle < 0) {
+        turning->angle += TWO_PI;
+    }
+}
+
+void Board::release(glm::vec2 velocity, unsigned int pointer) {
+    if (pointer >= MAX_POINTERS || pointers[pointer].held == nullptr) {
+        return;
+    }
+
+    // the rest of the group catches up with the held piece
+    PuzzlePiece* dropped = pointers[pointer].held;
+    pointers[pointer].held = nullptr;
+    moveGroup(dropped);
+    hold(dropped, -1);
+    if (glm::length(velocity) < FLICK_MIN_SPEED) {
+        drop(dropped);
+        return;
+    }
+    // thrown: it snaps (or not) where it comes to rest
+    place(dropped);
+    for (auto grouped : dropped->group) {
+        place(grouped.first);
+    }
+    glide.add(dropped->id, glm::vec2(dropped->x, dropped->y), velocity);
+}
+
+void Board::sweep(float x, float y, float radius, float speed) {
+    nearby.clear();
+    grid.query(x - radius, y - radius, x + radius, y + radius, nearby);
+    for (auto id : nearby) {
+        PuzzlePiece* p = byId[id];
+        glm::vec2 d(p->x - x, p->y - y);
+        float distance = glm::length(d);
+        if (!loose(p) || distance >= radius) {
+            continue;
+        }
+        // pieces right under the pointer scatter in a direction of their own
+        glm::vec2 away = distance > 0 ? d / distance : rotated(glm::vec2(1.0f, 0.0f), id * 2.4f);
+        glide.add(id, glm::vec2(p->x, p->y), away * (speed * (1 - distance / radius)));
+        sorting[id] = 0;
+    }
+}
+
+bool Board::advance(float dt) {
+    if (glide.size() == 0) {
+        return false;
+    }
+    resting.clear();
+    glide.step(dt, extent, resting);
+    for (unsigned int i = 0; i < glide.size(); ++i) {
+        PuzzlePiece* p = byId[glide.id(i)];
+        glm::vec2 at = glide.position(i);
+        p->x = at.x;
+        p->y = at.y;
+        place(p);
+        if (!p->group.empty()) {
+            moveGroup(p);
+            for (auto grouped : p->group) {
+                place(grouped.first);
+            }
+        }
+    }
+    for (auto id : resting) {
+        PuzzlePiece* p = byId[id];
+        glide.remove(id);
+        if (!sorting[id]) {
+            drop(p);
+            continue;
+        }
+        sorting[id] = 0;
+        p->x = traySlot[id].x;
+        p->y = traySlot[id].y;
+        place(p);
+        if (pushApart) {
+            wakeUnder(p);
+        }
+    }
+    return true;
+}
+
+void Board::sortIntoTrays(const std::vector<unsigned char>& colorBin, unsigned int numBins) {
+    // loose pieces by tray, in reading order of where they lie now so they keep out of each other's way
+    std::vector<unsigned int> ids, tray(count());
+    std::vector<int> row(count());
+    for (auto p : byId) {
+        if (loose(p) && colorBin.size() == count()) {
+            ids.push_back(p->id);
+            tray[p->id] = topo.border[p->id] ? 0 : 1 + std::min((unsigned int)colorBin[p->id], numBins - 1);
+            row[p->id] = (int)std::floor(-p->y / (height * TRAY_GAP));
+        }
+    }
+    std::sort(ids.begin(), ids.end(), [&](unsigned int a, unsigned int b) {
+        if (tray[a] != tray[b]) {
+            return tray[a] < tray[b];
+        }
+        return row[a] != row[b] ? row[a] < row[b] : byId[a]->x < byId[b]->x;
+    });
+
+    ScrambleParams params;
+    params.count = count();
+    float turned = 0.0f;
+    for (auto id : ids) {
+        turned = byId[id]->angle != 0 ? std::sqrt(width * width + height * height) : turned;
+    }
+    params.pieceWidth = std::max(width, turned);
+    params.pieceHeight = std::max(height, turned);
+    params.tableExtent = extent;
+    trayLayout(ids, tray, params, traySlot);
+
+    // glides that slow down by friction cover v / GLIDE_FRICTION
+    for (auto id : ids) {
+        PuzzlePiece* p = byId[id];
+        sorting[id] = 1;
+        glide.add(id, glm::vec2(p->x, p->y), (traySlot[id] - glm::vec2(p->x, p->y)) * GLIDE_FRICTION);
+    }
+}
+
+void Board::drop(PuzzlePiece* dropped) {
+    //Determine all pieces to check for neighbor proximity
+    std::vector<PuzzlePiece*> activePieces;
+    activePieces.push_back(dropped);
+    for (auto ap : dropped->group) {
+        activePieces.push_back(ap.first);
+    }
+
+    for (auto ap : activePieces) {
+        //check if the active piece has been placed somewhere close to any of its correct neighbors
+        for (unsigned int e = topo.edgeStart[ap->id]; e < topo.edgeStart[ap->id + 1]; ++e) {
+            PuzzlePiece* cand_neigh = byId[topo.edgeTarget[e]];
+            if (ap->group.count(cand_neigh) || held(cand_neigh)) {
+                //already joined (re-merging the whole group again would be quadratic for nothing), or held by
+                //another pointer: its members are not in place yet, and it snaps onto this group when dropped
+                continue;
+            }
+            if (std::abs(angleBetween(ap->angle, cand_neigh->angle)) > SNAP_ANGLE) {
+                continue;
+            }
+            glm::vec2 snapped = glm::vec2(cand_neigh->x, cand_neigh->y) + rotated(topo.edgeOffset[e], cand_neigh->angle);
+            if (std::abs(snapped.x - ap->x) > SNAP_THRESHOLD || std::abs(snapped.y - ap->y) > SNAP_THRESHOLD) {
+                continue;
+            }
+
+            // snap the piece (and everything grouped with it) exactly against the neighbor, turned to match it
+            ap->x = snapped.x;
+            ap->y = snapped.y;
+            ap->angle = cand_neigh->angle;
+            moveGroup(ap);
+
+            // merge both groups: each side already lists its own members, so only the pairs across are new
+            std::vector<PuzzlePiece*> ownSide(1, ap), otherSide(1, cand_neigh);
+            for (auto p : ap->group) {
+                ownSide.push_back(p.first);
+            }
+            for (auto p : cand_neigh->group) {
+                otherSide.push_back(p.first);
+            }
+            for (auto p1 : ownSide) {
+                for (auto p2 : otherSide) {
+                    addToGroup(p1, p2);
+                }
+            }
+        }
+    }
+
+    // snapping may have moved the whole (merged) group
+    place(dropped);
+    for (auto grouped : dropped->group) {
+        place(grouped.first);
+    }
+    if (pushApart) {
+        wakeUnder(dropped);
+        for (auto grouped : dropped->group) {
+            wakeUnder(grouped.first);
+        }
+    }
+}
+
+void Board::setPushApart(bool on) {
+    pushApart = on;
+    for (auto p : byId) {
+        if (on) {
+            wake(p);
+        } else {
+            awake[p->id] = 0;
+        }
+    }
+    if (!on) {
+        awakeIds.clear();
+        settling.clear();
+        nextSettling = 0;
+    }
+}
+
+bool Board::settle() {
+    bool movedAny = false;
+    for (unsigned int checks = 0; checks < SEPARATION_CHECKS && pushApart; ++checks) {
+        if (nextSettling == settling.size()) {
+            // the pass is over; what it (or anything else) woke makes the next one
+            if (awakeIds.empty()) {
+                break;
+            }
+            settling.swap(awakeIds);
+            awakeIds.clear();
+            nextSettling = 0;
+            for (auto id : settling) {
+                awake[id] = 0;
+            }
+        }
+        unsigned int id = settling[nextSettling++];
+        PuzzlePiece* p = byId[id];
+        if (!loose(p) || glide.moving(id)) {
+            continue; // grouped or picked up since it was woken, or thrown (it is woken again where it stops)
+        }
+        float reach = topo.inradius[id] + maxInradius;
+        nearby.clear();
+        grid.query(p->x - reach, p->y - reach, p->x + reach, p->y + reach, nearby);
+        for (auto other : nearby) {
+            PuzzlePiece* q = byId[other];
+            glm::vec2 d(p->x - q->x, p->y - q->y);
+            float depth = topo.inradius[id] + topo.inradius[other] - glm::length(d);
+            if (q == p || depth <= SEPARATION_SLACK || held(q)) {
+                continue; // the held group is still where it was picked up; it is checked once dropped
+            }
+            // pieces on the very same spot part in a direction of their own
+            glm::vec2 away = glm::length(d) > 0 ? glm::normalize(d) : rotated(glm::vec2(1.0f, 0.0f), id * 2.4f);
+            if (loose(q) && !glide.moving(other)) {
+                movedAny = nudge(p, away * (depth * 0.5f)) | movedAny;
+                movedAny = nudge(q, away * (-depth * 0.5f)) | movedAny;
+            } else {
+                movedAny = nudge(p, away * depth) | movedAny;
+            }
+        }
+    }
+    return movedAny;
+}
+
+bool Board::atRest() const {
+    return glide.size() == 0 && (!pushApart || (awakeIds.empty() && nextSettling == settling.size()));
+}
+
+bool Board::isComplete() const {
+    // groups are kept complete (every member lists every other), so one piece grouped with all the others means
+    // the whole board is solved
+    return !pieces.empty() && pieces.front()->group.size() >= count() - 1;
+}
+
+void Board::piecesIn(float minX, float minY, float maxX, float maxY, std::vector<PuzzlePiece*>& out) const {
+    // only pieces bucketed near the rectangle are tested
+    float reach = std::max(width, height);
+    out.clear();
+    nearby.clear();
+    grid.query(minX - reach, minY - reach, maxX + reach, maxY + reach, nearby);
+    for (auto id : nearby) {
+        PuzzlePiece* p = byId[id];
+        glm::vec2 lo = topo.boundsMin[id], hi = topo.boundsMax[id];
+        if (p->angle != 0) {
+            // the box around the turned bounding box
+            glm::vec2 center = rotated((lo + hi) * 0.5f, p->angle), half = (hi - lo) * 0.5f;
+            float c = std::abs(std::cos(p->angle)), s = std::abs(std::sin(p->angle));
+            half = glm::vec2(c * half.x + s * half.y, s * half.x + c * half.y);
+            lo = center - half;
+            hi = center + half;
+        }
+        lo += glm::vec2(p->x, p->y);
+        hi += glm::vec2(p->x, p->y);
+        if (hi.x > minX && lo.x < maxX && hi.y > minY && lo.y < maxY) {
+            out.push_back(p);
+        }
+    }
+    std::sort(out.begin(), out.end(), compare_pieces);
+}
+
+void Board::dumpGroups() const {
+    for (auto p : pieces) {
+        LOG_DEBUG("PIECE {} HAS BEEN GROUPED WITH {} PIECES", p->id, p->group.size());
+    }
+}
+
+bool Board::hint(PuzzlePiece*& a, PuzzlePiece*& b) {
+    // only the edges of pieces that moved since the last hint can have changed
+    for (auto id : movedIds) {
+        moved[id] = 0;
+        refreshEdges(byId[id]);
+    }
+    movedIds.clear();
+    if (hints.empty()) {
+        return false;
+    }
+    unsigned int edge = hints.closest();
+    a = byId[std::upper_bound(topo.edgeStart.begin(), topo.edgeStart.end(), edge) - topo.edgeStart.begin() - 1];
+    b = byId[topo.edgeTarget[edge]];
+    return true;
+}
+
+PuzzlePiece* Board::piece(int id) const {
+    if (id < 0 || id >= (int)byId.size()) {
+        return nullptr;
+    }
+    return byId[id];
+}
+
+glm::vec2 Board::homePosition(int id) const {
+    return topo.home[id];
+}
+
+void Board::place(PuzzlePiece* p) {
+    grid.place(p->id, p->x, p->y);
+    if (!moved[p->id]) {
+        moved[p->id] = 1;
+        movedIds.push_back(p->id);
+    }
+    markUnsaved(p);
+}
+
+void Board::moveGroup(PuzzlePiece* p) {
+    float c = std::cos(p->angle), s = std::sin(p->angle);
+    for (auto g : p->group) {
+        g.first->x = p->x + c * g.second.x - s * g.second.y;
+        g.first->y = p->y + s * g.second.x + c * g.second.y;
+        g.first->angle = p->angle;
+    }
+}
+
+void Board::markUnsaved(PuzzlePiece* p) {
+    if (!unsaved[p->id]) {
+        unsaved[p->id] = 1;
+        unsavedIds.push_back(p->id);
+    }
+}
+
+void Board::refreshEdges(PuzzlePiece* p) {
+    for (unsigned int e = topo.edgeStart[p->id]; e < topo.edgeStart[p->id + 1]; ++e) {
+        // each edge is kept once, as the half-edge leaving the piece with the lower id
+        PuzzlePiece* a = p;
+        PuzzlePiece* b = byId[topo.edgeTarget[e]];
+        unsigned int edge = e;
+        if (b->id < p->id) {
+            std::swap(a, b);
+            edge = topo.edgeTwin[e];
+        }
+        if (a->group.count(b)) {
+            hints.remove(edge);
+        } else {
+            // being turned the wrong way counts like being a piece's width off per radian
+            glm::vec2 snapped = glm::vec2(b->x, b->y) + rotated(topo.edgeOffset[edge], b->angle);
+            float turn = std::abs(angleBetween(a->angle, b->angle));
+            hints.set(edge, glm::length(snapped - glm::vec2(a->x, a->y)) + turn * width);
+        }
+    }
+}
+
+PuzzlePiece* Board::heldPiece(unsigned int pointer) const {
+    return pointer < MAX_POINTERS ? pointers[pointer].held : nullptr;
+}
+
+glm::vec2 Board::grabOffset(unsigned int pointer) const {
+    return pointer < MAX_POINTERS ? pointers[pointer].grab : glm::vec2(0.0f);
+}
+
+void Board::hold(PuzzlePiece* p, int pointer) {
+    holders[p->id] = (signed char)pointer;
+    for (auto g : p->group) {
+        holders[g.first->id] = (signed char)pointer;
+    }
+}
+
+void Board::letGo() {
+    for (auto& pointer : pointers) {
+        if (pointer.held != nullptr) {
+            hold(pointer.held, -1);
+            pointer.held = nullptr;
+        }
+    }
+}
+
+void Board::wake(PuzzlePiece* p) {
+    if (!awake[p->id]) {
+        awake[p->id] = 1;
+        awakeIds.push_back(p->id);
+    }
+}
+
+void Board::wakeUnder(PuzzlePiece* p) {
+    if (loose(p)) {
+        wake(p);
+    }
+    float reach = topo.inradius[p->id] + maxInradius;
+    nearby.clear();
+    grid.query(p->x - reach, p->y - reach, p->x + reach, p->y + reach, nearby);
+    for (auto id : nearby) {
+        PuzzlePiece* q = byId[id];
+        float gap = glm::length(glm::vec2(p->x - q->x, p->y - q->y)) - topo.inradius[p->id] - topo.inradius[id];
+        if (q != p && loose(q) && gap < -SEPARATION_SLACK) {
+            wake(q);
+        }
+    }
+}
+
+// moves a loose piece by delta (kept on the table) and wakes it for the next pass; false if it did not move
+bool Board::nudge(PuzzlePiece* p, glm::vec2 delta) {
+    float x = std::min(std::max(p->x + delta.x, -extent), extent);
+    float y = std::min(std::max(p->y + delta.y, -extent), extent);
+    if (x == p->x && y == p->y) {
+        return false;
+    }
+    p->x = x;
+    p->y = y;
+    place(p);
+    wake(p);
+    return true;
+}
+
+void Board::addToGroup(PuzzlePiece* src, PuzzlePiece* dst) {
+    // a group that did not move can still get a new label
+    markUnsaved(src);
+    markUnsaved(dst);
+    // members share one angle, so both offsets are kept in the same unturned frame
+    glm::vec2 v = rotated(glm::vec2(src->x - dst->x, src->y - dst->y), -dst->angle);
+    dst->group.insert(std::pair<PuzzlePiece*, glm::vec2>(src, v));
+    src->group.insert(std::pair<PuzzlePiece*, glm::vec2>(dst, -v));
+}
@@ -0,0 +1,221 @@
+/*
+BOARD
+
+The puzzle itself, without any GL: the pieces, how they are grouped, and the pointer operations that move them.
+The game feeds press/drag/release from the mouse after unprojecting the cursor through the camera; the solver bot
+calls the very same operations directly, so both exercise one snapping and grouping engine.
+
+World space: the solved board covers [-1,1] on both axes, the table the pieces are scrambled over is
+[-tableExtent,tableExtent]. How the board is cut (rectangles, hexagons, ...) and which pieces snap together comes
+from its PieceTopology; a piece's x/y is its home position's counterpart, the centroid of its outline. Texture
+coordinates tx/ty are the top left corner of the piece's bounding box in the picture, in [0,1].
+
+Pieces may be turned: angle is counter-clockwise in radians, and the piece's outline, bounds and snap offsets are
+all turned with it. Members of a group always share one angle, and each keeps the others' offsets in the group's
+unturned frame, so a group's pose is that of any one member. While a group is held only the held piece's pose is
+updated (dragging and rotating a group of any size is O(1)); the other members are put where that pose says when
+it is released.
+
+Several pointers (mice, or fingers on a touch table) may drag at once, each holding its own group. A pointer's
+state is one small slot in a fixed array, and each piece notes which pointer, if any, holds its group, so every
+pointer operation costs the same however many pointers are down and however large the board is. Commands are
+applied in order, so conflicts resolve the same way every time: a group belongs to the pointer that grabbed it
+first, and a press landing on a group another pointer holds grabs nothing. A group being dropped never snaps onto
+a group another pointer still holds (that group's members are only put in place on its release); the two join
+when the second one is dropped next to the first.
+
+Push apart (off by default) keeps loose pieces from hiding under others. Each piece counts as its incircle (the
+largest circle around its centroid that fits inside it), so pieces lying side by side never push each other and a
+piece pushed clear of the others always shows its middle. Pieces dropped onto or under others and every piece
+after a scramble are woken. Relaxation passes go over the awake pieces only, finding what each overlaps through
+the spatial grid and moving it out (half each way when both are loose, all of it when the other one is grouped,
+held or gliding); whatever moved is checked again in the next pass, and a piece that no longer moves falls asleep,
+so a settled table costs nothing. Each settle() carries the passes on by at most SEPARATION_CHECKS pieces, so a
+pile of 10k pieces spreads out over a fraction of a second without any tick taking long.
+
+A group released while still moving fast is thrown: it glides on, slowing down, and snaps (and wakes what it lands on)
+only where it comes to rest. Sweeping throws every loose piece around a point, and sorting into trays sends each loose
+piece gliding to its slot. Thrown groups are moved one fixed step per advance() by GLIDE, one body per group; catching
+one (pressing any of its pieces) stops it.
+ */
+#ifndef PUZZLEGL_BOARD_H
+#define PUZZLEGL_BOARD_H
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "glide.h"
+#include "hint_index.h"
+#include "save_game.h"
+#include "scramble.h"
+#include "spatial_grid.h"
+#include "topology.h"
+
+const float SNAP_THRESHOLD = 0.02f;
+const float SNAP_ANGLE = 0.1f; // radians two pieces' orientations may differ by and still snap
+const unsigned int LARGE_BOARD_PIECES = 100; // boards with more pieces than this get a table larger than the board
+const float LARGE_BOARD_TABLE_SCALE = 2.0f;
+const uint64_t VORONOI_CUT_SEED = 0x5EEDC075; // fixed, so a save always restores onto the cut it was taken from
+const float FLICK_MIN_SPEED = 0.25f;          // world units per second a release must be moving at to throw
+const unsigned int SEPARATION_CHECKS = 512;   // awake pieces push apart checks per settle(), at most
+const float SEPARATION_SLACK = 1e-4f;         // overlaps this shallow are left alone, so pieces come to rest
+const unsigned int MAX_POINTERS = 16;         // pointers dragging at once; the mouse is pointer 0
+
+// puzzle piece data
+struct PuzzlePiece {
+    int id;
+    float x;
+    float y;
+    float z;
+    float angle;
+    float tx;
+    float ty;
+    std::map<PuzzlePiece*, glm::vec2> group; // every other piece of its group, with its offset from this one (unturned)
+    PuzzlePiece(){
+        x=y=z=id=0;
+        angle=0;
+        tx=ty=0;
+    }
+};
+
+// one piece as a co-op server streams it: its pose, z and group (the id of one of its members, as in a save)
+struct PieceState {
+    uint32_t id;
+    float x, y, z, angle;
+    uint32_t component;
+};
+
+// v turned counter-clockwise by radians
+inline glm::vec2 rotated(glm::vec2 v, float radians) {
+    float c = std::cos(radians), s = std::sin(radians);
+    return glm::vec2(c * v.x - s * v.y, s * v.x + c * v.y);
+}
+
+// b - a, wrapped into [-pi, pi]
+float angleBetween(float a, float b);
+
+class Board {
+public:
+    Board();
+    ~Board();
+
+    // the solved board cut into pieces of about rows x cols (see TOPOLOGY for the exact counts), in reading order
+    void setup(unsigned int rows, unsigned int cols, TopologyKind cut = TOPOLOGY_GRID);
+    void clear();
+    void scramble(ScrambleMode mode, uint64_t seed, RotationMode rotation = ROTATION_NONE);
+    // ungroups, turns upright and moves every piece to centers[id], then snaps each one as if it had just been
+    // dropped there
+    void arrange(const std::vector<glm::vec2>& centers);
+    // brings the snapshot up to date with positions, z and groups (stage and time are left to the caller); only
+    // pieces changed since the last capture are copied, so keep passing the same snapshot; their ids are appended
+    // to changed if given
+    void capture(BoardSnapshot& snapshot, std::vector<unsigned int>* changed = nullptr);
+    // the board a snapshot of the same size and cut was taken from; false if it does not fit this board
+    bool restore(const BoardSnapshot& snapshot);
+    // follows a board played elsewhere: puts the pieces where the states have them and joins every piece to the
+    // group of its component (groups only ever merge while a board is played)
+    void mirror(const std::vector<PieceState>& states);
+
+    // pointer operations in world space, by pointer (below MAX_POINTERS; others are ignored)
+    PuzzlePiece* pick(float x, float y) const; // top piece under the point, nullptr if none
+    // grab the top piece under the point and raise its group; false if there is none or another pointer holds it
+    bool press(float x, float y, unsigned int pointer = 0);
+    void drag(float x, float y, unsigned int pointer = 0); // move the held group so the grab point follows the pointer
+    void rotate(float radians, unsigned int pointer = 0);  // turn the held group counter-clockwise about the grab point
+    // drop it, snapping onto any neighbour within SNAP_THRESHOLD; released at FLICK_MIN_SPEED or faster (world units
+    // per second) it is thrown instead, and glides on to snap where it comes to rest
+    void release(glm::vec2 velocity = glm::vec2(0.0f), unsigned int pointer = 0);
+    // throws the loose pieces within radius of the point outwards, at speed at the point down to nothing at radius
+    void sweep(float x, float y, float radius, float speed);
+    // sends every loose piece gliding to a tray: border pieces first, then one tray per bin (colorBin, by id, values
+    // below numBins); groups stay where they are
+    void sortIntoTrays(const std::vector<unsigned char>& colorBin, unsigned int numBins);
+    // moves thrown pieces on by one fixed step of dt seconds; true if any were moving
+    bool advance(float dt);
+    PuzzlePiece* heldPiece(unsigned int pointer = 0) const;
+    glm::vec2 grabOffset(unsigned int pointer = 0) const; // pointer position relative to the held piece (turned too)
+    int holder(const PuzzlePiece* p) const { return holders[p->id]; } // the pointer holding p's group, -1 if none
+
+    // push apart, see above; turning it on wakes every piece
+    void setPushApart(bool on);
+    bool pushingApart() const { return pushApart; }
+    // one step of push apart; true if it moved any piece
+    bool settle();
+    // nothing is gliding or waiting to be pushed apart, so advance() and settle() change nothing until the next
+    // pointer or board operation
+    bool atRest() const;
+
+    bool isComplete() const;
+    // pieces overlapping the rectangle, lowest z first
+    void piecesIn(float minX, float minY, float maxX, float maxY, std::vector<PuzzlePiece*>& out) const;
+    void dumpGroups() const;
+    // the two pieces that belong together, are not grouped yet and lie closest to snapping; false once solved
+    bool hint(PuzzlePiece*& a, PuzzlePiece*& b);
+
+    unsigned int rows() const { return numRows; }
+    unsigned int cols() const { return numCols; }
+    unsigned int count() const { return byId.size(); }
+    // the largest piece's bounding box
+    float pieceWidth() const { return width; }
+    float pieceHeight() const { return height; }
+    float tableExtent() const { return extent; }
+    PuzzlePiece* piece(int id) const;
+    const std::vector<PuzzlePiece*>& piecesByZ() const { return pieces; }
+    // where the piece lies on the solved board
+    glm::vec2 homePosition(int id) const;
+    // outlines, bounds and neighbours of every piece
+    const PieceTopology& topology() const { return topo; }
+
+private:
+    Board(const Board&);
+    Board& operator=(const Board&);
+
+    void place(PuzzlePiece* p);
+    void moveGroup(PuzzlePiece* p); // the rest of p's group to where p's pose puts them
+    void refreshEdges(PuzzlePiece* p);
+    void markUnsaved(PuzzlePiece* p);
+    void addToGroup(PuzzlePiece* src, PuzzlePiece* dst);
+    struct Pointer {
+        PuzzlePiece* held;
+        glm::vec2 grab; // pointer position relative to the held piece
+    };
+
+    bool loose(const PuzzlePiece* p) const { return holders[p->id] < 0 && p->group.empty(); }
+    bool held(const PuzzlePiece* p) const { return holders[p->id] >= 0; }
+    void hold(PuzzlePiece* p, int pointer); // marks p's group as held by the pointer (-1: by none)
+    void letGo();                           // every pointer, without dropping what they hold
+    void wake(PuzzlePiece* p);
+    void wakeUnder(PuzzlePiece* p); // p and the loose pieces it overlaps
+    bool nudge(PuzzlePiece* p, glm::vec2 delta);
+    void drop(PuzzlePiece* p); // snap p's group where it lies
+
+    unsigned int numRows, numCols;
+    PieceTopology topo;
+    float width, height, extent;
+    std::vector<PuzzlePiece*> pieces; // sorted by z
+    std::vector<PuzzlePiece*> byId;
+    SpatialGrid grid;                 // pieces bucketed by position, for culling and picking
+    mutable std::vector<unsigned int> nearby;
+    HintIndex hints;                  // open edges by gap, keyed by the topology half-edge leaving their lower id piece
+    std::vector<char> moved;          // per piece, moved since the last hint
+    std::vector<unsigned int> movedIds;
+    std::vector<char> unsaved;        // per piece, moved or regrouped since the last capture
+    std::vector<unsigned int> unsavedIds;
+    Pointer pointers[MAX_POINTERS];
+    std::vector<signed char> holders; // per piece, the pointer holding its group, -1 if none
+    bool pushApart;
+    float maxInradius;
+    std::vector<char> awake;          // per piece, to be checked for overlaps by the next settle()
+    std::vector<unsigned int> awakeIds;
+    std::vector<unsigned int> settling; // the pass in progress, up to nextSettling
+    size_t nextSettling;
+    Glide glide;                      // thrown pieces, one per group
+    std::vector<unsigned int> resting;
+    std::vector<char> sorting;        // per piece, gliding into a tray: put on its slot, not snapped, when it stops
+    std::vector<glm::vec2> traySlot;
+};
+
+#endif //PUZZLEGL_BOARD_H
@@ -0,0 +1,58 @@
+#include "camera.h"
+
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+Camera::Camera()
+    : eye(0.0f, 0.0f), extent(1.0f), minExtent(0.01f), maxExtent(100.0f),
+      boundsMin(-1.0f, -1.0f), boundsMax(1.0f, 1.0f) {
+}
+
+void Camera::fit(float minX, float minY, float maxX, float maxY) {
+    boundsMin = glm::vec2(minX, minY);
+    boundsMax = glm::vec2(maxX, maxY);
+    eye = (boundsMin + boundsMax) * 0.5f;
+    extent = std::max(maxX - minX, maxY - minY) * 0.5f;
+}
+
+void Camera::setZoomLimits(float minHalfExtent, float maxHalfExtent) {
+    minExtent = minHalfExtent;
+    maxExtent = std::max(minHalfExtent, maxHalfExtent);
+    extent = std::min(std::max(extent, minExtent), maxExtent);
+}
+
+void Camera::zoomAt(double xpos, double ypos, int width, int height, float factor) {
+    glm::vec2 anchor = screenToWorld(xpos, ypos, width, height);
+    float zoomed = std::min(std::max(extent / factor, minExtent), maxExtent);
+    // the anchor sits at the same fraction of the view before and after
+    eye = anchor + (eye - anchor) * (zoomed / extent);
+    extent = zoomed;
+    clampToBounds();
+}
+
+void Camera::pan(float dx, float dy) {
+    eye += glm::vec2(dx, dy);
+    clampToBounds();
+}
+
+glm::vec2 Camera::screenToWorld(double xpos, double ypos, int width, int height) const {
+    float ndcX = 2.0f * ((float)xpos / std::max(1, width) - 0.5f);
+    float ndcY = -2.0f * ((float)ypos / std::max(1, height) - 0.5f);
+    return eye + glm::vec2(ndcX, ndcY) * extent;
+}
+
+glm::mat4 Camera::viewProjection() const {
+    return glm::ortho(eye.x - extent, eye.x + extent, eye.y - extent, eye.y + extent, -1.0f, 1.0f);
+}
+
+void Camera::visibleRect(float& minX, float& minY, float& maxX, float& maxY) const {
+    minX = eye.x - extent;
+    minY = eye.y - extent;
+    maxX = eye.x + extent;
+    maxY = eye.y + extent;
+}
+
+void Camera::clampToBounds() {
+    // the table may scroll off screen, but never further than its own edge
+    eye = glm::clamp(eye, boundsMin, boundsMax);
+}
@@ -0,0 +1,45 @@
+/*
+CAMERA
+
+2D camera over the table. World space is the table the pieces lie on: the solved board always covers [-1,1] on
+both axes (so one world unit is half the picture's width horizontally and half its height vertically) and the
+table around it may be larger on big boards. The camera looks at a square window of the table, center +/-
+halfExtent on both axes, and maps it onto the whole window; halfExtent 1 around the origin is the original
+board-fills-the-window view.
+ */
+#ifndef PUZZLEGL_CAMERA_H
+#define PUZZLEGL_CAMERA_H
+
+#include <glm/glm.hpp>
+
+class Camera {
+public:
+    Camera();
+
+    // show the whole rectangle and keep the center inside it from now on
+    void fit(float minX, float minY, float maxX, float maxY);
+    // how far the camera may zoom in and out, as half the visible table size
+    void setZoomLimits(float minHalfExtent, float maxHalfExtent);
+
+    // zoom by factor (>1 zooms in) keeping the world point under the cursor where it is on screen
+    void zoomAt(double xpos, double ypos, int width, int height, float factor);
+    void pan(float dx, float dy); // in world units
+
+    // cursor position in window coordinates (origin top left) to world space
+    glm::vec2 screenToWorld(double xpos, double ypos, int width, int height) const;
+    glm::mat4 viewProjection() const;
+    void visibleRect(float& minX, float& minY, float& maxX, float& maxY) const;
+
+    glm::vec2 center() const { return eye; }
+    float halfExtent() const { return extent; }
+
+private:
+    void clampToBounds();
+
+    glm::vec2 eye;
+    float extent;
+    float minExtent, maxExtent;
+    glm::vec2 boundsMin, boundsMax;
+};
+
+#endif //PUZZLEGL_CAMERA_H
@@ -0,0 +1,79 @@
+#include "color_sort.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "job_system.h"
+
+namespace {
+
+const unsigned int PIECES_PER_JOB = 1024;
+const unsigned char DARK_VALUE = 48;  // brightest channel below this: dark
+const float PALE_SATURATION = 0.2f;   // (max - min) / max below this: grey or white
+
+} // namespace
+
+const char* colorBinName(ColorBin bin) {
+    switch (bin) {
+        case COLOR_DARK: return "dark";
+        case COLOR_PALE: return "pale";
+        case COLOR_RED: return "red";
+        case COLOR_YELLOW: return "yellow";
+        case COLOR_GREEN: return "green";
+        case COLOR_CYAN: return "cyan";
+        case COLOR_BLUE: return "blue";
+        case COLOR_MAGENTA: return "magenta";
+        default: return "?";
+    }
+}
+
+ColorBin colorBin(unsigned char r, unsigned char g, unsigned char b) {
+    int hi = std::max(r, std::max(g, b)), lo = std::min(r, std::min(g, b));
+    if (hi < DARK_VALUE) {
+        return COLOR_DARK;
+    }
+    int chroma = hi - lo;
+    if (chroma < PALE_SATURATION * hi) {
+        return COLOR_PALE;
+    }
+    // hue in sixths of the circle, red at 0, then rounded to the nearest of the six
+    float hue;
+    if (hi == r) {
+        hue = (float)(g - b) / chroma;
+    } else if (hi == g) {
+        hue = 2.0f + (float)(b - r) / chroma;
+    } else {
+        hue = 4.0f + (float)(r - g) / chroma;
+    }
+    int sixth = ((int)std::floor(hue + 0.5f) + 6) % 6;
+    return (ColorBin)(COLOR_RED + sixth);
+}
+
+void dominantColors(const PieceTopology& topology, const unsigned char* rgba, unsigned int width, unsigned int height,
+                    std::vector<unsigned char>& bins) {
+    bins.assign(topology.count(), COLOR_PALE);
+    parallelFor("color sort", topology.count(), PIECES_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int id = begin; id < end; ++id) {
+            unsigned int votes[COLOR_BIN_COUNT] = {};
+            glm::vec2 lo = topology.boundsMin[id], size = topology.boundsMax[id] - lo;
+            for (unsigned int sy = 0; sy < COLOR_SAMPLES; ++sy) {
+                for (unsigned int sx = 0; sx < COLOR_SAMPLES; ++sx) {
+                    // sample cell centers, relative to the piece's home; the board's [-1,1] is the whole picture
+                    glm::vec2 local = lo + size * glm::vec2((sx + 0.5f) / COLOR_SAMPLES, (sy + 0.5f) / COLOR_SAMPLES);
+                    if (!topology.contains(id, local)) {
+                        continue;
+                    }
+                    glm::vec2 board = topology.home[id] + local;
+                    unsigned int px = std::min(width - 1, (unsigned int)((board.x + 1) / 2 * width));
+                    unsigned int py = std::min(height - 1, (unsigned int)((1 - board.y) / 2 * height));
+                    const unsigned char* texel = rgba + ((size_t)py * width + px) * 4;
+                    votes[colorBin(texel[0], texel[1], texel[2])]++;
+                }
+            }
+            unsigned int* best = std::max_element(votes, votes + COLOR_BIN_COUNT);
+            if (*best > 0) {
+                bins[id] = best - votes;
+            }
+        }
+    });
+}
@@ -0,0 +1,38 @@
+/*
+COLOR SORT
+
+The dominant colour of every piece, for sorting loose pieces into trays. Each piece is sampled on a fixed grid of
+COLOR_SAMPLES x COLOR_SAMPLES points over its bounding box in the picture, keeping only the points inside the piece
+(one coverage mask lookup each, see TOPOLOGY), and every sample votes for one of COLOR_BIN_COUNT bins: very dark,
+washed out (greys and whites), or one of six hues. The bin with the most votes wins. The cost per piece is fixed
+whatever the picture's resolution, and the pieces are split over the job system.
+ */
+#ifndef PUZZLEGL_COLOR_SORT_H
+#define PUZZLEGL_COLOR_SORT_H
+
+#include <vector>
+
+#include "topology.h"
+
+const unsigned int COLOR_SAMPLES = 6; // per side of a piece's bounding box
+
+enum ColorBin {
+    COLOR_DARK = 0,
+    COLOR_PALE = 1,
+    COLOR_RED = 2,
+    COLOR_YELLOW = 3,
+    COLOR_GREEN = 4,
+    COLOR_CYAN = 5,
+    COLOR_BLUE = 6,
+    COLOR_MAGENTA = 7,
+    COLOR_BIN_COUNT
+};
+
+const char* colorBinName(ColorBin bin);
+// the bin of one RGB colour
+ColorBin colorBin(unsigned char r, unsigned char g, unsigned char b);
+// the dominant bin of every piece of the topology, by id, from the whole picture (RGBA, rows top down)
+void dominantColors(const PieceTopology& topology, const unsigned char* rgba, unsigned int width, unsigned int height,
+                    std::vector<unsigned char>& bins);
+
+#endif //PUZZLEGL_COLOR_SORT_H
@@ -0,0 +1,315 @@
+#include "coop.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "log.h"
+
+namespace {
+
+const int LISTEN_BACKLOG = 1024;
+const size_t FRAME_HEADER = 5; // uint32_t size, uint8_t type
+const size_t READ_CHUNK = 64 * 1024;
+
+void put(std::vector<unsigned char>& out, const void* v, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)v;
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+bool isPort(const char* address) {
+    return *address != 0 && std::strspn(address, "0123456789") == std::strlen(address);
+}
+
+bool nonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// the socket and address for an endpoint; -1 if the UNIX path does not fit
+int openSocket(const char* address, sockaddr_storage& to, socklen_t& length) {
+    std::memset(&to, 0, sizeof(to));
+    if (isPort(address)) {
+        sockaddr_in* in = (sockaddr_in*)&to;
+        in->sin_family = AF_INET;
+        in->sin_port = htons((uint16_t)std::atoi(address));
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        length = sizeof(sockaddr_in);
+        return socket(AF_INET, SOCK_STREAM, 0);
+    }
+    sockaddr_un* un = (sockaddr_un*)&to;
+    if (std::strlen(address) >= sizeof(un->sun_path)) {
+        std::cout << "[ERROR] socket path too long: " << address << std::endl;
+        return -1;
+    }
+    un->sun_family = AF_UNIX;
+    std::strcpy(un->sun_path, address);
+    length = sizeof(sockaddr_un);
+    return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+} // namespace
+
+size_t beginFrame(std::vector<unsigned char>& out, CoopMessage type) {
+    size_t frame = out.size();
+    putU32(out, 0);
+    out.push_back((unsigned char)type);
+    return frame;
+}
+
+void endFrame(std::vector<unsigned char>& out, size_t frame) {
+    uint32_t size = (uint32_t)(out.size() - frame - sizeof(uint32_t));
+    std::memcpy(&out[frame], &size, sizeof(size));
+}
+
+void putU32(std::vector<unsigned char>& out, uint32_t v) {
+    put(out, &v, sizeof(v));
+}
+
+void putU64(std::vector<unsigned char>& out, uint64_t v) {
+    put(out, &v, sizeof(v));
+}
+
+void putFloat(std::vector<unsigned char>& out, float v) {
+    put(out, &v, sizeof(v));
+}
+
+bool CoopReader::take(void* to, size_t size) {
+    if (!good || left() < size) {
+        good = false;
+        std::memset(to, 0, size);
+        return false;
+    }
+    std::memcpy(to, at, size);
+    at += size;
+    return true;
+}
+
+uint32_t CoopReader::u32() {
+    uint32_t v;
+    take(&v, sizeof(v));
+    return v;
+}
+
+uint64_t CoopReader::u64() {
+    uint64_t v;
+    take(&v, sizeof(v));
+    return v;
+}
+
+float CoopReader::f32() {
+    float v;
+    take(&v, sizeof(v));
+    return v;
+}
+
+long nextFrame(const unsigned char* data, size_t size, CoopMessage& type, CoopReader& payload) {
+    if (size < FRAME_HEADER) {
+        return 0;
+    }
+    uint32_t length;
+    std::memcpy(&length, data, sizeof(length));
+    if (length == 0 || length > COOP_MAX_FRAME) {
+        return -1;
+    }
+    if (size < sizeof(uint32_t) + length) {
+        return 0;
+    }
+    type = (CoopMessage)data[sizeof(uint32_t)];
+    payload = CoopReader(data + FRAME_HEADER, length - 1);
+    return sizeof(uint32_t) + length;
+}
+
+int coopListen(const char* address) {
+    sockaddr_storage at;
+    socklen_t length;
+    int fd = openSocket(address, at, length);
+    if (fd < 0) {
+        return -1;
+    }
+    if (at.ss_family == AF_UNIX) {
+        unlink(address); // left behind by a server that did not shut down
+    } else {
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+    if (bind(fd, (sockaddr*)&at, length) != 0 || listen(fd, LISTEN_BACKLOG) != 0 || !nonBlocking(fd)) {
+        std::cout << "[ERROR] could not listen on " << address << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int coopConnect(const char* address) {
+    sockaddr_storage at;
+    socklen_t length;
+    int fd = openSocket(address, at, length);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, (sockaddr*)&at, length) != 0 || !nonBlocking(fd)) {
+        std::cout << "[ERROR] could not connect to " << address << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    if (at.ss_family == AF_INET) {
+        int on = 1; // drags are small and must not wait for the previous one's ack
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+CoopClient::CoopClient() : fd(-1), pointerId(-1), serverTick(0), bytesReceived(0) {
+}
+
+CoopClient::~CoopClient() {
+    close();
+}
+
+bool CoopClient::connect(const char* address) {
+    close();
+    fd = coopConnect(address);
+    return fd >= 0;
+}
+
+void CoopClient::close() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    pointerId = -1;
+    serverTick = 0;
+    in.clear();
+    out.clear();
+}
+
+void CoopClient::join(uint32_t room, unsigned int rows, unsigned int cols, TopologyKind cut, uint64_t seed,
+                      ScrambleMode mode, RotationMode rotation, const PieceTopology& topology) {
+    decoder.reset(topology);
+    size_t frame = beginFrame(out, COOP_JOIN);
+    putU32(out, room);
+    putU32(out, rows);
+    putU32(out, cols);
+    putU32(out, cut);
+    putU64(out, seed);
+    putU32(out, mode);
+    putU32(out, rotation);
+    endFrame(out, frame);
+    flush();
+}
+
+void CoopClient::press(float x, float y) {
+    size_t frame = beginFrame(out, COOP_PRESS);
+    putFloat(out, x);
+    putFloat(out, y);
+    endFrame(out, frame);
+    flush();
+}
+
+void CoopClient::drag(float x, float y, int64_t sampledNs) {
+    size_t frame = beginFrame(out, COOP_DRAG);
+    putFloat(out, x);
+    putFloat(out, y);
+    putU64(out, (uint64_t)sampledNs);
+    endFrame(out, frame);
+    flush();
+}
+
+void CoopClient::rotate(float radians) {
+    size_t frame = beginFrame(out, COOP_ROTATE);
+    putFloat(out, radians);
+    endFrame(out, frame);
+    flush();
+}
+
+void CoopClient::release(int64_t sampledNs) {
+    size_t frame = beginFrame(out, COOP_RELEASE);
+    putU64(out, (uint64_t)sampledNs);
+    endFrame(out, frame);
+    flush();
+}
+
+void CoopClient::flush() {
+    size_t sent = 0;
+    while (fd >= 0 && sent < out.size()) {
+        ssize_t n = send(fd, &out[sent], out.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                close();
+                return;
+            }
+            break; // the rest goes with the next call
+        }
+        sent += n;
+    }
+    out.erase(out.begin(), out.begin() + sent);
+}
+
+bool CoopClient::poll(std::vector<PieceState>& states) {
+    flush();
+    bool hungUp = false; // closed only once what did arrive (usually the solving move) has been read
+    for (;;) {
+        if (fd < 0) {
+            return false;
+        }
+        size_t had = in.size();
+        in.resize(had + READ_CHUNK);
+        ssize_t n = recv(fd, &in[had], READ_CHUNK, 0);
+        in.resize(had + std::max<ssize_t>(n, 0));
+        if (n > 0) {
+            bytesReceived += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        hungUp = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        break;
+    }
+
+    size_t used = 0;
+    CoopMessage type;
+    CoopReader payload(nullptr, 0);
+    long length;
+    while ((length = nextFrame(in.data() + used, in.size() - used, type, payload)) > 0) {
+        used += length;
+        if (type == COOP_WELCOME) {
+            payload.u32(); // room
+            pointerId = (int)payload.u32();
+        } else if (type == COOP_STATE) {
+            serverTick = payload.u64();
+            if (!payload.ok() || !decoder.apply(payload.here(), payload.left(), states)) {
+                LOG_ERROR("the co-op room streamed a board this player does not have");
+                close();
+                return false;
+            }
+        } else if (type == COOP_FULL) {
+            LOG_ERROR("the co-op room is full");
+            close();
+            return false;
+        }
+    }
+    if (length < 0) {
+        LOG_ERROR("malformed frame from the co-op server");
+        close();
+        return false;
+    }
+    in.erase(in.begin(), in.begin() + used);
+    if (hungUp) {
+        close();
+    }
+    return fd >= 0;
+}
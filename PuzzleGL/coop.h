@@ -0,0 +1,121 @@
+/*
+CO-OP
+
+The wire protocol between the co-op server (see COOP SERVER) and its players, and the player's end of it. A player
+joins a room, and everyone in a room plays one board: the server owns it, applies every player's pointer input in
+the order it arrives, and streams back what changed, so each player's board only ever mirrors the server's.
+
+Endpoints are a UNIX socket path, or a port number for TCP on the loopback interface. Every message is a frame of a
+uint32_t size (of what follows), a uint8_t type and the payload, little endian:
+
+player -> server
+    COOP_JOIN     uint32 room, rows, cols, cut, uint64 seed, uint32 mode, rotation (only used to create the room)
+    COOP_PRESS    float x, y
+    COOP_DRAG     float x, y, int64 sampledNs (the player's steady clock; only differences are used)
+    COOP_ROTATE   float radians
+    COOP_RELEASE  int64 sampledNs
+server -> player
+    COOP_WELCOME  uint32 room, pointer, rows, cols, cut
+    COOP_STATE    uint64 tick, one STATE STREAM frame (a keyframe right after the welcome, then a delta per server
+                  tick that changed anything)
+    COOP_FULL     every pointer of the room is taken; the server closes the connection
+ */
+#ifndef PUZZLEGL_COOP_H
+#define PUZZLEGL_COOP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "board.h"
+#include "state_stream.h"
+
+const uint32_t COOP_MAX_FRAME = 1 << 24; // larger frames are a protocol error (a 100k-piece keyframe is about 1MB)
+
+enum CoopMessage {
+    COOP_JOIN = 1,
+    COOP_PRESS,
+    COOP_DRAG,
+    COOP_ROTATE,
+    COOP_RELEASE,
+    COOP_WELCOME,
+    COOP_STATE,
+    COOP_FULL
+};
+
+// appends one frame; the payload is written with the put functions between begin and end
+size_t beginFrame(std::vector<unsigned char>& out, CoopMessage type);
+void endFrame(std::vector<unsigned char>& out, size_t frame);
+void putU32(std::vector<unsigned char>& out, uint32_t v);
+void putU64(std::vector<unsigned char>& out, uint64_t v);
+void putFloat(std::vector<unsigned char>& out, float v);
+
+// reads a frame's payload front to back; reading past its end yields zeros and fails ok()
+class CoopReader {
+public:
+    CoopReader(const unsigned char* data, size_t size) : at(data), end(data + size), good(true) {}
+    uint32_t u32();
+    uint64_t u64();
+    float f32();
+    bool ok() const { return good; }
+    size_t left() const { return end - at; }
+    const unsigned char* here() const { return at; } // the rest of the payload, left() bytes
+
+private:
+    bool take(void* to, size_t size);
+
+    const unsigned char* at;
+    const unsigned char* end;
+    bool good;
+};
+
+// the next whole frame at the start of data: its length including the header, or 0 if it has not all arrived;
+// -1 if the frame is malformed
+long nextFrame(const unsigned char* data, size_t size, CoopMessage& type, CoopReader& payload);
+
+// a listening (server) or connected (player) non-blocking socket for the address; -1 on failure
+int coopListen(const char* address);
+int coopConnect(const char* address);
+
+// a player's connection; all calls are non-blocking
+class CoopClient {
+public:
+    CoopClient();
+    ~CoopClient();
+
+    bool connect(const char* address);
+    void close();
+    bool connected() const { return fd >= 0; }
+    // asks to play in the room; a room that does not exist yet is created with this board, scrambled. The room's
+    // board is decoded with the topology of that board, which must outlive the connection.
+    void join(uint32_t room, unsigned int rows, unsigned int cols, TopologyKind cut, uint64_t seed,
+              ScrambleMode mode, RotationMode rotation, const PieceTopology& topology);
+    bool joined() const { return pointerId >= 0; }
+    int pointer() const { return pointerId; } // the room's pointer this player drags with
+    uint64_t tick() const { return serverTick; }
+
+    void press(float x, float y);
+    void drag(float x, float y, int64_t sampledNs);
+    void rotate(float radians);
+    void release(int64_t sampledNs);
+
+    // sends what is queued and appends the state of every piece that changed since the last poll; false once the
+    // server has closed the connection (or refused the join, or streamed another board)
+    bool poll(std::vector<PieceState>& states);
+    unsigned long long received() const { return bytesReceived; }
+
+private:
+    CoopClient(const CoopClient&);
+    CoopClient& operator=(const CoopClient&);
+
+    void flush();
+
+    int fd;
+    int pointerId;
+    uint64_t serverTick;
+    unsigned long long bytesReceived;
+    std::vector<unsigned char> in, out;
+    StateDecoder decoder;
+};
+
+#endif //PUZZLEGL_COOP_H
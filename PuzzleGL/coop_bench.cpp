@@ -0,0 +1,157 @@
+/*
+CO-OP BENCHMARK
+
+Loads a co-op server with players over loopback sockets and reports how many rooms each core keeps up with and the
+server's tick times. The server runs in this process on its own thread, over the job system; the players are driven
+from the main thread at 60 frames per second, every one of them over and over pressing a piece it last saw, dragging
+it for a while and letting go, so every room always has its pointers busy.
+
+usage: coop_bench [rooms] [players per room] [rows] [cols] [seconds] [threads] [socket path | port]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "coop.h"
+#include "coop_server.h"
+#include "job_system.h"
+
+namespace sc = std::chrono;
+
+namespace {
+
+const unsigned int FRAME_HZ = 60;
+const unsigned int DRAG_FRAMES = 30; // per drag
+const float DRAG_STEP = 0.01f;       // world units per frame
+
+struct BenchPlayer {
+    CoopClient client;
+    std::vector<glm::vec2> seen; // piece positions, by id
+    std::vector<PieceState> states;
+    unsigned int frame;          // of the current drag, 0 while not dragging
+    glm::vec2 at, heading;
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned int numRooms = argc > 1 ? std::atoi(argv[1]) : 200;
+    unsigned int perRoom = argc > 2 ? std::atoi(argv[2]) : 2;
+    unsigned int rows = argc > 3 ? std::atoi(argv[3]) : 10;
+    unsigned int cols = argc > 4 ? std::atoi(argv[4]) : rows;
+    double seconds = argc > 5 ? std::atof(argv[5]) : 10;
+    unsigned int threads = argc > 6 ? std::atoi(argv[6]) : 0;
+    const char* address = argc > 7 ? argv[7] : "/tmp/puzzle_coop_bench.sock";
+    if (numRooms == 0 || perRoom == 0 || perRoom > MAX_POINTERS || rows == 0 || cols == 0) {
+        std::cout << "usage: coop_bench [rooms] [players per room (1-" << MAX_POINTERS << ")] [rows] [cols] [seconds]"
+                  << " [threads] [socket path | port]" << std::endl;
+        return -1;
+    }
+
+    // two sockets per player, one at each end
+    rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+    if (threads != 0) {
+        startJobSystem(threads - 1);
+    }
+
+    CoopServer server;
+    if (!server.listen(address)) {
+        return -1;
+    }
+    std::thread serving(&CoopServer::run, &server);
+
+    PieceTopology topology; // every room's board, as each player decodes it
+    buildTopology(TOPOLOGY_GRID, rows, cols, VORONOI_CUT_SEED, topology);
+    std::vector<BenchPlayer*> players;
+    for (unsigned int r = 0; r < numRooms; ++r) {
+        for (unsigned int k = 0; k < perRoom; ++k) {
+            BenchPlayer* p = new BenchPlayer();
+            if (!p->client.connect(address)) {
+                delete p;
+                break;
+            }
+            p->client.join(r, rows, cols, TOPOLOGY_GRID, r + 1, SCRAMBLE_UNIFORM, ROTATION_NONE, topology);
+            p->frame = 0;
+            players.push_back(p);
+        }
+    }
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    unsigned long long drags = 0, updates = 0;
+    const sc::nanoseconds period(1000000000 / FRAME_HZ);
+    auto start = sc::steady_clock::now(), next = start;
+    while (sc::duration<double>(sc::steady_clock::now() - start).count() < seconds) {
+        int64_t now = sc::duration_cast<sc::nanoseconds>(sc::steady_clock::now().time_since_epoch()).count();
+        for (auto p : players) {
+            p->states.clear();
+            if (!p->client.poll(p->states)) {
+                continue;
+            }
+            for (auto& s : p->states) {
+                if (s.id >= p->seen.size()) {
+                    p->seen.resize(s.id + 1);
+                }
+                p->seen[s.id] = glm::vec2(s.x, s.y);
+            }
+            updates += p->states.size();
+            if (!p->client.joined() || p->seen.empty()) {
+                continue;
+            }
+            if (p->frame == 0) {
+                p->at = p->seen[random() % p->seen.size()];
+                p->heading = glm::vec2(unit(random), unit(random)) * DRAG_STEP;
+                p->client.press(p->at.x, p->at.y);
+                p->frame = 1;
+                drags++;
+            } else if (p->frame < DRAG_FRAMES) {
+                p->at = glm::clamp(p->at + p->heading, glm::vec2(-1.0f), glm::vec2(1.0f));
+                p->client.drag(p->at.x, p->at.y, now);
+                p->frame++;
+            } else {
+                p->client.release(now);
+                p->frame = 0;
+            }
+        }
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+    double elapsed = sc::duration<double>(sc::steady_clock::now() - start).count();
+    unsigned long long received = 0;
+    unsigned int connected = 0;
+    for (auto p : players) {
+        received += p->client.received();
+        connected += p->client.connected();
+        delete p;
+    }
+    server.stop();
+    serving.join();
+
+    CoopServerStats stats;
+    server.stats(stats);
+    unsigned int cores = jobConcurrency();
+    double budget = 1.0 / COOP_TICK_HZ;
+    std::cout << numRooms << " rooms of " << perRoom << " players on " << rows << "x" << cols << " boards, "
+              << cores << " threads, " << elapsed << "s" << std::endl;
+    std::cout << "players still connected: " << connected << "/" << numRooms * perRoom << std::endl;
+    std::cout << "ticks: " << stats.ticks << " (" << stats.ticks / elapsed << "/s of " << COOP_TICK_HZ << ")"
+              << std::endl;
+    std::cout << "tick: " << stats.meanTick * 1000 << "ms mean, " << stats.p99Tick * 1000 << "ms p99, "
+              << stats.worstTick * 1000 << "ms worst, of a " << budget * 1000 << "ms budget" << std::endl;
+    std::cout << "sessions per core: " << (double)numRooms / cores << " served, about "
+              << (stats.p99Tick > 0 ? (double)numRooms / cores * budget / stats.p99Tick : 0) << " within budget at p99"
+              << std::endl;
+    std::cout << "drags: " << drags << ", piece updates received: " << updates << ", "
+              << received / elapsed / (numRooms * perRoom) << " bytes/s per player" << std::endl;
+    return 0;
+}
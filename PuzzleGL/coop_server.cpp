@@ -0,0 +1,436 @@
+#include "coop_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "job_system.h"
+
+namespace sc = std::chrono;
+
+namespace {
+
+const unsigned int EPOLL_BATCH = 256;
+const unsigned int ROOMS_PER_JOB = 16;
+const size_t READ_CHUNK = 16 * 1024;
+const uint32_t ALL_POINTERS = MAX_POINTERS >= 32 ? ~0u : (1u << MAX_POINTERS) - 1;
+
+} // namespace
+
+CoopServer::CoopServer() : listener(-1), epoll(-1), stopping(false), ticks(0), bytesSent(0) {
+}
+
+CoopServer::~CoopServer() {
+    for (auto p : players) {
+        close(p->fd);
+        delete p;
+    }
+    for (auto r : rooms) {
+        delete r;
+    }
+    for (auto r : unready) {
+        waitJob(r->setup);
+        delete r;
+    }
+    if (listener >= 0) {
+        close(listener);
+    }
+    if (epoll >= 0) {
+        close(epoll);
+    }
+}
+
+bool CoopServer::listen(const char* address) {
+    listener = coopListen(address);
+    if (listener < 0) {
+        return false;
+    }
+    epoll = epoll_create1(0);
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr; // the listener; players carry their Player*
+    if (epoll < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &ev) != 0) {
+        std::cout << "[ERROR] epoll: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void CoopServer::run() {
+    const sc::nanoseconds period(1000000000 / COOP_TICK_HZ);
+    auto next = sc::steady_clock::now() + period;
+    epoll_event events[EPOLL_BATCH];
+    while (!stopping) {
+        auto now = sc::steady_clock::now();
+        if (now >= next) {
+            tick();
+            next += period;
+            if (next + 4 * period < now) {
+                next = now + period; // fell far behind: carry on from now rather than rushing through ticks
+            }
+            continue;
+        }
+        int timeout = (int)sc::duration_cast<sc::milliseconds>(next - now).count() + 1;
+        int n = epoll_wait(epoll, events, EPOLL_BATCH, timeout);
+        for (int i = 0; i < n; ++i) {
+            Player* player = (Player*)events[i].data.ptr;
+            if (player == nullptr) {
+                accept();
+            } else if (player->fd >= 0) {
+                read(player); // hang ups and errors show up as a failed read
+            }
+        }
+        for (auto p : dropped) {
+            delete p;
+        }
+        dropped.clear();
+    }
+}
+
+void CoopServer::stats(CoopServerStats& out) const {
+    out.ticks = ticks;
+    out.rooms = rooms.size() + unready.size();
+    out.players = players.size();
+    out.bytesSent = bytesSent;
+    out.meanTick = out.p99Tick = out.worstTick = 0;
+    if (tickTimes.empty()) {
+        return;
+    }
+    std::vector<float> sorted(tickTimes);
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0;
+    for (auto t : sorted) {
+        total += t;
+    }
+    out.meanTick = total / sorted.size();
+    out.p99Tick = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+    out.worstTick = sorted.back();
+}
+
+void CoopServer::accept() {
+    for (;;) {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cout << "[ERROR] accept: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        Player* player = new Player();
+        player->fd = fd;
+        player->room = nullptr;
+        player->pointer = -1;
+        player->welcomed = false;
+        player->sent = 0;
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = player;
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            delete player;
+            continue;
+        }
+        players.push_back(player);
+    }
+}
+
+void CoopServer::read(Player* player) {
+    for (;;) {
+        size_t had = player->in.size();
+        player->in.resize(had + READ_CHUNK);
+        ssize_t n = recv(player->fd, &player->in[had], READ_CHUNK, 0);
+        player->in.resize(had + std::max<ssize_t>(n, 0));
+        if (n > 0) {
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            drop(player);
+            return;
+        }
+        break;
+    }
+
+    size_t used = 0;
+    CoopMessage type;
+    CoopReader payload(nullptr, 0);
+    long length;
+    while ((length = nextFrame(player->in.data() + used, player->in.size() - used, type, payload)) > 0) {
+        used += length;
+        if (!handle(player, type, payload) || player->fd < 0) {
+            if (player->fd >= 0) {
+                drop(player);
+            }
+            return;
+        }
+    }
+    if (length < 0) {
+        drop(player);
+        return;
+    }
+    player->in.erase(player->in.begin(), player->in.begin() + used);
+}
+
+bool CoopServer::handle(Player* player, CoopMessage type, CoopReader& payload) {
+    if (type == COOP_JOIN) {
+        join(player, payload);
+        return true;
+    }
+    Command c;
+    c.type = type;
+    c.pointer = player->pointer;
+    c.x = c.y = 0;
+    c.sampledNs = 0;
+    c.left = false;
+    switch (type) {
+        case COOP_PRESS:
+        case COOP_DRAG:
+            c.x = payload.f32();
+            c.y = payload.f32();
+            if (type == COOP_DRAG) {
+                c.sampledNs = (int64_t)payload.u64();
+            }
+            break;
+        case COOP_ROTATE:
+            c.x = payload.f32();
+            break;
+        case COOP_RELEASE:
+            c.sampledNs = (int64_t)payload.u64();
+            break;
+        default:
+            return false; // players do not send anything else
+    }
+    // a NaN gets past the board's clamps and snaps a held group onto everything, so it is as malformed as a short frame
+    if (!payload.ok() || !std::isfinite(c.x) || !std::isfinite(c.y)) {
+        return false;
+    }
+    if (player->room != nullptr) {
+        player->room->inbox.push_back(c);
+    }
+    return true;
+}
+
+void CoopServer::join(Player* player, CoopReader& payload) {
+    uint32_t id = payload.u32();
+    uint32_t rows = payload.u32(), cols = payload.u32(), cut = payload.u32();
+    uint64_t seed = payload.u64();
+    uint32_t mode = payload.u32(), rotation = payload.u32();
+    if (!payload.ok() || player->room != nullptr) {
+        drop(player); // one room per connection
+        return;
+    }
+
+    Room* room;
+    auto found = roomsById.find(id);
+    if (found != roomsById.end()) {
+        room = found->second;
+    } else {
+        if (rows == 0 || cols == 0 || (uint64_t)rows * cols > COOP_MAX_PIECES || cut >= TOPOLOGY_KIND_COUNT
+            || mode >= SCRAMBLE_MODE_COUNT || rotation >= ROTATION_MODE_COUNT) {
+            drop(player);
+            return;
+        }
+        room = new Room();
+        room->id = id;
+        room->freePointers = ALL_POINTERS;
+        room->welcoming = false;
+        for (auto& track : room->tracks) {
+            track.dragSampledNs = 0;
+            track.numDragSamples = 0;
+        }
+        room->setup = createJob("coop room setup", [=] {
+            room->board.setup(rows, cols, (TopologyKind)cut);
+            room->board.scramble((ScrambleMode)mode, seed, (RotationMode)rotation);
+        });
+        runJob(room->setup);
+        roomsById[id] = room;
+        unready.push_back(room);
+    }
+    if (room->freePointers == 0) {
+        size_t frame = beginFrame(player->out, COOP_FULL);
+        endFrame(player->out, frame);
+        write(player);
+        if (player->fd >= 0) {
+            drop(player);
+        }
+        return;
+    }
+    int pointer = 0;
+    while (!(room->freePointers & (1u << pointer))) {
+        pointer++;
+    }
+    room->freePointers &= ~(1u << pointer);
+    player->room = room;
+    player->pointer = pointer;
+    room->players.push_back(player);
+    room->welcoming = true; // welcomed by the next tick, with the board as that tick leaves it
+}
+
+void CoopServer::drop(Player* player) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, player->fd, nullptr);
+    close(player->fd);
+    player->fd = -1;
+    if (Room* room = player->room) {
+        Command c;
+        c.type = COOP_RELEASE;
+        c.pointer = player->pointer;
+        c.x = c.y = 0;
+        c.sampledNs = 0;
+        c.left = true;
+        room->inbox.push_back(c);
+        room->freePointers |= 1u << player->pointer;
+        room->players.erase(std::find(room->players.begin(), room->players.end(), player));
+    }
+    players.erase(std::find(players.begin(), players.end(), player));
+    dropped.push_back(player); // events of this epoll_wait may still name it
+}
+
+void CoopServer::tick() {
+    auto start = sc::steady_clock::now();
+    for (size_t i = 0; i < unready.size();) {
+        Room* room = unready[i];
+        if (jobConcurrency() == 1) {
+            waitJob(room->setup); // there is no worker to set it up
+        }
+        if (!jobFinished(room->setup)) {
+            ++i;
+            continue;
+        }
+        room->setup.reset();
+        rooms.push_back(room);
+        unready[i] = unready.back();
+        unready.pop_back();
+    }
+    parallelFor("coop rooms", rooms.size(), ROOMS_PER_JOB, [this](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            step(rooms[i]);
+        }
+    });
+    ticks++;
+
+    for (size_t i = 0; i < rooms.size();) {
+        Room* room = rooms[i];
+        for (auto p : room->players) {
+            if (p->welcomed) {
+                p->out.insert(p->out.end(), room->frame.begin(), room->frame.end());
+                continue;
+            }
+            size_t frame = beginFrame(p->out, COOP_WELCOME);
+            putU32(p->out, room->id);
+            putU32(p->out, p->pointer);
+            putU32(p->out, room->board.rows());
+            putU32(p->out, room->board.cols());
+            putU32(p->out, room->board.topology().kind);
+            endFrame(p->out, frame);
+            p->out.insert(p->out.end(), room->whole.begin(), room->whole.end());
+            p->welcomed = true;
+        }
+        room->welcoming = false;
+        if (room->players.empty()) {
+            // the last player's release has been applied; nobody is left to see the board
+            roomsById.erase(room->id);
+            rooms[i] = rooms.back();
+            rooms.pop_back();
+            delete room;
+            continue;
+        }
+        ++i;
+    }
+
+    // a copy: a player that falls too far behind is dropped on the way
+    std::vector<Player*> writing(players);
+    for (auto p : writing) {
+        write(p);
+    }
+
+    float seconds = sc::duration<float>(sc::steady_clock::now() - start).count();
+    if (tickTimes.size() < COOP_TICK_SAMPLES) {
+        tickTimes.push_back(seconds);
+    } else {
+        tickTimes[ticks % COOP_TICK_SAMPLES] = seconds;
+    }
+}
+
+// one room's tick, on the job system: only the room itself is touched
+void CoopServer::step(Room* room) {
+    Board& board = room->board;
+    for (auto& c : room->inbox) {
+        PointerTrack& track = room->tracks[c.pointer];
+        switch (c.type) {
+            case COOP_PRESS:
+                board.press(c.x, c.y, c.pointer);
+                track.numDragSamples = 0;
+                break;
+            case COOP_DRAG:
+                board.drag(c.x, c.y, c.pointer);
+                track.dragSampledNs = c.sampledNs;
+                track.dragSamples[track.numDragSamples++ % FLICK_SAMPLES] = { glm::vec2(c.x, c.y), c.sampledNs };
+                break;
+            case COOP_ROTATE:
+                board.rotate(c.x, c.pointer);
+                break;
+            case COOP_RELEASE:
+                board.release(c.left ? glm::vec2(0.0f) : flickVelocity(track, c.sampledNs), c.pointer);
+                break;
+            default:
+                break;
+        }
+    }
+    room->inbox.clear();
+    board.advance(1.0f / COOP_TICK_HZ);
+    board.settle();
+
+    room->frame.clear();
+    size_t frame = beginFrame(room->frame, COOP_STATE);
+    putU64(room->frame, ticks);
+    if (room->stream.encode(board, room->frame)) {
+        endFrame(room->frame, frame);
+    } else {
+        room->frame.clear();
+    }
+    room->whole.clear();
+    if (room->welcoming) {
+        frame = beginFrame(room->whole, COOP_STATE);
+        putU64(room->whole, ticks);
+        room->stream.keyframe(room->whole);
+        endFrame(room->whole, frame);
+    }
+}
+
+void CoopServer::write(Player* player) {
+    while (player->fd >= 0 && player->sent < player->out.size()) {
+        ssize_t n = send(player->fd, &player->out[player->sent], player->out.size() - player->sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                drop(player);
+                return;
+            }
+            break; // the socket is full: the rest goes with the next tick
+        }
+        player->sent += n;
+        bytesSent += n;
+    }
+    if (player->sent == player->out.size()) {
+        player->out.clear();
+        player->sent = 0;
+    } else if (player->out.size() - player->sent > COOP_MAX_BACKLOG) {
+        std::cout << "[ERROR] dropping a co-op player " << player->out.size() - player->sent << " bytes behind"
+                  << std::endl;
+        drop(player);
+    } else if (player->sent > player->out.size() / 2) {
+        player->out.erase(player->out.begin(), player->out.begin() + player->sent);
+        player->sent = 0;
+    }
+}
@@ -0,0 +1,116 @@
+/*
+COOP SERVER
+
+A headless, authoritative host for many co-op rooms at once (see CO-OP for the protocol). One thread owns every
+socket: it waits on epoll for connections and input until the next tick, and files each player's pointer input in
+the order it arrived with the room it is for. Every COOP_TICK_HZ tick then runs each room's board like the game's
+simulation does (the queued input applied in order, thrown pieces moved on by one step, push apart settled), on
+the job system, a block of rooms per job. Each room encodes what changed into its own buffer as a STATE STREAM
+delta (Board::capture keeps a dirty list, so an idle room costs next to nothing) and the socket thread hands that one
+frame to every player of the room, or a keyframe to one that just joined, then writes out as much as each socket
+takes. A player is refused once all of a room's MAX_POINTERS pointers are taken, and dropped when what it has not
+read passes COOP_MAX_BACKLOG.
+
+Rooms are created by the first player to join them, from the board the player asked for, and deleted when the last
+player leaves. A new room's board is set up and scrambled in a job, so a large one does not hold up every other
+room's sockets; players may join it and send input meanwhile, and it joins the ticks (welcoming them all) from the
+first tick that finds it ready. A player that leaves mid-drag lets go of its group where it was.
+ */
+#ifndef PUZZLEGL_COOP_SERVER_H
+#define PUZZLEGL_COOP_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "board.h"
+#include "coop.h"
+#include "glide.h"
+#include "job_system.h"
+#include "state_stream.h"
+
+const unsigned int COOP_TICK_HZ = 30;
+const size_t COOP_MAX_BACKLOG = 1 << 24;     // bytes a player may fall behind by before it is dropped
+const unsigned int COOP_MAX_PIECES = 100000; // boards larger than this are refused
+const unsigned int COOP_TICK_SAMPLES = 4096; // tick times kept for the statistics, the latest ones
+
+struct CoopServerStats {
+    unsigned long long ticks;
+    unsigned int rooms, players;
+    unsigned long long bytesSent;
+    double meanTick, p99Tick, worstTick; // seconds of work per tick, over the latest COOP_TICK_SAMPLES
+};
+
+class CoopServer {
+public:
+    CoopServer();
+    ~CoopServer();
+
+    bool listen(const char* address);
+    // serves until stop() is called (from any thread)
+    void run();
+    void stop() { stopping = true; }
+    // only while run() is not running
+    void stats(CoopServerStats& out) const;
+
+private:
+    CoopServer(const CoopServer&);
+    CoopServer& operator=(const CoopServer&);
+
+    struct Room;
+
+    struct Player {
+        int fd;
+        Room* room;
+        int pointer;
+        bool welcomed;
+        std::vector<unsigned char> in, out;
+        size_t sent; // of out
+    };
+
+    struct Command {
+        CoopMessage type;
+        int pointer;
+        float x, y;
+        int64_t sampledNs;
+        bool left; // a release because the player left: let go without a throw
+    };
+
+    struct Room {
+        uint32_t id;
+        Board board;
+        std::vector<Player*> players;
+        uint32_t freePointers;          // bit per pointer
+        std::vector<Command> inbox;     // in the order it arrived, applied by the next tick
+        PointerTrack tracks[MAX_POINTERS];
+        StateEncoder stream;            // the only one to capture the board
+        std::vector<unsigned char> frame; // this tick's changes, for the players already welcomed
+        std::vector<unsigned char> whole; // the whole board, for the players welcomed this tick
+        bool welcoming;                   // a player joined since the last tick
+        JobHandle setup;                  // setting up the board, until the tick that finds it finished
+    };
+
+    void accept();
+    void read(Player* player);
+    bool handle(Player* player, CoopMessage type, CoopReader& payload);
+    void join(Player* player, CoopReader& payload);
+    void drop(Player* player);
+    void tick();
+    void step(Room* room);
+    void write(Player* player);
+
+    int listener;
+    int epoll;
+    std::atomic<bool> stopping;
+    uint64_t ticks;
+    std::unordered_map<uint32_t, Room*> roomsById;
+    std::vector<Room*> rooms;
+    std::vector<Room*> unready; // their board is still being set up: not ticked yet
+    std::vector<Player*> players;
+    std::vector<Player*> dropped; // closed this tick, deleted after it
+    unsigned long long bytesSent;
+    std::vector<float> tickTimes; // a ring of the latest COOP_TICK_SAMPLES
+};
+
+#endif //PUZZLEGL_COOP_SERVER_H
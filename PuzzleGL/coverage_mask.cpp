@@ -0,0 +1,89 @@
+#include "coverage_mask.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// an outline running within this fraction of a cell along the cell's border does not count as crossing it, so a
+// rectangle's mask is all inside rather than all edge
+const float BORDER_SLACK = 1e-4f;
+const unsigned int MAX_CROSSINGS = 16; // per row; far more than a piece outline has
+const uint32_t INSIDE_CELLS = 0x55555555u; // COVERAGE_INSIDE in every cell of a row
+
+// the first and last cell (or row) whose interior, less the slack, meets [lo, hi]; lo == hi for a side level with
+// the axis
+void cellSpan(float lo, float hi, int& first, int& last) {
+    first = std::max(0, (int)std::floor(lo + BORDER_SLACK));
+    last = std::min(COVERAGE_MASK_SIZE - 1, (int)std::ceil(hi - BORDER_SLACK) - 1);
+    if (lo == hi && (lo - std::floor(lo) <= BORDER_SLACK || std::ceil(lo) - lo <= BORDER_SLACK)) {
+        last = first - 1; // level with a cell border
+    }
+}
+
+// cells first..last of a row set to coverage (COVERAGE_INSIDE or COVERAGE_EDGE)
+uint32_t cellRange(int first, int last, Coverage coverage) {
+    first = std::max(first, 0);
+    last = std::min(last, COVERAGE_MASK_SIZE - 1);
+    if (first > last) {
+        return 0;
+    }
+    uint32_t bits = last == COVERAGE_MASK_SIZE - 1 ? ~0u : (1u << (2 * (last + 1))) - 1;
+    return (bits & ~((1u << (2 * first)) - 1)) & (INSIDE_CELLS * coverage);
+}
+
+} // namespace
+
+void buildCoverageMask(const glm::vec2* outline, unsigned int n, glm::vec2 lo, glm::vec2 hi, CoverageMask& mask) {
+    const int S = COVERAGE_MASK_SIZE;
+    mask.origin = lo;
+    mask.scale = (float)S / glm::max(hi - lo, glm::vec2(1e-12f));
+    uint32_t edge[COVERAGE_MASK_SIZE] = {};
+    float crossings[COVERAGE_MASK_SIZE][MAX_CROSSINGS]; // where the outline crosses each row's middle
+    unsigned int numCrossings[COVERAGE_MASK_SIZE] = {};
+
+    // in cell units, side by side: mark every cell the side passes through, and note where it crosses the middle
+    // of the rows it spans
+    for (unsigned int i = 0; i < n; ++i) {
+        glm::vec2 p = (outline[i] - lo) * mask.scale, q = (outline[(i + 1) % n] - lo) * mask.scale;
+        int firstRow, lastRow;
+        cellSpan(std::min(p.y, q.y), std::max(p.y, q.y), firstRow, lastRow);
+        for (int r = firstRow; r <= lastRow; ++r) {
+            float middle = r + 0.5f;
+            if ((p.y > middle) != (q.y > middle) && numCrossings[r] < MAX_CROSSINGS) {
+                crossings[r][numCrossings[r]++] = p.x + (middle - p.y) * (q.x - p.x) / (q.y - p.y);
+            }
+            // the part of the side inside the row
+            float x0 = p.x, x1 = q.x;
+            if (q.y != p.y) {
+                x0 = p.x + (q.x - p.x) * glm::clamp((r - p.y) / (q.y - p.y), 0.0f, 1.0f);
+                x1 = p.x + (q.x - p.x) * glm::clamp((r + 1 - p.y) / (q.y - p.y), 0.0f, 1.0f);
+            }
+            int first, last;
+            cellSpan(std::min(x0, x1), std::max(x0, x1), first, last);
+            edge[r] |= cellRange(first, last, COVERAGE_EDGE);
+        }
+    }
+
+    // the other cells are wholly in or out: in when their centers lie between an odd crossing and the next
+    for (int r = 0; r < S; ++r) {
+        std::sort(crossings[r], crossings[r] + numCrossings[r]);
+        uint32_t inside = 0;
+        for (unsigned int k = 0; k + 1 < numCrossings[r]; k += 2) {
+            inside |= cellRange((int)std::ceil(crossings[r][k] - 0.5f), (int)std::ceil(crossings[r][k + 1] - 0.5f) - 1,
+                                COVERAGE_INSIDE);
+        }
+        mask.rows[r] = edge[r] | (inside & ~(edge[r] >> 1));
+    }
+}
+
+bool insideOutline(const glm::vec2* outline, unsigned int n, glm::vec2 p) {
+    bool inside = false;
+    for (unsigned int i = 0, j = n - 1; i < n; j = i++) {
+        glm::vec2 a = outline[i], b = outline[j];
+        if ((a.y > p.y) != (b.y > p.y) && p.x < a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y)) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
@@ -0,0 +1,46 @@
+/*
+COVERAGE MASK
+
+Constant-time point-in-piece tests. A mask splits a piece's bounding box into COVERAGE_MASK_SIZE x
+COVERAGE_MASK_SIZE cells and records, two bits per cell, whether the cell lies wholly inside the outline, wholly
+outside it, or is crossed by it. A pick that lands in an inside or outside cell is answered by that one lookup;
+only the cells the outline passes through fall back to the exact polygon test, so the answer is exact and nearly
+always costs one load and a shift, however many corners the outline has (or will have, once pieces get tabs and
+blanks).
+
+The mask only depends on the outline, so every piece cut to the same shape shares one: a grid board needs one mask,
+hex and triangle boards a handful, a Voronoi board one per piece (80 bytes each).
+ */
+#ifndef PUZZLEGL_COVERAGE_MASK_H
+#define PUZZLEGL_COVERAGE_MASK_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+const int COVERAGE_MASK_SIZE = 16; // cells per side; a row of two-bit cells fills one uint32_t
+
+enum Coverage {
+    COVERAGE_OUTSIDE = 0,
+    COVERAGE_INSIDE = 1,
+    COVERAGE_EDGE = 2 // the outline crosses the cell: ask insideOutline
+};
+
+struct CoverageMask {
+    glm::vec2 origin; // lower left corner of the bounding box, in the outline's coordinates
+    glm::vec2 scale;  // cells per unit
+    uint32_t rows[COVERAGE_MASK_SIZE]; // bottom row first, two bits per cell, leftmost cell in the low bits
+
+    // points outside the bounding box get the nearest border cell
+    Coverage at(glm::vec2 p) const {
+        glm::vec2 c = (p - origin) * scale;
+        int x = glm::clamp((int)c.x, 0, COVERAGE_MASK_SIZE - 1), y = glm::clamp((int)c.y, 0, COVERAGE_MASK_SIZE - 1);
+        return (Coverage)((rows[y] >> (2 * x)) & 3);
+    }
+};
+
+// the mask of a closed outline (any simple polygon, either winding) inside the box [lo, hi]
+void buildCoverageMask(const glm::vec2* outline, unsigned int n, glm::vec2 lo, glm::vec2 hi, CoverageMask& mask);
+// the exact test: whether p is inside the outline (even-odd rule)
+bool insideOutline(const glm::vec2* outline, unsigned int n, glm::vec2 p);
+
+#endif //PUZZLEGL_COVERAGE_MASK_H
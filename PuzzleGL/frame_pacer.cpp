@@ -0,0 +1,96 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace sc = std::chrono;
+
+static const sc::microseconds MIN_MARGIN(200);
+static const sc::microseconds MAX_MARGIN(4000);
+
+const char* pacingModeName(PacingMode mode) {
+    switch (mode) {
+        case PACING_VSYNC: return "vsync";
+        case PACING_ADAPTIVE: return "adaptive vsync";
+        case PACING_CAPPED: return "capped";
+        case PACING_UNCAPPED: return "uncapped";
+        default: return "?";
+    }
+}
+
+FramePacer::FramePacer()
+    : pacing(PACING_VSYNC), target(60.0f), period(sc::nanoseconds(1000000000 / 60)), margin(sc::milliseconds(1)),
+      lastSwap(clock::now()), reported(lastSwap) {
+    deadline = lastSwap;
+}
+
+void FramePacer::setMode(PacingMode mode, float targetFps) {
+    pacing = mode;
+    target = std::max(targetFps, 1.0f);
+    period = sc::duration_cast<clock::duration>(sc::duration<double>(1.0 / target));
+    reset(); // the new mode's numbers start from scratch
+}
+
+void FramePacer::reset() {
+    lastSwap = reported = deadline = clock::now();
+    frameTimes.clear();
+}
+
+int FramePacer::swapInterval(bool tearControl) const {
+    switch (pacing) {
+        case PACING_VSYNC: return 1;
+        case PACING_ADAPTIVE: return tearControl ? -1 : 1;
+        default: return 0;
+    }
+}
+
+void FramePacer::wait() {
+    if (pacing != PACING_CAPPED) {
+        return;
+    }
+    deadline += period;
+    auto now = clock::now();
+    if (deadline < now) {
+        deadline = now; // missed it: start counting again from here rather than rushing frames to catch up
+        return;
+    }
+    if (deadline - now > margin) {
+        auto wake = deadline - margin;
+        std::this_thread::sleep_until(wake);
+        // keep the margin a little over how late sleeps have been ending lately
+        auto late = clock::now() - wake;
+        margin = std::min<clock::duration>(std::max<clock::duration>((margin * 7 + late * 2) / 8, MIN_MARGIN), MAX_MARGIN);
+    }
+    while (clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void FramePacer::frameDone() {
+    auto now = clock::now();
+    frameTimes.push_back(sc::duration<float>(now - lastSwap).count());
+    lastSwap = now;
+}
+
+bool FramePacer::report(float periodSeconds, FrameTimeStats& stats) {
+    auto now = clock::now();
+    if (frameTimes.empty() || sc::duration<float>(now - reported).count() < periodSeconds) {
+        return false;
+    }
+    double sum = 0, sumSquares = 0;
+    for (float t : frameTimes) {
+        sum += t;
+        sumSquares += (double)t * t;
+    }
+    stats.frames = frameTimes.size();
+    stats.mean = sum / stats.frames;
+    stats.stddev = std::sqrt(std::max(sumSquares / stats.frames - stats.mean * stats.mean, 0.0));
+    auto p99 = frameTimes.begin() + (frameTimes.size() - 1) * 99 / 100;
+    std::nth_element(frameTimes.begin(), p99, frameTimes.end());
+    stats.p99 = *p99;
+    stats.worst = *std::max_element(p99, frameTimes.end());
+    frameTimes.clear();
+    reported = now;
+    return true;
+}
@@ -0,0 +1,69 @@
+/*
+FRAME PACER
+
+Decides how frames are paced instead of leaving it to the driver's default swap interval:
+
+- VSYNC:    swap interval 1, the display paces the loop;
+- ADAPTIVE: swap interval -1 where the driver has swap_control_tear (late frames tear instead of waiting a whole
+            refresh), 1 otherwise;
+- CAPPED:   swap interval 0, the loop waits for a target frame rate itself: it sleeps until shortly before the
+            deadline and spins the rest, the sleep margin following how late the OS has been waking it up;
+- UNCAPPED: swap interval 0 and no wait, to measure how much headroom a machine has.
+
+Every mode records frame times (swap to swap) so the modes can be compared on the same machine: mean, standard
+deviation, 99th percentile and worst over each report period.
+ */
+#ifndef PUZZLEGL_FRAME_PACER_H
+#define PUZZLEGL_FRAME_PACER_H
+
+#include <chrono>
+#include <vector>
+
+enum PacingMode {
+    PACING_VSYNC = 0,
+    PACING_ADAPTIVE = 1,
+    PACING_CAPPED = 2,
+    PACING_UNCAPPED = 3,
+    PACING_MODE_COUNT
+};
+
+const char* pacingModeName(PacingMode mode);
+
+struct FrameTimeStats {
+    unsigned int frames;
+    double mean, stddev, p99, worst; // seconds
+};
+
+class FramePacer {
+public:
+    FramePacer();
+
+    void setMode(PacingMode mode, float targetFps);
+    PacingMode mode() const { return pacing; }
+    float targetFps() const { return target; }
+    // forget the frames so far, e.g. after a deliberate pause
+    void reset();
+    // for glfwSwapInterval
+    int swapInterval(bool tearControl) const;
+
+    // CAPPED: blocks until the next frame is due; call before sampling input so the frame starts from fresh input
+    void wait();
+    // after the swap: records the time since the previous one
+    void frameDone();
+    // every periodSeconds, the frame times since the last report; false until then
+    bool report(float periodSeconds, FrameTimeStats& stats);
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    PacingMode pacing;
+    float target;
+    clock::duration period;
+    clock::time_point deadline;
+    clock::duration margin;      // slept this much short of the deadline and spun the rest
+    clock::time_point lastSwap;
+    clock::time_point reported;
+    std::vector<float> frameTimes; // since the last report
+};
+
+#endif //PUZZLEGL_FRAME_PACER_H
@@ -0,0 +1,56 @@
+#include "frame_tasks.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace sc = std::chrono;
+
+FrameTaskScheduler::FrameTaskScheduler() : totals(FrameTaskStats()) {
+}
+
+void FrameTaskScheduler::add(std::function<FrameStep()> step) {
+    if (tasks.empty()) {
+        totals = FrameTaskStats();
+    }
+    Task t = { std::move(step), 0.0 };
+    tasks.push_back(std::move(t));
+}
+
+bool FrameTaskScheduler::run(double budgetSeconds) {
+    if (tasks.empty()) {
+        return false;
+    }
+    auto start = sc::steady_clock::now();
+    auto deadline = start + sc::duration_cast<sc::steady_clock::duration>(sc::duration<double>(budgetSeconds));
+    bool ran = false;
+    size_t next = 0; // tasks before it are blocked for this frame
+    while (next < tasks.size()) {
+        Task& t = tasks[next];
+        auto before = sc::steady_clock::now();
+        if (ran && before + sc::duration_cast<sc::steady_clock::duration>(sc::duration<double>(t.estimate)) > deadline) {
+            break;
+        }
+        FrameStep result = t.step();
+        if (result == FRAME_STEP_BLOCKED) {
+            ++next; // a step that did nothing says nothing about how long the next one takes
+            continue;
+        }
+        double took = sc::duration<double>(sc::steady_clock::now() - before).count();
+        // a slow step counts at once, fast ones only bring the estimate down gradually
+        t.estimate = std::max(took, (t.estimate * 3 + took) / 4);
+        totals.steps++;
+        ran = true;
+        if (result == FRAME_STEP_DONE) {
+            tasks.erase(tasks.begin() + next);
+        }
+    }
+    double spent = sc::duration<double>(sc::steady_clock::now() - start).count();
+    totals.frames++;
+    totals.seconds += spent;
+    totals.worstFrame = std::max(totals.worstFrame, spent);
+    return tasks.empty();
+}
+
+void FrameTaskScheduler::clear() {
+    tasks.clear();
+}
@@ -0,0 +1,57 @@
+/*
+FRAME TASKS
+
+Work that has to run on the GL thread (texture uploads, anything else that needs the context) but is too big for
+one frame. A task is a step function called again and again until it reports that it is done; the scheduler runs
+steps in submission order after the frame's draw calls, for as long as a per-frame budget allows, so a big job is
+spread over as many frames as it takes instead of stalling one.
+
+A step is only started when the time it is expected to take (what the task's recent steps took) still fits in
+what is left of the budget, so steps should be small compared to the budget. One step runs every frame regardless,
+so a task whose steps never fit still makes progress. A step that cannot do anything yet (waiting on a job) says
+it is blocked: the task's turn ends for this frame, its estimate is left alone and the tasks behind it run.
+ */
+#ifndef PUZZLEGL_FRAME_TASKS_H
+#define PUZZLEGL_FRAME_TASKS_H
+
+#include <deque>
+#include <functional>
+
+enum FrameStep {
+    FRAME_STEP_MORE,   // did some work, there is more to do
+    FRAME_STEP_DONE,   // did the last of the work
+    FRAME_STEP_BLOCKED // did nothing, try again next frame
+};
+
+struct FrameTaskStats {
+    unsigned int frames;  // frames that ran steps since the queue was last empty
+    unsigned int steps;
+    double seconds;       // spent in steps
+    double worstFrame;    // most spent in one frame
+};
+
+class FrameTaskScheduler {
+public:
+    FrameTaskScheduler();
+
+    void add(std::function<FrameStep()> step);
+    // runs steps until budgetSeconds is used up or the queue is empty; true if this emptied the queue
+    bool run(double budgetSeconds);
+    bool empty() const { return tasks.empty(); }
+    // drops every queued task
+    void clear();
+
+    // since the queue was last empty
+    const FrameTaskStats& stats() const { return totals; }
+
+private:
+    struct Task {
+        std::function<FrameStep()> step;
+        double estimate; // seconds a step is expected to take
+    };
+
+    std::deque<Task> tasks;
+    FrameTaskStats totals;
+};
+
+#endif //PUZZLEGL_FRAME_TASKS_H
@@ -0,0 +1,110 @@
+#include "glide.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void Glide::reset(unsigned int count) {
+    x.clear();
+    y.clear();
+    vx.clear();
+    vy.clear();
+    ids.clear();
+    slotOf.assign(count, -1);
+}
+
+void Glide::add(unsigned int id, glm::vec2 position, glm::vec2 velocity) {
+    if (!moving(id)) {
+        slotOf[id] = ids.size();
+        ids.push_back(id);
+        x.push_back(0);
+        y.push_back(0);
+        vx.push_back(0);
+        vy.push_back(0);
+    }
+    int slot = slotOf[id];
+    x[slot] = position.x;
+    y[slot] = position.y;
+    vx[slot] = velocity.x;
+    vy[slot] = velocity.y;
+}
+
+void Glide::remove(unsigned int id) {
+    if (!moving(id)) {
+        return;
+    }
+    int slot = slotOf[id];
+    unsigned int last = ids.size() - 1;
+    x[slot] = x[last];
+    y[slot] = y[last];
+    vx[slot] = vx[last];
+    vy[slot] = vy[last];
+    ids[slot] = ids[last];
+    slotOf[ids[slot]] = slot;
+    slotOf[id] = -1;
+    x.pop_back();
+    y.pop_back();
+    vx.pop_back();
+    vy.pop_back();
+    ids.pop_back();
+}
+
+void Glide::step(float dt, float extent, std::vector<unsigned int>& rested) {
+    unsigned int n = ids.size(), i = 0;
+    float damping = std::exp(-GLIDE_FRICTION * dt), rest = GLIDE_REST_SPEED * GLIDE_REST_SPEED;
+#if defined(__SSE2__)
+    const __m128 step = _mm_set1_ps(dt), slow = _mm_set1_ps(damping), still = _mm_set1_ps(rest);
+    const __m128 lo = _mm_set1_ps(-extent), hi = _mm_set1_ps(extent);
+    for (; i + 4 <= n; i += 4) {
+        __m128 px = _mm_add_ps(_mm_loadu_ps(&x[i]), _mm_mul_ps(_mm_loadu_ps(&vx[i]), step));
+        __m128 py = _mm_add_ps(_mm_loadu_ps(&y[i]), _mm_mul_ps(_mm_loadu_ps(&vy[i]), step));
+        __m128 cx = _mm_min_ps(_mm_max_ps(px, lo), hi), cy = _mm_min_ps(_mm_max_ps(py, lo), hi);
+        // against the border the velocity across it is gone
+        __m128 ux = _mm_and_ps(_mm_mul_ps(_mm_loadu_ps(&vx[i]), slow), _mm_cmpeq_ps(px, cx));
+        __m128 uy = _mm_and_ps(_mm_mul_ps(_mm_loadu_ps(&vy[i]), slow), _mm_cmpeq_ps(py, cy));
+        _mm_storeu_ps(&x[i], cx);
+        _mm_storeu_ps(&y[i], cy);
+        _mm_storeu_ps(&vx[i], ux);
+        _mm_storeu_ps(&vy[i], uy);
+        int stopped = _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(ux, ux), _mm_mul_ps(uy, uy)), still));
+        for (int k = 0; stopped != 0; ++k, stopped >>= 1) {
+            if (stopped & 1) {
+                rested.push_back(ids[i + k]);
+            }
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        float px = x[i] + vx[i] * dt, py = y[i] + vy[i] * dt;
+        x[i] = std::fmin(std::fmax(px, -extent), extent);
+        y[i] = std::fmin(std::fmax(py, -extent), extent);
+        vx[i] = x[i] == px ? vx[i] * damping : 0.0f;
+        vy[i] = y[i] == py ? vy[i] * damping : 0.0f;
+        if (vx[i] * vx[i] + vy[i] * vy[i] < rest) {
+            rested.push_back(ids[i]);
+        }
+    }
+}
+
+glm::vec2 flickVelocity(const PointerTrack& track, int64_t releasedNs) {
+    unsigned int count = std::min(track.numDragSamples, FLICK_SAMPLES);
+    if (count < 2) {
+        return glm::vec2(0.0f);
+    }
+    const DragSample& last = track.dragSamples[(track.numDragSamples - 1) % FLICK_SAMPLES];
+    const DragSample* first = &last;
+    for (unsigned int k = 2; k <= count; ++k) {
+        const DragSample& s = track.dragSamples[(track.numDragSamples - k) % FLICK_SAMPLES];
+        if (releasedNs - s.sampledNs > FLICK_WINDOW_NS) {
+            break;
+        }
+        first = &s;
+    }
+    if (releasedNs - last.sampledNs > FLICK_WINDOW_NS || last.sampledNs <= first->sampledNs) {
+        return glm::vec2(0.0f);
+    }
+    return (last.at - first->at) / ((last.sampledNs - first->sampledNs) * 1e-9f);
+}
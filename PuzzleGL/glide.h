@@ -0,0 +1,65 @@
+/*
+GLIDE
+
+Pieces (or groups, through one of their pieces) that were thrown and are sliding to a stop. Every body's position
+and velocity lives in a structure of arrays, so one fixed step is a single pass of 4-wide SSE arithmetic over flat
+float arrays (with a scalar loop for the tail and for targets without SSE2): move by velocity, stop against the
+table's border, slow down by friction, and note which bodies came to rest. Adding, removing and finding a body is
+O(1); removing swaps the last body into the freed slot.
+
+How fast a throw starts is measured from the pointer's last few drag samples, kept in a small ring per pointer by
+whoever feeds the board pointer input (the simulation, the co-op server).
+ */
+#ifndef PUZZLEGL_GLIDE_H
+#define PUZZLEGL_GLIDE_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+const float GLIDE_FRICTION = 4.0f;     // speed lost per second, as a fraction: v(t) = v0 * exp(-friction * t)
+const float GLIDE_REST_SPEED = 0.02f;  // world units per second below which a body stops
+const unsigned int FLICK_SAMPLES = 8;        // pointer positions a throw's velocity is measured over
+const int64_t FLICK_WINDOW_NS = 60000000;    // of which only those this recent before the release count
+
+struct DragSample {
+    glm::vec2 at;
+    int64_t sampledNs;
+};
+
+struct PointerTrack {
+    int64_t dragSampledNs;
+    DragSample dragSamples[FLICK_SAMPLES]; // the latest pointer positions of the drag, a ring
+    unsigned int numDragSamples;
+};
+
+// how fast the pointer was moving when it let go: over the drag samples of the last FLICK_WINDOW_NS, or not at all
+// if it had stopped
+glm::vec2 flickVelocity(const PointerTrack& track, int64_t releasedNs);
+
+class Glide {
+public:
+    // no bodies, ids 0..count-1
+    void reset(unsigned int count);
+    // starts the body sliding, or changes the velocity it slides with
+    void add(unsigned int id, glm::vec2 position, glm::vec2 velocity);
+    void remove(unsigned int id);
+    bool moving(unsigned int id) const { return id < slotOf.size() && slotOf[id] >= 0; }
+    unsigned int size() const { return ids.size(); }
+
+    // one fixed step of dt seconds inside [-extent, extent]; bodies that came to rest are appended to rested, and
+    // stay in place until removed
+    void step(float dt, float extent, std::vector<unsigned int>& rested);
+    // the body in slot i, 0 <= i < size()
+    unsigned int id(unsigned int i) const { return ids[i]; }
+    glm::vec2 position(unsigned int i) const { return glm::vec2(x[i], y[i]); }
+    // where the body with this id is
+    glm::vec2 positionOf(unsigned int id) const { return position(slotOf[id]); }
+
+private:
+    std::vector<float> x, y, vx, vy;
+    std::vector<uint32_t> ids;
+    std::vector<int> slotOf; // per id, -1 while not moving
+};
+
+#endif //PUZZLEGL_GLIDE_H
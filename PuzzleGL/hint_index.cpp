@@ -0,0 +1,76 @@
+#include "hint_index.h"
+
+void HintIndex::reset(unsigned int count) {
+    heap.clear();
+    gaps.assign(count, 0.0f);
+    slotOf.assign(count, -1);
+}
+
+void HintIndex::set(unsigned int edge, float gap) {
+    if (slotOf[edge] < 0) {
+        gaps[edge] = gap;
+        heap.push_back(edge);
+        slotOf[edge] = heap.size() - 1;
+        siftUp(heap.size() - 1);
+        return;
+    }
+    float old = gaps[edge];
+    gaps[edge] = gap;
+    if (gap < old) {
+        siftUp(slotOf[edge]);
+    } else {
+        siftDown(slotOf[edge]);
+    }
+}
+
+void HintIndex::remove(unsigned int edge) {
+    int at = slotOf[edge];
+    if (at < 0) {
+        return;
+    }
+    slotOf[edge] = -1;
+    unsigned int last = heap.back();
+    heap.pop_back();
+    if ((unsigned int)at == heap.size()) {
+        return;
+    }
+    // the last edge takes the hole and moves whichever way its gap requires
+    put(at, last);
+    siftUp(at);
+    siftDown(slotOf[last]);
+}
+
+void HintIndex::siftUp(unsigned int at) {
+    unsigned int edge = heap[at];
+    while (at > 0) {
+        unsigned int parent = (at - 1) / 2;
+        if (gaps[heap[parent]] <= gaps[edge]) {
+            break;
+        }
+        put(at, heap[parent]);
+        at = parent;
+    }
+    put(at, edge);
+}
+
+void HintIndex::siftDown(unsigned int at) {
+    unsigned int edge = heap[at];
+    unsigned int size = heap.size();
+    while (2 * at + 1 < size) {
+        unsigned int child = 2 * at + 1;
+        if (child + 1 < size && gaps[heap[child + 1]] < gaps[heap[child]]) {
+            ++child;
+        }
+        if (gaps[edge] <= gaps[heap[child]]) {
+            break;
+        }
+        put(at, heap[child]);
+        at = child;
+    }
+    put(at, edge);
+}
+
+void HintIndex::put(unsigned int at, unsigned int edge) {
+    heap[at] = edge;
+    slotOf[edge] = at;
+}
@@ -0,0 +1,36 @@
+/*
+HINT INDEX
+
+Keeps every open edge of the board (two pieces that belong next to each other but are not grouped yet) in an
+indexed binary min-heap keyed by how far apart the pair currently lies. The pair closest to snapping is the root,
+so a hint is O(1); moving a piece re-keys only its own edges in O(log n) each, and the board defers even that
+until the next hint so drags pay nothing.
+ */
+#ifndef PUZZLEGL_HINT_INDEX_H
+#define PUZZLEGL_HINT_INDEX_H
+
+#include <vector>
+
+class HintIndex {
+public:
+    // no edges yet, ids 0..count-1
+    void reset(unsigned int count);
+    // insert the edge, or re-key it if present
+    void set(unsigned int edge, float gap);
+    void remove(unsigned int edge);
+
+    bool empty() const { return heap.empty(); }
+    unsigned int closest() const { return heap.front(); }
+    float closestGap() const { return gaps[heap.front()]; }
+
+private:
+    void siftUp(unsigned int at);
+    void siftDown(unsigned int at);
+    void put(unsigned int at, unsigned int edge);
+
+    std::vector<unsigned int> heap; // edge ids, smallest gap first
+    std::vector<float> gaps;        // per edge id
+    std::vector<int> slotOf;        // per edge id, index in heap or -1
+};
+
+#endif //PUZZLEGL_HINT_INDEX_H
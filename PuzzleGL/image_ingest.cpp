@@ -0,0 +1,396 @@
+#include "image_ingest.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <jpeglib.h>
+}
+
+#include "level_bundle.h"
+#include "stb_image.h"
+#include "tile_layout.h"
+
+const unsigned int INGEST_STRIP_ROWS = 32;
+const unsigned int INGEST_QUEUE_STRIPS = 4; // strips in flight between the decoder and the pyramid thread
+
+namespace {
+
+// one mip level of the pyramid: the scanlines of the tile row currently being assembled
+struct PyramidLevel {
+    unsigned int width;
+    unsigned int height;
+    unsigned int firstRow;  // picture row held in rows[0]
+    unsigned int rowsHeld;
+    unsigned int rowsSeen;
+    unsigned int nextTileRow;
+    std::vector<unsigned char> rows;    // up to TILE_SLOT_SIZE scanlines
+    std::vector<unsigned char> pending; // even scanline waiting for its partner before it is filtered down
+    std::vector<unsigned char> reduced; // the filtered scanline handed to the next level
+};
+
+class Pyramid {
+public:
+    Pyramid(unsigned int width, unsigned int height, unsigned int numMips, TileSink& sink);
+    bool pushRow(const unsigned char* row) { return push(0, row); }
+    bool finish();
+    size_t bufferBytes() const;
+
+    unsigned int tiles;
+
+private:
+    bool push(unsigned int level, const unsigned char* row);
+    bool emitTileRow(unsigned int level);
+
+    std::vector<PyramidLevel> levels;
+    std::vector<unsigned char> tile;
+    TileSink& sink;
+};
+
+Pyramid::Pyramid(unsigned int width, unsigned int height, unsigned int numMips, TileSink& sink)
+        : tiles(0), levels(numMips), tile(TILE_BYTES), sink(sink) {
+    for (unsigned int m = 0; m < numMips; ++m) {
+        PyramidLevel& L = levels[m];
+        L.width = mipSize(width, m);
+        L.height = mipSize(height, m);
+        L.firstRow = L.rowsHeld = L.rowsSeen = L.nextTileRow = 0;
+        L.rows.resize((size_t)L.width * 4 * TILE_SLOT_SIZE);
+        L.pending.resize((size_t)L.width * 4);
+        L.reduced.resize((size_t)mipSize(L.width, 1) * 4);
+    }
+}
+
+size_t Pyramid::bufferBytes() const {
+    size_t bytes = tile.size();
+    for (auto &L : levels) {
+        bytes += L.rows.size() + L.pending.size() + L.reduced.size();
+    }
+    return bytes;
+}
+
+bool Pyramid::push(unsigned int level, const unsigned char* row){
+    PyramidLevel& L = levels[level];
+    size_t rowBytes = (size_t)L.width * 4;
+    if (L.rowsSeen == L.height) {
+        return true; // the decoder may round up; anything past the picture is ignored
+    }
+    memcpy(&L.rows[L.rowsHeld * rowBytes], row, rowBytes);
+    unsigned int r = L.rowsSeen++;
+    ++L.rowsHeld;
+
+    // a tile row is complete once its bottom border scanline (or the last scanline of the picture) is in; a short
+    // last tile row can complete on the same scanline as the one above it
+    while (L.nextTileRow < tilesAcross(L.height, 0)
+           && r >= std::min(L.nextTileRow * TILE_CONTENT + TILE_CONTENT, L.height - 1)) {
+        if (!emitTileRow(level)) {
+            return false;
+        }
+        // the next tile row starts with this one's bottom border, so keep the overlapping scanlines
+        unsigned int keepFrom = L.nextTileRow * TILE_CONTENT - TILE_BORDER;
+        unsigned int keep = (r + 1 > keepFrom) ? r + 1 - keepFrom : 0;
+        memmove(&L.rows[0], &L.rows[(L.rowsHeld - keep) * rowBytes], keep * rowBytes);
+        L.rowsHeld = keep;
+        L.firstRow = r + 1 - keep;
+    }
+
+    if (level + 1 < levels.size()) {
+        if (r % 2 == 0) {
+            memcpy(&L.pending[0], row, rowBytes);
+        } else {
+            downsampleRows(&L.pending[0], row, L.width, &L.reduced[0]);
+            return push(level + 1, &L.reduced[0]);
+        }
+    }
+    return true;
+}
+
+bool Pyramid::emitTileRow(unsigned int level){
+    PyramidLevel& L = levels[level];
+    unsigned int ty = L.nextTileRow++;
+    int y0 = (int)ty * TILE_CONTENT - TILE_BORDER;
+    for (unsigned int tx = 0; tx < tilesAcross(L.width, 0); ++tx) {
+        for (int y = 0; y < TILE_SLOT_SIZE; ++y) {
+            int sy = std::min(std::max(y0 + y, 0), (int)L.height - 1);
+            const unsigned char* src = &L.rows[(size_t)(sy - L.firstRow) * L.width * 4];
+            copyTileRow(src, L.width, tx, &tile[(size_t)y * TILE_SLOT_SIZE * 4]);
+        }
+        if (!sink.writeTile(level, tx, ty, &tile[0])) {
+            return false;
+        }
+        ++tiles;
+    }
+    return true;
+}
+
+bool Pyramid::finish(){
+    for (unsigned int m = 0; m < levels.size(); ++m) {
+        PyramidLevel& L = levels[m];
+        // a one scanline level still has to produce the (one scanline) level below it
+        if (L.height == 1 && L.rowsSeen == 1 && m + 1 < levels.size()) {
+            downsampleRows(&L.pending[0], &L.pending[0], L.width, &L.reduced[0]);
+            if (!push(m + 1, &L.reduced[0])) {
+                return false;
+            }
+        }
+        if (L.rowsSeen != L.height) {
+            std::cout << "[ERROR] Ingest: mip " << m << " received " << L.rowsSeen << " of " << L.height << " scanlines" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// strips handed from the decoder to the pyramid thread; a fixed pool bounds the memory in flight
+struct Strip {
+    std::vector<unsigned char> pixels;
+    unsigned int rows;
+};
+
+class StripQueue {
+public:
+    StripQueue(unsigned int count, size_t bytes) : pool(count), done(false), aborted(false) {
+        for (auto &s : pool) {
+            s.pixels.resize(bytes);
+            empty.push_back(&s);
+        }
+    }
+    Strip* acquire(){
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this]{ return !empty.empty() || aborted; });
+        if (aborted) return nullptr;
+        Strip* s = empty.front();
+        empty.pop_front();
+        return s;
+    }
+    void submit(Strip* s){
+        std::lock_guard<std::mutex> lock(mutex);
+        full.push_back(s);
+        cv.notify_all();
+    }
+    Strip* next(){
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this]{ return !full.empty() || done || aborted; });
+        if (full.empty() || aborted) return nullptr;
+        Strip* s = full.front();
+        full.pop_front();
+        return s;
+    }
+    void recycle(Strip* s){
+        std::lock_guard<std::mutex> lock(mutex);
+        empty.push_back(s);
+        cv.notify_all();
+    }
+    void finish(){
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        cv.notify_all();
+    }
+    void abort(){
+        std::lock_guard<std::mutex> lock(mutex);
+        aborted = true;
+        cv.notify_all();
+    }
+
+private:
+    std::vector<Strip> pool;
+    std::deque<Strip*> empty, full;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done, aborted;
+};
+
+struct JpegError {
+    jpeg_error_mgr pub;
+    jmp_buf jump;
+};
+
+void jpegErrorExit(j_common_ptr cinfo){
+    char message[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, message);
+    std::cout << "[ERROR] JPEG: " << message << std::endl;
+    longjmp(((JpegError*)cinfo->err)->jump, 1);
+}
+
+// decode scanlines into strips until the picture ends; runs on the calling thread
+bool decodeJpegStrips(jpeg_decompress_struct& cinfo, JpegError& err, StripQueue& queue){
+    std::vector<unsigned char> rgb; // only used when libjpeg cannot emit RGBA itself
+    if (setjmp(err.jump)) {
+        return false;
+    }
+    jpeg_start_decompress(&cinfo);
+    size_t rowBytes = (size_t)cinfo.output_width * 4;
+    if (cinfo.output_components == 3) {
+        rgb.resize((size_t)cinfo.output_width * 3);
+    }
+    while (cinfo.output_scanline < cinfo.output_height) {
+        Strip* strip = queue.acquire();
+        if (strip == nullptr) {
+            return false;
+        }
+        strip->rows = 0;
+        while (strip->rows < INGEST_STRIP_ROWS && cinfo.output_scanline < cinfo.output_height) {
+            unsigned char* out = &strip->pixels[strip->rows * rowBytes];
+            if (rgb.empty()) {
+                jpeg_read_scanlines(&cinfo, &out, 1);
+            } else {
+                unsigned char* in = &rgb[0];
+                jpeg_read_scanlines(&cinfo, &in, 1);
+                for (unsigned int x = 0; x < cinfo.output_width; ++x) {
+                    out[x * 4 + 0] = in[x * 3 + 0];
+                    out[x * 4 + 1] = in[x * 3 + 1];
+                    out[x * 4 + 2] = in[x * 3 + 2];
+                    out[x * 4 + 3] = 255;
+                }
+            }
+            ++strip->rows;
+        }
+        queue.submit(strip);
+    }
+    jpeg_finish_decompress(&cinfo);
+    return true;
+}
+
+bool ingestJpeg(FILE* file, unsigned int numMips, TileSink& sink, IngestStats& stats){
+    jpeg_decompress_struct cinfo;
+    JpegError err;
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = jpegErrorExit;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, file);
+    jpeg_read_header(&cinfo, TRUE);
+#ifdef JCS_EXTENSIONS
+    cinfo.out_color_space = JCS_EXT_RGBA;
+#else
+    cinfo.out_color_space = JCS_RGB;
+#endif
+    stats.width = cinfo.image_width;
+    stats.height = cinfo.image_height;
+    stats.progressive = jpeg_has_multiple_scans(&cinfo) != 0;
+
+    StripQueue queue(INGEST_QUEUE_STRIPS, (size_t)cinfo.image_width * 4 * INGEST_STRIP_ROWS);
+    Pyramid pyramid(cinfo.image_width, cinfo.image_height, numMips, sink);
+
+    // filtering and tile cutting overlap with decoding the next strips
+    bool pyramidOk = true;
+    std::thread cutter([&]{
+        while (Strip* strip = queue.next()) {
+            size_t rowBytes = (size_t)cinfo.image_width * 4;
+            for (unsigned int r = 0; r < strip->rows && pyramidOk; ++r) {
+                pyramidOk = pyramid.pushRow(&strip->pixels[r * rowBytes]);
+            }
+            queue.recycle(strip);
+            if (!pyramidOk) {
+                queue.abort();
+            }
+        }
+    });
+
+    bool decoded = decodeJpegStrips(cinfo, err, queue);
+    if (decoded) {
+        queue.finish();
+    } else {
+        queue.abort();
+    }
+    cutter.join();
+    jpeg_destroy_decompress(&cinfo);
+
+    bool ok = decoded && pyramidOk && pyramid.finish();
+    stats.streamed = true;
+    stats.tiles = pyramid.tiles;
+    stats.peakBufferBytes = pyramid.bufferBytes() + (size_t)INGEST_QUEUE_STRIPS * cinfo.image_width * 4 * INGEST_STRIP_ROWS;
+    return ok;
+}
+
+bool ingestWhole(const char* filename, unsigned int numMips, TileSink& sink, IngestStats& stats){
+    int width, height, nrChannels;
+    unsigned char* image = stbi_load(filename, &width, &height, &nrChannels, STBI_rgb_alpha);
+    if (image == nullptr) {
+        std::cout << "[ERROR] Could not decode " << filename << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+    stats.width = width;
+    stats.height = height;
+    stats.streamed = false;
+    stats.progressive = false;
+
+    Pyramid pyramid(width, height, numMips, sink);
+    bool ok = true;
+    for (int r = 0; r < height && ok; ++r) {
+        ok = pyramid.pushRow(image + (size_t)r * width * 4);
+    }
+    stbi_image_free(image);
+    ok = ok && pyramid.finish();
+    stats.tiles = pyramid.tiles;
+    stats.peakBufferBytes = pyramid.bufferBytes() + (size_t)width * height * 4;
+    return ok;
+}
+
+}
+
+bool readImageSize(const char* filename, unsigned int& width, unsigned int& height){
+    int w, h, comp;
+    if (!stbi_info(filename, &w, &h, &comp)) {
+        return false;
+    }
+    width = w;
+    height = h;
+    return true;
+}
+
+bool ingestImage(const char* filename, unsigned int numMips, TileSink& sink, IngestStats* stats){
+    auto start = std::chrono::steady_clock::now();
+    IngestStats local;
+    memset(&local, 0, sizeof(local));
+    local.numMips = numMips;
+
+    FILE* file = fopen(filename, "rb");
+    if (file == nullptr) {
+        std::cout << "[ERROR] Could not open " << filename << std::endl;
+        return false;
+    }
+    unsigned char magic[2] = {0, 0};
+    bool isJpeg = fread(magic, 1, 2, file) == 2 && magic[0] == 0xFF && magic[1] == 0xD8;
+    bool ok;
+    if (isJpeg) {
+        rewind(file);
+        ok = ingestJpeg(file, numMips, sink, local);
+        fclose(file);
+    } else {
+        fclose(file);
+        ok = ingestWhole(filename, numMips, sink, local);
+    }
+
+    local.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stats) {
+        *stats = local;
+    }
+    return ok;
+}
+
+bool ingestLevelBundle(const LevelDesc& level, const char* bundleFile, IngestStats* stats){
+    unsigned int width, height;
+    if (!readImageSize(level.image.c_str(), width, height)) {
+        std::cout << "[ERROR] Could not read the size of " << level.image << std::endl;
+        return false;
+    }
+    BundleWriter writer;
+    if (!writer.open(bundleFile, std::vector<LevelDesc>(1, level), std::vector<unsigned int>(1, width),
+                     std::vector<unsigned int>(1, height), std::vector<bool>(1, true))) {
+        return false;
+    }
+    BundleTileSink sink(writer, 0);
+    bool ok = ingestImage(level.image.c_str(), writer.level(0).numMips, sink, stats);
+    return writer.close() && ok;
+}
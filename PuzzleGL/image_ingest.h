@@ -0,0 +1,59 @@
+/*
+IMAGE INGEST
+
+Turns a source picture into the tiled mip pyramid of tile_layout.h without ever holding the whole picture in
+memory. JPEG sources are decoded by libjpeg a strip of scanlines at a time on a decoder thread while a second
+thread box-filters every strip into the coarser mip levels and cuts each row of tiles as soon as its last scanline
+(border included) has arrived. Each mip level only keeps one tile row's worth of scanlines, so peak memory is a few
+strips rather than the whole picture.
+
+Progressive JPEGs still come out strip by strip, but libjpeg has to buffer the coefficients of every scan before
+the first scanline can be produced; that buffer is the format's minimum. Other formats are decoded whole by
+stb_image and then fed through the same pyramid.
+ */
+#ifndef PUZZLEGL_IMAGE_INGEST_H
+#define PUZZLEGL_IMAGE_INGEST_H
+
+#include <cstddef>
+
+#include "level_bundle.h"
+
+// receives finished tiles (TILE_BYTES of RGBA8 each); called from the ingest's pyramid thread
+class TileSink {
+public:
+    virtual ~TileSink() {}
+    virtual bool writeTile(unsigned int mip, unsigned int tx, unsigned int ty, const unsigned char* tile) = 0;
+};
+
+// writes ingested tiles into a tiled level of a bundle being written
+class BundleTileSink : public TileSink {
+public:
+    BundleTileSink(BundleWriter& writer, unsigned int index) : writer(writer), index(index) {}
+    bool writeTile(unsigned int mip, unsigned int tx, unsigned int ty, const unsigned char* tile) {
+        return writer.writeTile(index, mip, tx, ty, tile);
+    }
+
+private:
+    BundleWriter& writer;
+    unsigned int index;
+};
+
+struct IngestStats {
+    unsigned int width;
+    unsigned int height;
+    unsigned int numMips;
+    unsigned int tiles;
+    bool streamed;          // decoded in strips (false for formats that are decoded whole)
+    bool progressive;
+    size_t peakBufferBytes; // strip queue + per-level scanline buffers
+    double seconds;
+};
+
+// reads only the header
+bool readImageSize(const char* filename, unsigned int& width, unsigned int& height);
+// cut numMips levels of tiles (see tiledMipCount) and hand them to sink
+bool ingestImage(const char* filename, unsigned int numMips, TileSink& sink, IngestStats* stats = nullptr);
+// stream one level's picture into a single-level tiled bundle
+bool ingestLevelBundle(const LevelDesc& level, const char* bundleFile, IngestStats* stats = nullptr);
+
+#endif //PUZZLEGL_IMAGE_INGEST_H
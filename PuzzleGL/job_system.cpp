@@ -0,0 +1,311 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace sc = std::chrono;
+
+struct Job {
+    std::function<void()> fn;
+    const char* name;
+    JobHandle parent;
+    std::atomic<int> unfinished; // the job itself plus its unfinished children
+    std::atomic<int> blockers;   // unfinished dependencies, plus one until runJob
+    std::mutex lock;             // guards finished and dependents
+    bool finished;
+    std::vector<JobHandle> dependents;
+};
+
+namespace {
+
+// a worker's jobs: the owner works at the back, thieves take from the front
+class JobQueue {
+public:
+    void push(const JobHandle& job) {
+        std::lock_guard<std::mutex> guard(lock);
+        jobs.push_back(job);
+    }
+    bool popBack(JobHandle& job) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (jobs.empty()) {
+            return false;
+        }
+        job = std::move(jobs.back());
+        jobs.pop_back();
+        return true;
+    }
+    bool stealFront(JobHandle& job) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (jobs.empty()) {
+            return false;
+        }
+        job = std::move(jobs.front());
+        jobs.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex lock;
+    std::deque<JobHandle> jobs;
+};
+
+struct Timing {
+    unsigned long long count;
+    double seconds, worst;
+};
+
+// the worker this thread is, or -1 for any other thread
+thread_local int workerIndex = -1;
+
+class Scheduler {
+public:
+    explicit Scheduler(unsigned int workers) : queued(0), sleepers(0), stopping(false) {
+        // one queue per worker, then the one every other thread shares
+        for (unsigned int i = 0; i <= workers; ++i) {
+            queues.push_back(std::unique_ptr<JobQueue>(new JobQueue()));
+        }
+        for (unsigned int i = 0; i < workers; ++i) {
+            threads.push_back(std::thread(&Scheduler::work, this, i));
+        }
+    }
+
+    ~Scheduler() {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    unsigned int concurrency() const { return threads.size() + 1; }
+
+    void enqueue(const JobHandle& job) {
+        queues[workerIndex >= 0 ? workerIndex : threads.size()]->push(job);
+        queued++;
+        // a worker going to sleep raises sleepers before it checks queued, so one of the two sees the other
+        if (sleepers.load() > 0) {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            wake.notify_one();
+        }
+    }
+
+    bool runOne() {
+        JobHandle job;
+        if (!take(job)) {
+            return false;
+        }
+        execute(job);
+        return true;
+    }
+
+    void execute(const JobHandle& job) {
+        auto start = sc::steady_clock::now();
+        job->fn();
+        double seconds = sc::duration<double>(sc::steady_clock::now() - start).count();
+        job->fn = nullptr; // whatever it captured can go now
+        {
+            std::lock_guard<std::mutex> guard(statsLock);
+            Timing& t = timings[job->name];
+            t.count++;
+            t.seconds += seconds;
+            t.worst = std::max(t.worst, seconds);
+        }
+        finish(job);
+    }
+
+    void finish(const JobHandle& job) {
+        if (--job->unfinished > 0) {
+            return;
+        }
+        std::vector<JobHandle> released;
+        {
+            std::lock_guard<std::mutex> guard(job->lock);
+            job->finished = true;
+            released.swap(job->dependents);
+        }
+        for (auto& d : released) {
+            if (--d->blockers == 0) {
+                enqueue(d);
+            }
+        }
+        if (job->parent) {
+            finish(job->parent);
+        }
+    }
+
+    void stats(std::vector<JobStats>& out) {
+        out.clear();
+        std::lock_guard<std::mutex> guard(statsLock);
+        for (auto& t : timings) {
+            // the same literal may live at different addresses in different translation units
+            auto same = std::find_if(out.begin(), out.end(), [&](const JobStats& s) { return std::strcmp(s.name, t.first) == 0; });
+            if (same == out.end()) {
+                JobStats s = { t.first, t.second.count, t.second.seconds, t.second.worst };
+                out.push_back(s);
+            } else {
+                same->count += t.second.count;
+                same->seconds += t.second.seconds;
+                same->worst = std::max(same->worst, t.second.worst);
+            }
+        }
+        std::sort(out.begin(), out.end(), [](const JobStats& a, const JobStats& b) { return a.seconds > b.seconds; });
+    }
+
+    void resetStats() {
+        std::lock_guard<std::mutex> guard(statsLock);
+        timings.clear();
+    }
+
+private:
+    bool take(JobHandle& job) {
+        unsigned int own = workerIndex >= 0 ? workerIndex : threads.size();
+        bool found = queues[own]->popBack(job);
+        // steal starting next to our own queue so thieves spread over the victims
+        for (unsigned int i = 1; !found && i < queues.size(); ++i) {
+            found = queues[(own + i) % queues.size()]->stealFront(job);
+        }
+        if (found) {
+            queued--;
+        }
+        return found;
+    }
+
+    void work(unsigned int index) {
+        workerIndex = index;
+        for (;;) {
+            if (runOne()) {
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleepLock);
+            sleepers++;
+            wake.wait(guard, [this] { return queued.load() > 0 || stopping; });
+            sleepers--;
+            if (stopping) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<JobQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<int> queued; // jobs in any queue
+    std::atomic<int> sleepers;
+    bool stopping;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::mutex statsLock;
+    std::unordered_map<const char*, Timing> timings;
+};
+
+std::mutex schedulerLock;
+std::unique_ptr<Scheduler> scheduler; // joined at exit
+std::atomic<Scheduler*> current(nullptr);
+
+Scheduler& jobs() {
+    Scheduler* s = current.load(std::memory_order_acquire);
+    if (s != nullptr) {
+        return *s;
+    }
+    std::lock_guard<std::mutex> guard(schedulerLock);
+    if (!scheduler) {
+        scheduler.reset(new Scheduler(std::max(2u, std::thread::hardware_concurrency()) - 1));
+        current.store(scheduler.get(), std::memory_order_release);
+    }
+    return *scheduler;
+}
+
+}
+
+bool startJobSystem(unsigned int workers) {
+    std::lock_guard<std::mutex> guard(schedulerLock);
+    if (scheduler) {
+        return false;
+    }
+    scheduler.reset(new Scheduler(workers));
+    current.store(scheduler.get(), std::memory_order_release);
+    return true;
+}
+
+unsigned int jobConcurrency() {
+    return jobs().concurrency();
+}
+
+JobHandle createJob(const char* name, std::function<void()> fn, const JobHandle& parent) {
+    JobHandle job = std::make_shared<Job>();
+    job->fn = std::move(fn);
+    job->name = name;
+    job->parent = parent;
+    job->unfinished = 1;
+    job->blockers = 1;
+    job->finished = false;
+    if (parent) {
+        parent->unfinished++;
+    }
+    return job;
+}
+
+void addDependency(const JobHandle& job, const JobHandle& prerequisite) {
+    std::lock_guard<std::mutex> guard(prerequisite->lock);
+    if (!prerequisite->finished) {
+        job->blockers++;
+        prerequisite->dependents.push_back(job);
+    }
+}
+
+void runJob(const JobHandle& job) {
+    if (--job->blockers == 0) {
+        jobs().enqueue(job);
+    }
+}
+
+bool jobFinished(const JobHandle& job) {
+    return job->unfinished.load() == 0;
+}
+
+void waitJob(const JobHandle& job) {
+    Scheduler& s = jobs();
+    while (!jobFinished(job)) {
+        if (!s.runOne()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void parallelFor(const char* name, unsigned int count, unsigned int grain,
+                 const std::function<void(unsigned int, unsigned int)>& fn) {
+    grain = std::max(grain, 1u);
+    unsigned int blocks = (count + grain - 1) / grain;
+    Scheduler& s = jobs();
+    if (blocks <= 1) {
+        if (count > 0) {
+            s.execute(createJob(name, [&] { fn(0, count); }));
+        }
+        return;
+    }
+    // the blocks are children of a group that is never queued itself: it finishes when the last block does
+    JobHandle group = createJob(name, nullptr);
+    for (unsigned int b = 0; b < blocks; ++b) {
+        unsigned int begin = b * grain, end = std::min(count, begin + grain);
+        runJob(createJob(name, [&fn, begin, end] { fn(begin, end); }, group));
+    }
+    s.finish(group);
+    waitJob(group);
+}
+
+void jobStats(std::vector<JobStats>& stats) {
+    jobs().stats(stats);
+}
+
+void resetJobStats() {
+    jobs().resetStats();
+}
@@ -0,0 +1,58 @@
+/*
+JOB SYSTEM
+
+A small work-stealing scheduler shared by everything that runs in parallel (scrambling, the solvers, picture
+work), instead of each of them starting and joining its own threads. There is one worker per core but one; each
+worker has its own deque of jobs: it pushes and pops at the back (the job it queued last is the one whose data is
+still in cache), and an idle worker steals from the front of someone else's, i.e. the oldest and usually largest
+piece of work. Threads that are not workers (the frame thread, the simulation) queue into a shared deque that
+workers steal from too.
+
+Jobs may have a parent, which is not finished until all its children are, and dependencies, which must finish
+before the job starts. Waiting on a job runs other jobs meanwhile, so a job may wait on jobs it spawned (a
+parallel-for inside a parallel-for) without tying up a worker.
+
+Every job is timed under its name so the time spent in each kind of task can be profiled; names must be string
+literals (or otherwise outlive the job system).
+ */
+#ifndef PUZZLEGL_JOB_SYSTEM_H
+#define PUZZLEGL_JOB_SYSTEM_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+struct Job;
+typedef std::shared_ptr<Job> JobHandle;
+
+struct JobStats {
+    const char* name;
+    unsigned long long count;
+    double seconds; // summed over all runs
+    double worst;
+};
+
+// sizes the job system before its first use (by default one worker per core but one, at least one); with no
+// workers jobs only run on threads waiting for them. false if it already runs
+bool startJobSystem(unsigned int workers);
+// workers plus the thread that waits, i.e. how many jobs may run at once
+unsigned int jobConcurrency();
+
+// a job that runs fn once queued with runJob and once its dependencies are finished
+JobHandle createJob(const char* name, std::function<void()> fn, const JobHandle& parent = JobHandle());
+// job starts only after prerequisite has finished; job must not have been queued yet, prerequisite may have
+void addDependency(const JobHandle& job, const JobHandle& prerequisite);
+void runJob(const JobHandle& job);
+// runs other jobs until job (and all its children) has finished
+void waitJob(const JobHandle& job);
+bool jobFinished(const JobHandle& job);
+
+// fn(begin, end) over [0,count) in blocks of grain, on every core; returns when all blocks are done
+void parallelFor(const char* name, unsigned int count, unsigned int grain,
+                 const std::function<void(unsigned int, unsigned int)>& fn);
+
+// timings per job name since the last reset, merged over threads
+void jobStats(std::vector<JobStats>& stats);
+void resetJobStats();
+
+#endif //PUZZLEGL_JOB_SYSTEM_H
@@ -0,0 +1,329 @@
+#include "level_bundle.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "job_system.h"
+
+static const unsigned int MIP_ROWS_PER_JOB = 64;
+
+static uint64_t mipBytes(const BundleLevel& lvl, unsigned int mip){
+    if (lvl.tileContent) {
+        return (uint64_t)tilesAcross(lvl.width, mip) * tilesAcross(lvl.height, mip) * TILE_BYTES;
+    }
+    return (uint64_t)mipSize(lvl.width, mip) * mipSize(lvl.height, mip) * 4;
+}
+
+static uint64_t alignUp(uint64_t v){
+    return (v + BUNDLE_BLOCK_ALIGN - 1) & ~(uint64_t)(BUNDLE_BLOCK_ALIGN - 1);
+}
+
+static bool seekTo(FILE* f, uint64_t offset){ // bundles of poster-sized images exceed 2GB
+#ifdef _WIN32
+    return _fseeki64(f, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+LevelBundle::LevelBundle() : base(nullptr), size(0) {
+#ifdef _WIN32
+    fileHandle = mappingHandle = nullptr;
+#endif
+}
+
+LevelBundle::~LevelBundle(){
+    close();
+}
+
+bool LevelBundle::open(const char* filename){
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    base = (const unsigned char*)view;
+    size = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(BundleHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file referenced
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    madvise(view, (size_t)st.st_size, MADV_WILLNEED);
+    base = (const unsigned char*)view;
+    size = (size_t)st.st_size;
+#endif
+
+    // validate everything up front so the accessors never need to
+    const BundleHeader* hdr = (const BundleHeader*)base;
+    bool valid = size >= sizeof(BundleHeader) && hdr->magic == BUNDLE_MAGIC && hdr->version == BUNDLE_VERSION
+                 && size >= sizeof(BundleHeader) + (uint64_t)hdr->numLevels * sizeof(BundleLevel);
+    for (unsigned int i = 0; valid && i < hdr->numLevels; ++i) {
+        const BundleLevel& lvl = level(i);
+        valid = lvl.width > 0 && lvl.height > 0 && lvl.numMips > 0 && lvl.numMips <= BUNDLE_MAX_MIPS
+                && (lvl.tileContent == 0 || lvl.tileContent == (uint32_t)TILE_CONTENT) && lvl.cut < TOPOLOGY_KIND_COUNT;
+        for (unsigned int m = 0; valid && m < lvl.numMips; ++m) {
+            valid = lvl.mipOffset[m] + mipBytes(lvl, m) <= size;
+        }
+    }
+    if (!valid) {
+        std::cout << "[ERROR] " << filename << " is not a valid level bundle" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void LevelBundle::close(){
+    if (base == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+    CloseHandle((HANDLE)mappingHandle);
+    CloseHandle((HANDLE)fileHandle);
+    fileHandle = mappingHandle = nullptr;
+#else
+    munmap((void*)base, size);
+#endif
+    base = nullptr;
+    size = 0;
+}
+
+unsigned int LevelBundle::numLevels() const {
+    return ((const BundleHeader*)base)->numLevels;
+}
+
+const BundleLevel& LevelBundle::level(unsigned int index) const {
+    return ((const BundleLevel*)(base + sizeof(BundleHeader)))[index];
+}
+
+const unsigned char* LevelBundle::mipData(unsigned int index, unsigned int mip) const {
+    return base + level(index).mipOffset[mip];
+}
+
+const unsigned char* LevelBundle::tileData(unsigned int index, unsigned int mip, unsigned int tx, unsigned int ty) const {
+    const BundleLevel& lvl = level(index);
+    return mipData(index, mip) + ((size_t)ty * tilesAcross(lvl.width, mip) + tx) * TILE_BYTES;
+}
+
+const char* levelKindName(LevelKind kind){
+    switch (kind) {
+        case LEVEL_PLAY: return "play";
+        case LEVEL_DONE: return "done";
+        case LEVEL_GAMEOVER: return "gameover";
+    }
+    return "?";
+}
+
+bool readLevelManifest(const char* filename, std::vector<LevelDesc>& levels){
+    std::ifstream in(filename);
+    if (!in) {
+        return false;
+    }
+    std::string dir(filename);
+    size_t slash = dir.find_last_of("/\\");
+    dir = (slash == std::string::npos) ? "" : dir.substr(0, slash + 1);
+
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) {
+            line.erase(hash);
+        }
+        std::istringstream ss(line);
+        LevelDesc desc;
+        std::string kind;
+        if (!(ss >> desc.image)) {
+            continue; // blank or comment line
+        }
+        if (!(ss >> desc.rows >> desc.cols >> desc.countdown >> kind) || desc.rows == 0 || desc.cols == 0) {
+            std::cout << "[ERROR] " << filename << ":" << lineNo << ": expected <image> <rows> <cols> <countdown> <kind>" << std::endl;
+            return false;
+        }
+        if (kind == "play") desc.kind = LEVEL_PLAY;
+        else if (kind == "done") desc.kind = LEVEL_DONE;
+        else if (kind == "gameover") desc.kind = LEVEL_GAMEOVER;
+        else {
+            std::cout << "[ERROR] " << filename << ":" << lineNo << ": unknown level kind " << kind << std::endl;
+            return false;
+        }
+        std::string cut = "grid";
+        ss >> cut;
+        if (cut == "grid") desc.cut = TOPOLOGY_GRID;
+        else if (cut == "hex") desc.cut = TOPOLOGY_HEX;
+        else if (cut == "triangle") desc.cut = TOPOLOGY_TRIANGLE;
+        else if (cut == "voronoi") desc.cut = TOPOLOGY_VORONOI;
+        else {
+            std::cout << "[ERROR] " << filename << ":" << lineNo << ": unknown cut " << cut << std::endl;
+            return false;
+        }
+        desc.image = dir + desc.image;
+        levels.push_back(desc);
+    }
+    return !levels.empty();
+}
+
+unsigned int fullMipCount(unsigned int width, unsigned int height){
+    unsigned int count = 1;
+    while ((width > 1 || height > 1) && count < BUNDLE_MAX_MIPS) {
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        ++count;
+    }
+    return count;
+}
+
+void downsampleRows(const unsigned char* row0, const unsigned char* row1, unsigned int width, unsigned char* out){
+    unsigned int nw = std::max(1u, width / 2);
+    for (unsigned int x = 0; x < nw; ++x) {
+        // clamp so a level that is already 1 texel wide keeps sampling valid texels
+        unsigned int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+        for (unsigned int c = 0; c < 4; ++c) {
+            unsigned int sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+            out[x * 4 + c] = (unsigned char)((sum + 2) / 4);
+        }
+    }
+}
+
+void buildMipChain(const unsigned char* rgba, unsigned int width, unsigned int height,
+                   std::vector<std::vector<unsigned char> >& mips){
+    unsigned int count = fullMipCount(width, height);
+    mips.clear();
+    mips.push_back(std::vector<unsigned char>(rgba, rgba + (size_t)width * height * 4));
+    unsigned int w = width, h = height;
+    while (mips.size() < count) {
+        unsigned int nw = std::max(1u, w / 2), nh = std::max(1u, h / 2);
+        std::vector<unsigned char> next((size_t)nw * nh * 4);
+        const std::vector<unsigned char>& src = mips.back();
+        parallelFor("downsample", nh, MIP_ROWS_PER_JOB, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int y = begin; y < end; ++y) {
+                unsigned int y0 = std::min(2 * y, h - 1), y1 = std::min(2 * y + 1, h - 1);
+                downsampleRows(&src[(size_t)y0 * w * 4], &src[(size_t)y1 * w * 4], w, &next[(size_t)y * nw * 4]);
+            }
+        });
+        mips.push_back(next);
+        w = nw;
+        h = nh;
+    }
+}
+
+BundleWriter::BundleWriter() : out(nullptr), end(0), ok(false) {
+}
+
+BundleWriter::~BundleWriter(){
+    if (out) {
+        fclose(out);
+    }
+}
+
+bool BundleWriter::open(const char* filename, const std::vector<LevelDesc>& levels,
+                        const std::vector<unsigned int>& widths, const std::vector<unsigned int>& heights,
+                        const std::vector<bool>& tiled){
+    name = filename;
+    out = fopen(filename, "wb");
+    if (out == nullptr) {
+        std::cout << "[ERROR] could not open " << filename << " for writing" << std::endl;
+        return false;
+    }
+    ok = true;
+
+    // lay out every block first so the table can be written before any pixels arrive
+    table.assign(levels.size(), BundleLevel());
+    end = alignUp(sizeof(BundleHeader) + levels.size() * sizeof(BundleLevel));
+    for (size_t i = 0; i < levels.size(); ++i) {
+        BundleLevel& lvl = table[i];
+        memset(&lvl, 0, sizeof(lvl));
+        lvl.rows = levels[i].rows;
+        lvl.cols = levels[i].cols;
+        lvl.countdown = levels[i].countdown;
+        lvl.kind = levels[i].kind;
+        lvl.cut = levels[i].cut;
+        lvl.width = widths[i];
+        lvl.height = heights[i];
+        lvl.tileContent = tiled[i] ? TILE_CONTENT : 0;
+        lvl.numMips = std::min(BUNDLE_MAX_MIPS, tiled[i] ? tiledMipCount(widths[i], heights[i])
+                                                         : fullMipCount(widths[i], heights[i]));
+        for (uint32_t m = 0; m < lvl.numMips; ++m) {
+            lvl.mipOffset[m] = end;
+            end = alignUp(end + mipBytes(lvl, m));
+        }
+    }
+
+    BundleHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = BUNDLE_MAGIC;
+    hdr.version = BUNDLE_VERSION;
+    hdr.numLevels = (uint32_t)levels.size();
+    writeAt(0, &hdr, sizeof(hdr));
+    if (!table.empty()) {
+        ok = ok && writeAt(sizeof(hdr), &table[0], table.size() * sizeof(BundleLevel));
+    }
+    return ok;
+}
+
+bool BundleWriter::writeAt(uint64_t offset, const void* data, size_t bytes){
+    ok = ok && seekTo(out, offset) && fwrite(data, 1, bytes, out) == bytes;
+    return ok;
+}
+
+bool BundleWriter::writeMip(unsigned int index, unsigned int mip, const unsigned char* rgba){
+    return writeAt(table[index].mipOffset[mip], rgba, (size_t)mipBytes(table[index], mip));
+}
+
+bool BundleWriter::writeTile(unsigned int index, unsigned int mip, unsigned int tx, unsigned int ty,
+                             const unsigned char* tile){
+    const BundleLevel& lvl = table[index];
+    uint64_t offset = lvl.mipOffset[mip] + ((uint64_t)ty * tilesAcross(lvl.width, mip) + tx) * TILE_BYTES;
+    return writeAt(offset, tile, TILE_BYTES);
+}
+
+bool BundleWriter::close(){
+    if (out == nullptr) {
+        return false;
+    }
+    ok = (fclose(out) == 0) && ok;
+    out = nullptr;
+    if (!ok) {
+        std::cout << "[ERROR] failed writing " << name << std::endl;
+    }
+    return ok;
+}
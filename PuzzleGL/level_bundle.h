@@ -0,0 +1,137 @@
+/*
+LEVEL BUNDLE
+
+A level bundle (.pzl) holds every stage of the game as data: the grid size, cut, countdown and kind of each level,
+followed by its picture already decoded to RGBA8 and reduced into a full mip chain. The bundle is written offline
+by pack_levels (from the levels.txt manifest) and memory-mapped by the game, so starting a level is a page-in of
+the mip blocks straight into glTexImage2D: no JPEG decode and no intermediate heap copy.
+
+Pictures too large for one texture are stored tiled instead (see tile_layout.h): each mip block is then the
+level's tiles in row-major order, ready to be streamed into the virtual texture one tile at a time.
+
+FILE LAYOUT (little endian):
+    BundleHeader
+    BundleLevel[numLevels]
+    mip blocks, each starting on a BUNDLE_BLOCK_ALIGN boundary (tightly packed RGBA8 rows, or tiles)
+ */
+#ifndef PUZZLEGL_LEVEL_BUNDLE_H
+#define PUZZLEGL_LEVEL_BUNDLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "tile_layout.h"
+#include "topology.h"
+
+const uint32_t BUNDLE_MAGIC = 0x4C5A5550; // "PUZL"
+const uint32_t BUNDLE_VERSION = 3;
+const uint32_t BUNDLE_MAX_MIPS = 16;
+const uint32_t BUNDLE_BLOCK_ALIGN = 4096; // page aligned so the mapping can be handed to the driver as-is
+
+// what the game does with a level once it is loaded
+enum LevelKind {
+    LEVEL_PLAY = 0,     // scrambled, timed puzzle
+    LEVEL_DONE = 1,     // "you won" screen shown after the last puzzle
+    LEVEL_GAMEOVER = 2  // shown when the countdown runs out
+};
+
+struct BundleHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numLevels;
+    uint32_t reserved;
+};
+
+struct BundleLevel {
+    uint32_t rows;
+    uint32_t cols;
+    int32_t countdown; // seconds
+    uint32_t kind;     // LevelKind
+    uint32_t width;    // size of mip 0
+    uint32_t height;
+    uint32_t numMips;
+    uint32_t tileContent;                // 0 if mips are stored whole, TILE_CONTENT if they are tiled
+    uint32_t cut;                        // TopologyKind
+    uint32_t reserved;
+    uint64_t mipOffset[BUNDLE_MAX_MIPS]; // byte offset of each mip block from the start of the file
+};
+
+// one line of the levels.txt manifest
+struct LevelDesc {
+    std::string image; // resolved path of the source picture
+    unsigned int rows;
+    unsigned int cols;
+    int countdown;
+    LevelKind kind;
+    TopologyKind cut;  // optional sixth column, grid if left out
+};
+
+// read-only view of a bundle mapped into memory
+class LevelBundle {
+public:
+    LevelBundle();
+    ~LevelBundle();
+
+    bool open(const char* filename);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    unsigned int numLevels() const;
+    const BundleLevel& level(unsigned int index) const;
+    const unsigned char* mipData(unsigned int index, unsigned int mip) const;
+    const unsigned char* tileData(unsigned int index, unsigned int mip, unsigned int tx, unsigned int ty) const;
+
+private:
+    LevelBundle(const LevelBundle&);
+    LevelBundle& operator=(const LevelBundle&);
+
+    const unsigned char* base;
+    size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+};
+
+// parse a manifest; image paths are resolved relative to the manifest's directory
+bool readLevelManifest(const char* filename, std::vector<LevelDesc>& levels);
+const char* levelKindName(LevelKind kind);
+
+// number of mips buildMipChain produces for a picture
+unsigned int fullMipCount(unsigned int width, unsigned int height);
+// box-filter an RGBA8 image down to 1x1; mips[0] is a copy of the source
+void buildMipChain(const unsigned char* rgba, unsigned int width, unsigned int height,
+                   std::vector<std::vector<unsigned char> >& mips);
+// one 2x2 box-filter step for a pair of source rows (the same filter buildMipChain uses)
+void downsampleRows(const unsigned char* row0, const unsigned char* row1, unsigned int width, unsigned char* out);
+
+// writes a bundle whose layout is fixed up front, so mip blocks and tiles may arrive in any order
+class BundleWriter {
+public:
+    BundleWriter();
+    ~BundleWriter();
+
+    // levels[i] is widths[i] x heights[i]; tiled[i] selects the tiled layout for that level
+    bool open(const char* filename, const std::vector<LevelDesc>& levels, const std::vector<unsigned int>& widths,
+              const std::vector<unsigned int>& heights, const std::vector<bool>& tiled);
+    const BundleLevel& level(unsigned int index) const { return table[index]; }
+    bool writeMip(unsigned int index, unsigned int mip, const unsigned char* rgba);
+    bool writeTile(unsigned int index, unsigned int mip, unsigned int tx, unsigned int ty, const unsigned char* tile);
+    bool close();
+
+private:
+    BundleWriter(const BundleWriter&);
+    BundleWriter& operator=(const BundleWriter&);
+    bool writeAt(uint64_t offset, const void* data, size_t bytes);
+
+    FILE* out;
+    std::string name;
+    std::vector<BundleLevel> table;
+    uint64_t end;
+    bool ok;
+};
+
+#endif //PUZZLEGL_LEVEL_BUNDLE_H
@@ -0,0 +1,158 @@
+#include "log.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+
+namespace {
+
+const char* levelPrefix(LogLevel level) {
+    switch (level) {
+        case LOG_LEVEL_DEBUG: return "[DEBUG] ";
+        case LOG_LEVEL_WARN: return "[WARN] ";
+        case LOG_LEVEL_ERROR: return "[ERROR] ";
+        default: return "";
+    }
+}
+
+void formatRecord(const LogRecord& record, std::ostream& out) {
+    out << levelPrefix(record.level);
+    int next = 0;
+    for (const char* c = record.format; *c; ++c) {
+        if (c[0] == '{' && c[1] == '}' && next < record.numArgs) {
+            const LogArg& arg = record.args[next++];
+            switch (arg.type) {
+                case LogArg::INT: out << arg.i; break;
+                case LogArg::UINT: out << arg.u; break;
+                case LogArg::FLOAT: out << arg.f; break;
+                case LogArg::STRING: out << (arg.s ? arg.s : "(null)"); break;
+            }
+            ++c;
+        } else {
+            out << *c;
+        }
+    }
+    out << '\n';
+}
+
+class Logger {
+public:
+    Logger() : dropped(0), stopping(false) {
+        rings[0].producer = std::this_thread::get_id();
+        writer = std::thread(&Logger::run, this);
+    }
+
+    ~Logger() {
+        stopping = true;
+        writer.join();
+    }
+
+    void attach() {
+        rings[LOG_RINGS - 1].producer = std::this_thread::get_id();
+    }
+
+    void push(const LogRecord& record) {
+        std::thread::id self = std::this_thread::get_id();
+        for (auto& ring : rings) {
+            if (ring.producer.load(std::memory_order_relaxed) == self) {
+                if (!ring.records.push(record)) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+                return;
+            }
+        }
+        std::lock_guard<std::mutex> guard(output);
+        formatRecord(record, std::cout);
+        std::cout.flush();
+    }
+
+    void flush() {
+        for (auto& ring : rings) {
+            size_t target = ring.records.pushed();
+            while (ring.written.load(std::memory_order_acquire) < target) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+
+private:
+    void run() {
+        std::ostringstream batch;
+        LogRecord record;
+        for (;;) {
+            bool stop = stopping.load(); // read before draining so records pushed before the stop are written
+            size_t count = 0, counts[LOG_RINGS];
+            batch.str(std::string());
+            for (unsigned int r = 0; r < LOG_RINGS; ++r) {
+                counts[r] = 0;
+                while (rings[r].records.pop(record)) {
+                    formatRecord(record, batch);
+                    counts[r]++;
+                }
+                count += counts[r];
+            }
+            if (count == 0) {
+                if (stop) {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            unsigned long long lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost > 0) {
+                batch << "[WARN] log ring full, dropped " << lost << " records\n";
+            }
+            {
+                std::lock_guard<std::mutex> guard(output);
+                std::cout << batch.str();
+                std::cout.flush();
+            }
+            for (unsigned int r = 0; r < LOG_RINGS; ++r) {
+                rings[r].written.fetch_add(counts[r], std::memory_order_release);
+            }
+        }
+    }
+
+    struct Ring {
+        Ring() : records(LOG_RING_RECORDS), written(0), producer(std::thread::id()) {}
+        SpscRing<LogRecord> records;
+        std::atomic<size_t> written; // records formatted and written out
+        std::atomic<std::thread::id> producer;
+    };
+
+    Ring rings[LOG_RINGS];
+    std::atomic<unsigned long long> dropped;
+    std::atomic<bool> stopping;
+    std::mutex output; // between the writer thread and other threads' direct writes
+    std::thread writer;
+};
+
+Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+} // namespace
+
+void startLogger() {
+    logger();
+}
+
+void attachLogThread() {
+    logger().attach();
+}
+
+void flushLog() {
+    logger().flush();
+}
+
+void pushLogRecord(const LogRecord& record) {
+    logger().push(record);
+}
@@ -0,0 +1,125 @@
+/*
+LOG
+
+Diagnostics that never block the frame thread on terminal I/O. LOG_DEBUG/LOG_INFO/LOG_WARN/LOG_ERROR pack their
+format string and up to LOG_MAX_ARGS numbers or static strings into a fixed-size binary record and push it into a
+lock-free single-producer/single-consumer ring; a background thread formats the records ("{}" is replaced by the
+next argument) and writes them out in batches. A full ring drops the record and counts it instead of waiting.
+
+There are LOG_RINGS rings of one producer each: the thread that calls startLogger() (the game's frame thread), or else
+the first one to log, and the thread that last called attachLogThread() (the simulation thread). Records from any other
+thread are formatted and written on the spot under a lock, so they are slower but still safe. String arguments are
+stored as pointers and must outlive the record, i.e. be literals.
+
+Levels below PUZZLEGL_MIN_LOG_LEVEL are compiled out entirely, arguments included. It defaults to debug, or to
+info when NDEBUG is set (release builds).
+ */
+#ifndef PUZZLEGL_LOG_H
+#define PUZZLEGL_LOG_H
+
+#include <type_traits>
+
+enum LogLevel {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO = 1,
+    LOG_LEVEL_WARN = 2,
+    LOG_LEVEL_ERROR = 3
+};
+
+#ifndef PUZZLEGL_MIN_LOG_LEVEL
+#ifdef NDEBUG
+#define PUZZLEGL_MIN_LOG_LEVEL 1
+#else
+#define PUZZLEGL_MIN_LOG_LEVEL 0
+#endif
+#endif
+
+const int LOG_MAX_ARGS = 6;
+const unsigned int LOG_RING_RECORDS = 1 << 16; // per ring, a power of two
+const unsigned int LOG_RINGS = 2;
+
+struct LogArg {
+    enum Type { INT, UINT, FLOAT, STRING } type;
+    union {
+        long long i;
+        unsigned long long u;
+        double f;
+        const char* s;
+    };
+};
+
+struct LogRecord {
+    LogLevel level;
+    int numArgs;
+    const char* format;
+    LogArg args[LOG_MAX_ARGS];
+};
+
+// starts the writer thread; the calling thread becomes the first ring's producer
+void startLogger();
+// the calling thread becomes the second ring's producer, in place of the one before it (which must have stopped)
+void attachLogThread();
+// blocks until every record pushed so far has been written
+void flushLog();
+void pushLogRecord(const LogRecord& record);
+
+template<class T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type packLogArg(LogArg& arg, T v) {
+    arg.type = LogArg::INT;
+    arg.i = v;
+}
+
+template<class T>
+typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type packLogArg(LogArg& arg, T v) {
+    arg.type = LogArg::UINT;
+    arg.u = v;
+}
+
+inline void packLogArg(LogArg& arg, double v) {
+    arg.type = LogArg::FLOAT;
+    arg.f = v;
+}
+
+inline void packLogArg(LogArg& arg, const char* v) {
+    arg.type = LogArg::STRING;
+    arg.s = v;
+}
+
+inline void packLogArgs(LogRecord&) {
+}
+
+template<class T, class... Rest>
+void packLogArgs(LogRecord& record, T v, Rest... rest) {
+    packLogArg(record.args[record.numArgs++], v);
+    packLogArgs(record, rest...);
+}
+
+template<class... Args>
+void logMessage(LogLevel level, const char* format, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+    LogRecord record;
+    record.level = level;
+    record.numArgs = 0;
+    record.format = format;
+    packLogArgs(record, args...);
+    pushLogRecord(record);
+}
+
+#if PUZZLEGL_MIN_LOG_LEVEL <= 0
+#define LOG_DEBUG(...) logMessage(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+#if PUZZLEGL_MIN_LOG_LEVEL <= 1
+#define LOG_INFO(...) logMessage(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if PUZZLEGL_MIN_LOG_LEVEL <= 2
+#define LOG_WARN(...) logMessage(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+#define LOG_ERROR(...) logMessage(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif //PUZZLEGL_LOG_H
@@ -7,7 +7,7 @@ AUTHORS:
     Joseph Stevenson <jstevnson33@gatech.edu>
     Paul Yates <paul.maxyat@gatech.edu>
 
-DESCRIPTION: OpenGL C++ Jigsaw Puzzle Game (3 Levels)
+DESCRIPTION: OpenGL C++ Jigsaw Puzzle Game (levels are listed in levels.txt)
 USER NOTE: SET DEBUG_MODE PARAMETER TO 1 IF YOU WANT TO SEE FULL FUNCTIONALITY (FOR INSTRUCTOR)
  */
 #include <glad/glad.h>
@@ -15,11 +15,29 @@ USER NOTE: SET DEBUG_MODE PARAMETER TO 1 IF YOU WANT TO SEE FULL FUNCTIONALITY (
 #include <iostream>
 #include <algorithm>
 #include <vector>
-#include <map>
 #include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include <chrono>
+#include <cmath>
+#include <functional>
 #include <sstream>
 
+#include "blind_solver.h"
+#include "board.h"
+#include "camera.h"
+#include "color_sort.h"
+#include "coop.h"
+#include "frame_pacer.h"
+#include "frame_tasks.h"
+#include "image_ingest.h"
+#include "job_system.h"
+#include "level_bundle.h"
+#include "log.h"
+#include "replay.h"
+#include "save_game.h"
+#include "simulation.h"
+#include "virtual_texture.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -29,316 +47,355 @@ namespace sc = std::chrono;
 int DEBUG_MODE = 0;
 /*-------------------------------------------------------------------------------------------------------*/
 
-/*----COUNTDOWN TIMER VALUE-------*/
+/*----COUNTDOWN TIMER VALUE (SET PER LEVEL FROM THE LEVEL DATA)-------*/
 int COUNTDOWN_MAX = 180;
-/*--------------------------------*/
-
-
-// puzzle piece data
-struct PuzzlePiece {
-    int id; //change to a texture offset x-y?
-    float x;
-    float y;
-    float z;
-    float tx;
-    float ty;
-    std::map<PuzzlePiece*, glm::vec2> group;
-    int neighborList[4];
-    PuzzlePiece(){
-        x=y=z=id=0;
-        tx=ty=0;
-    }
-};
+/*--------------------------------------------------------------------*/
+
+/*----SCRAMBLE LAYOUT (M CYCLES THE MODE IN GAME, T SORTS THE LOOSE PIECES INTO TRAYS; A NONZERO SEED REPEATS THE SAME LAYOUT)-------*/
+ScrambleMode SCRAMBLE_MODE = SCRAMBLE_SPREAD;
+unsigned long long SCRAMBLE_SEED = 0;
+/*-----------------------------------------------------------------------------------------------------------------------------------*/
+
+/*----PIECE ROTATION (R CYCLES NONE / QUARTER TURNS / FREE IN GAME; Q AND E TURN THE HELD GROUP)-------*/
+RotationMode ROTATION_MODE = ROTATION_NONE;
+float FREE_ROTATION_STEP_DEGREES = 15.0f; // per key press (or key repeat) in free rotation
+/*-----------------------------------------------------------------------------------------------------*/
+
+/*----FLICK AND GLIDE (LET GO OF A DRAG MID-MOTION TO THROW THE GROUP; W SWEEPS LOOSE PIECES AWAY FROM THE CURSOR)-------*/
+float SWEEP_RADIUS = 0.3f; // fraction of the view's width
+float SWEEP_SPEED = 3.0f;  // view widths per second at the cursor
+/*-----------------------------------------------------------------------------------------------------------------------*/
+
+/*----PUSH APART (A TOGGLES IN GAME): LOOSE PIECES DROPPED OR SCRAMBLED ONTO OTHERS ARE NUDGED OUT FROM UNDER THEM-------*/
+bool PUSH_APART = false;
+/*-----------------------------------------------------------------------------------------------------------------------*/
+
+/*----CO-OP (SET COOP_SERVER TO A SERVE_COOP SOCKET PATH OR PORT TO SOLVE EVERY LEVEL TOGETHER WITH THE OTHER PLAYERS OF COOP_ROOM)-------*/
+const char* COOP_SERVER = nullptr; // e.g. "/tmp/puzzle_coop.sock" or "7777"; nullptr plays alone
+unsigned int COOP_ROOM = 1;
+/*----------------------------------------------------------------------------------------------------------------------------------------*/
+
+/*----REPLAYS (EVERY LEVEL SOLVED ALONE IS SAVED TO REPLAY_PREFIX + STAGE + ".rpl" FOR VERIFY_REPLAYS; NULLPTR SAVES NONE)-------*/
+const char* REPLAY_PREFIX = "puzzle_replay_"; // each run replaces the last run's replay of the stage
+/*-------------------------------------------------------------------------------------------------------------------------------*/
+
+/*----FRAME PACING (P CYCLES VSYNC / ADAPTIVE VSYNC / CAPPED AT TARGET_FPS / UNCAPPED IN GAME)-------*/
+PacingMode PACING_MODE = PACING_VSYNC;
+float TARGET_FPS = 60.0f;
+float GL_TASK_BUDGET_MS = 4.0f; // per frame, for uploads and other GL work spread over frames
+/*-----------------------------------------------------------------------------------------------------*/
+
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow *window);
-PuzzlePiece* retrievePuzzlePieceByID(int& id);
-void addToPuzzleGroup(PuzzlePiece* src, PuzzlePiece* dst);
 
 // settings
 std::string PRGNAME = "GET READY...";
 int SCR_WIDTH = 800;
 int SCR_HEIGHT = 600;
+int IMG_WIDTH, IMG_HEIGHT; // size of the level picture; the window is only this big when it fits on screen
+const int MAX_WINDOW_WIDTH = 1600;
+const int MAX_WINDOW_HEIGHT = 1000;
 bool GAME_OVER_FLAG = false;
 unsigned int PIECE_ROWS = 4;
 unsigned int PIECE_COLS = 4;
-unsigned int NUM_PIECES;
-float PIECE_WIDTH = 2.0f/(float)PIECE_COLS; //in OpenGL space x = [-1,1]
-float PIECE_HEIGHT = 2.0f/(float)PIECE_ROWS; // in OpenGL space y = [-1,1]
-const int NUM_NEIGHBORS = 4;
-const float THRESHOLD = 0.02f;
-const char* IMAGE_FILENAME = "../testimage.jpg";
+const float ZOOM_STEP = 1.15f;     // per scroll wheel notch
+const float KEY_PAN_SPEED = 0.02f; // fraction of the view per frame
+const char* LEVEL_BUNDLE = "levels.pzl";      // pre-decoded levels, built next to the executable by pack_levels
+const char* LEVEL_MANIFEST = "../levels.txt"; // decoded at startup when no bundle has been built
+const char* STREAMED_LEVEL = "streamed_level.pzl"; // unpacked poster-sized pictures are streamed into this first
+const unsigned int BLIND_PICTURE_SIZE = 2048; // the blind assist reads the finest mip at most this large
+const unsigned int SORT_PICTURE_SIZE = 256;    // sorting into trays samples piece colours from a mip this large
+const char* SAVE_FILE = "puzzle.sav";   // the board in progress, resumed on the next start
+const float AUTOSAVE_SECONDS = 5.0f;
+const float HINT_SECONDS = 3.0f;   // how long a hint stays highlighted
+const float HINT_HIGHLIGHT = 0.45f; // how far hinted pieces are tinted towards the highlight color
+const float LATENCY_REPORT_SECONDS = 2.0f; // drag latency is logged this often while dragging
+const float FRAME_REPORT_SECONDS = 5.0f;   // frame time statistics are logged this often
+const unsigned int TEXTURE_UPLOAD_BAND_BYTES = 1 << 20; // picture rows uploaded per frame task step
+const unsigned int MOUSE_POINTER = 0; // the board pointer the mouse drags with
 
 //flags
-bool mouseDown = false;
+bool panning = false;
+bool pointer_down = false; // left button held since a press the simulation was sent
+bool late_latch = true; // L toggles: drag from cursor events and re-sample before drawing, or once per frame
 bool keys[1024] = { 0 };
-
-
-bool compare_pieces (const PuzzlePiece* lhs, const PuzzlePiece* rhs) { // comparison operator for set ordering
-    return lhs->z < rhs->z;
-}
-std::vector<PuzzlePiece*> pieces;
-PuzzlePiece* active_piece;
-float drag_location_x, drag_location_y; //for click and drag
+bool tear_control = false; // the driver takes a negative swap interval (adaptive vsync)
+
+Board board; // owned by the simulation thread while a level runs
+Simulation simulation;
+CoopClient coop; // connected while a level is played co-op: the server moves the pieces and the board mirrors it
+glm::vec2 pan_anchor; // world point held under the cursor while panning
+Camera camera;
+FramePacer pacer;
+FrameTaskScheduler gl_tasks; // GL thread work that is spread over frames
+TileSource* PICTURE_SOURCE = nullptr; // the current level's picture, whichever way it is textured
+int hint_pieces[2] = { -1, -1 };
+sc::high_resolution_clock::time_point hint_until;
+
+glm::vec2 drag_cursor;      // latest world cursor sent while the left button is down
+int64_t drag_cursor_ns = 0; // when it was read (steady clock)
+
+// input-to-present latency of the held group: from reading the cursor that placed it to the swap returning
+struct DragLatency {
+    sc::high_resolution_clock::time_point reported;
+    double total, worst; // seconds
+    unsigned int frames;
+};
+DragLatency drag_latency = DragLatency();
 
 const char *vertexShaderSource = "#version 330 core\n"
     "layout (location = 0) in vec3 aPos;\n"
     "layout (location = 1) in vec2 aTexCoord;\n"
     "uniform vec3 offset;\n"
+    "uniform vec2 rotation;\n" // cos and sin of the piece's angle
     "uniform vec2 texOffset;\n"
+    "uniform mat4 viewProjection;\n"
     "out vec2 TexCoord;"
     "void main()\n"
     "{\n"
-    "   gl_Position = vec4(aPos+offset, 1.0);\n"
+    "   vec2 turned = vec2(rotation.x * aPos.x - rotation.y * aPos.y, rotation.y * aPos.x + rotation.x * aPos.y);\n"
+    "   gl_Position = viewProjection * vec4(vec3(turned, aPos.z)+offset, 1.0);\n"
     "   TexCoord = aTexCoord + texOffset;"
     "}\0";
 const char *fragmentShaderSource = "#version 330 core\n"
     "in vec2 TexCoord;"
     "out vec4 FragColor;\n"
     "uniform sampler2D ourTexture;"
+    "uniform float highlight;\n"
     "void main()\n"
     "{\n"
-    "   FragColor = texture(ourTexture, TexCoord);\n"
+    "   FragColor = mix(texture(ourTexture, TexCoord), vec4(1.0, 0.85, 0.2, 1.0), highlight);\n"
     "}\n\0";
 
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
 
+    if(button == GLFW_MOUSE_BUTTON_RIGHT) {
+        // right drag pans the table
+        panning = action == GLFW_PRESS;
+        if(panning) {
+            double xpos, ypos;
+            int width, height;
+            glfwGetCursorPos(window, &xpos, &ypos);
+            glfwGetWindowSize(window, &width, &height);
+            pan_anchor = camera.screenToWorld(xpos, ypos, width, height);
+        }
+    }
+
     if(button == GLFW_MOUSE_BUTTON_LEFT ) {
         if(action == GLFW_PRESS) {
             double xpos, ypos;
+            int width, height;
             glfwGetCursorPos(window, &xpos, &ypos);
-            float x = 2.0f * ((float)xpos / SCR_WIDTH - 0.5f);
-            float y = -2.0f * ((float)ypos / SCR_HEIGHT - 0.5f);
-            for(auto it = pieces.rbegin(); it != pieces.rend(); ++it){ //reverse iterate (highest Z pieces first)
-                if(x >= (*it)->x-PIECE_WIDTH/2  && x < (*it)->x+PIECE_WIDTH/2 && y>= (*it)->y-PIECE_HEIGHT/2 && y < (*it)->y+PIECE_HEIGHT/2){
-                    active_piece = *it;
-                    drag_location_x = x - active_piece->x;
-                    drag_location_y = y - active_piece->y;
-
-                    // reorder draw order of pieces
-                    active_piece->z = (*pieces.rbegin())->z + 1;
-                    for(auto p : active_piece->group){
-                        p.first->z = (*pieces.rbegin())->z +1;
-                    }
-
-                    std::sort(pieces.begin(),pieces.end(),compare_pieces); //always sort by z value after modifying z
-
-                    mouseDown = true;
-                    break;
-                }
+            glfwGetWindowSize(window, &width, &height);
+            glm::vec2 cursor = camera.screenToWorld(xpos, ypos, width, height);
+            SimCommand c = SimCommand();
+            c.type = SIM_PRESS;
+            c.pointer = MOUSE_POINTER;
+            c.x = cursor.x;
+            c.y = cursor.y;
+            c.sampledNs = steadyNanoseconds();
+            if (coop.connected()) {
+                coop.press(c.x, c.y);
+            } else {
+                simulation.send(c);
             }
+            pointer_down = true;
+            drag_cursor = cursor;
+            drag_cursor_ns = c.sampledNs;
         }
         else if(action == GLFW_RELEASE){
-            mouseDown = false;
-
-            //std::cout << "Active Piece " << active_piece->id << " :(" << active_piece->x << "," << active_piece->y << ")" << std::endl;
-
-            //Determine all pieces to check for neighbor proximity
-            std::vector<PuzzlePiece*> activePieces;
-            activePieces.push_back(active_piece);
-            for (auto ap : active_piece->group){
-                activePieces.push_back(ap.first);
+            SimCommand c = SimCommand();
+            c.type = SIM_RELEASE;
+            c.pointer = MOUSE_POINTER;
+            c.sampledNs = steadyNanoseconds();
+            if (coop.connected()) {
+                coop.release(c.sampledNs);
+            } else {
+                simulation.send(c);
             }
+            pointer_down = false;
+        }
+    }
+}
 
-            for (auto ap : activePieces) {
+// pan and drag so the world point under the cursor follows it
+void followCursor(GLFWwindow* window, double xpos, double ypos)
+{
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+    if(panning){
+        glm::vec2 drift = pan_anchor - camera.screenToWorld(xpos, ypos, width, height);
+        camera.pan(drift.x, drift.y);
+    }
+    if(pointer_down){
+        // a drag without a held piece is ignored by the board, so there is no need to wait and see what was grabbed
+        drag_cursor = camera.screenToWorld(xpos, ypos, width, height);
+        drag_cursor_ns = steadyNanoseconds();
+        SimCommand c = SimCommand();
+        c.type = SIM_DRAG;
+        c.pointer = MOUSE_POINTER;
+        c.x = drag_cursor.x;
+        c.y = drag_cursor.y;
+        c.sampledNs = drag_cursor_ns;
+        if (coop.connected()) {
+            coop.drag(c.x, c.y, c.sampledNs);
+        } else {
+            simulation.send(c);
+        }
+    }
+}
 
+// every motion event, not just where the cursor is once per frame
+void cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
+{
+    if(late_latch) {
+        followCursor(window, xpos, ypos);
+    }
+}
 
-                //check if the active piece has been placed somewhere close to any of it's correct neighbors
-                for (int n = 0; n < NUM_NEIGHBORS; ++n) {
-                    //std::cout << "Checking neighbor: " << n << std::endl;
-                    if (ap->neighborList[n] == -1) {
-                        //has no neighbor in this coordinate
-                        continue;
-                    }
-                    int index = ap->neighborList[n];
-                    auto cand_neigh = retrievePuzzlePieceByID(index);
-                    float distX, distY;
-                    float initX = ap->x;
-                    float initY = ap->y;
-                    float offX = 0.0f;
-                    float offY = 0.0f;
-                    switch (n) {
-                        //[L,R,T,B]
-                        case 0:
-                            //LEFT NEIGHBOR
-                            distX = std::abs((cand_neigh->x + PIECE_WIDTH / 2) - (ap->x - PIECE_WIDTH / 2));
-                            distY = std::abs(cand_neigh->y - ap->y);
-
-                            if (distX <= THRESHOLD && distY <= THRESHOLD) {
-                                ap->x = cand_neigh->x + PIECE_WIDTH;
-                                ap->y = cand_neigh->y;
-                                offX = ap->x - initX;
-                                offY = ap->y - initY;
-                                for (auto grouped : ap->group){
-                                    grouped.first->x += offX;
-                                    grouped.first->y += offY;
-                                }
-
-                                addToPuzzleGroup(ap, cand_neigh);
-
-                                std::vector<PuzzlePiece *> pieceStructure;
-                                pieceStructure.push_back(cand_neigh);
-                                pieceStructure.push_back(ap);
-                                for (auto p : ap->group) {
-                                    pieceStructure.push_back(p.first);
-                                }
-                                for (auto p : cand_neigh->group) {
-                                    pieceStructure.push_back(p.first);
-                                }
-
-                                for (auto p1 : pieceStructure) {
-                                    for (auto p2 : pieceStructure) {
-                                        if (p1->id == p2->id) {
-                                            continue;
-                                        }
-                                        addToPuzzleGroup(p1, p2);
-                                    }
-                                }
-                            }
-                            break;
-                        case 1:
-                            //RIGHT NEIGHBOR
-                            distX = std::abs((ap->x + PIECE_WIDTH / 2) - (cand_neigh->x - PIECE_WIDTH / 2));
-                            distY = std::abs(cand_neigh->y - ap->y);
-                            if (distX <= THRESHOLD && distY <= THRESHOLD) {
-                                ap->x = cand_neigh->x - PIECE_WIDTH;
-                                ap->y = cand_neigh->y;
-                                offX = ap->x - initX;
-                                offY = ap->y - initY;
-                                for (auto grouped : ap->group){
-                                    grouped.first->x += offX;
-                                    grouped.first->y += offY;
-                                }
-
-                                addToPuzzleGroup(ap, cand_neigh);
-
-                                std::vector<PuzzlePiece *> pieceStructure;
-                                pieceStructure.push_back(cand_neigh);
-                                pieceStructure.push_back(ap);
-                                for (auto p : ap->group) {
-                                    pieceStructure.push_back(p.first);
-                                }
-                                for (auto p : cand_neigh->group) {
-                                    pieceStructure.push_back(p.first);
-                                }
-
-                                for (auto p1 : pieceStructure) {
-                                    for (auto p2 : pieceStructure) {
-                                        if (p1->id == p2->id) {
-                                            continue;
-                                        }
-                                        addToPuzzleGroup(p1, p2);
-                                    }
-                                }
-                            }
-
-                            break;
-                        case 2:
-                            //TOP NEIGHBOR
-                            distX = std::abs((cand_neigh->y - PIECE_HEIGHT / 2) - (ap->y + PIECE_HEIGHT / 2));
-                            distY = std::abs(cand_neigh->x - ap->x);
-                            if (distX <= THRESHOLD && distY <= THRESHOLD) {
-                                ap->y = cand_neigh->y - PIECE_HEIGHT;
-                                ap->x = cand_neigh->x;
-                                offX = ap->x - initX;
-                                offY = ap->y - initY;
-                                for (auto grouped : ap->group){
-                                    grouped.first->x += offX;
-                                    grouped.first->y += offY;
-                                }
-
-
-                                addToPuzzleGroup(ap, cand_neigh);
-
-                                std::vector<PuzzlePiece *> pieceStructure;
-                                pieceStructure.push_back(cand_neigh);
-                                pieceStructure.push_back(ap);
-                                for (auto p : ap->group) {
-                                    pieceStructure.push_back(p.first);
-                                }
-                                for (auto p : cand_neigh->group) {
-                                    pieceStructure.push_back(p.first);
-                                }
-
-                                for (auto p1 : pieceStructure) {
-                                    for (auto p2 : pieceStructure) {
-                                        if (p1->id == p2->id) {
-                                            continue;
-                                        }
-                                        addToPuzzleGroup(p1, p2);
-                                    }
-                                }
-                            }
-
-                            break;
-                        case 3:
-                            //BOTTOM NEIGHBOR
-                            distX = std::abs((ap->y - PIECE_HEIGHT / 2) - (cand_neigh->y + PIECE_HEIGHT / 2));
-                            distY = std::abs(cand_neigh->x - ap->x);
-                            if (distX <= THRESHOLD && distY <= THRESHOLD) {
-
-                                ap->y = cand_neigh->y + PIECE_HEIGHT;
-                                ap->x = cand_neigh->x;
-                                offX = ap->x - initX;
-                                offY = ap->y - initY;
-                                for (auto grouped : ap->group){
-                                    grouped.first->x += offX;
-                                    grouped.first->y += offY;
-                                }
-
-
-
-                                addToPuzzleGroup(ap, cand_neigh);
-
-                                std::vector<PuzzlePiece *> pieceStructure;
-                                pieceStructure.push_back(cand_neigh);
-                                pieceStructure.push_back(ap);
-                                for (auto p : ap->group) {
-                                    pieceStructure.push_back(p.first);
-                                }
-                                for (auto p : cand_neigh->group) {
-                                    pieceStructure.push_back(p.first);
-                                }
-
-                                for (auto p1 : pieceStructure) {
-                                    for (auto p2 : pieceStructure) {
-                                        if (p1->id == p2->id) {
-                                            continue;
-                                        }
-                                        addToPuzzleGroup(p1, p2);
-                                    }
-                                }
-                            }
-
-                            break;
-                        default:
-                            std::cout << "[ERROR] Neighbor Index Not Properly Initialized";
-                            exit(-1);
-                    }
-                    //std::cout << "End of For Loop iteration" << std::endl;
-                }
-            }
-        }
+// right before the frame is drawn, so the held group shows where the cursor is now rather than at the frame's start
+void latchCursor(GLFWwindow* window)
+{
+    if(!late_latch || (!pointer_down && !panning)) {
+        return;
     }
+    glfwPollEvents();
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    followCursor(window, xpos, ypos);
+}
+
+// sampledNs: when the cursor position the held group was drawn at was read
+void reportDragLatency(bool holding, int64_t sampledNs)
+{
+    auto now = sc::high_resolution_clock::now();
+    if(holding) {
+        double latency = (steadyNanoseconds() - sampledNs) * 1e-9;
+        drag_latency.total += latency;
+        drag_latency.worst = std::max(drag_latency.worst, latency);
+        drag_latency.frames++;
+    }
+    if(drag_latency.frames > 0 && sc::duration<float>(now - drag_latency.reported).count() >= LATENCY_REPORT_SECONDS) {
+        LOG_DEBUG("DRAG LATENCY ({}): {}ms AVERAGE, {}ms WORST OVER {} FRAMES", late_latch ? "late latched" : "per frame",
+                  drag_latency.total / drag_latency.frames * 1000, drag_latency.worst * 1000, drag_latency.frames);
+        drag_latency.total = drag_latency.worst = 0;
+        drag_latency.frames = 0;
+        drag_latency.reported = now;
+    }
+}
+
+void scroll_callback(GLFWwindow* window, double /*xoffset*/, double yoffset)
+{
+    double xpos, ypos;
+    int width, height;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    glfwGetWindowSize(window, &width, &height);
+    camera.zoomAt(xpos, ypos, width, height, std::pow(ZOOM_STEP, (float)yoffset));
+}
+
+void fitCameraToTable(){
+    float extent = board.tableExtent();
+    camera.fit(-extent, -extent, extent, extent);
+    // from one piece filling half the window out to a margin around the table
+    camera.setZoomLimits(std::max(board.pieceWidth(), board.pieceHeight()), extent * 1.5f);
 }
 
 void scramble(){
-    float range_max = 1 - (PIECE_WIDTH / 2);
-    float range_min = (-1) + (PIECE_WIDTH / 2);
-    float range = range_max - range_min;
-    float random;
+    uint64_t seed = SCRAMBLE_SEED != 0 ? SCRAMBLE_SEED : freshScrambleSeed();
+    SimCommand c = SimCommand();
+    c.type = SIM_SCRAMBLE;
+    c.mode = SCRAMBLE_MODE;
+    c.rotation = ROTATION_MODE;
+    c.seed = seed;
+    simulation.send(c);
+    LOG_INFO("SCRAMBLED ({}, {} ROTATION, SEED {})", scrambleModeName(SCRAMBLE_MODE), rotationModeName(ROTATION_MODE), seed);
+}
+
+void blindAssist(){
+    // lay the pieces out from the picture content alone, then let them snap wherever that put true neighbours together;
+    // only what setup fixed (sizes, tx/ty, home positions) is read here, the board itself belongs to the simulation
+    std::vector<unsigned char> pixels;
+    unsigned int width, height;
+    if (board.topology().kind != TOPOLOGY_GRID) {
+        LOG_ERROR("Blind assist only solves grid cuts");
+        return;
+    }
+    if (PICTURE_SOURCE == nullptr || board.count() == 0
+        || !readMipPicture(*PICTURE_SOURCE, BLIND_PICTURE_SIZE, pixels, width, height)) {
+        LOG_ERROR("No picture to solve from");
+        return;
+    }
+    std::vector<BlindTile> tiles(board.count());
+    for (unsigned int i = 0; i < board.count(); ++i) {
+        const PuzzlePiece* p = board.piece(i);
+        unsigned int x0 = (unsigned int)(p->tx * width), y0 = (unsigned int)(p->ty * height);
+        unsigned int x1 = (unsigned int)((p->tx + board.pieceWidth() / 2) * width);
+        unsigned int y1 = (unsigned int)((p->ty + board.pieceHeight() / 2) * height);
+        BlindTile t = { x0, y0, std::min(x1, width) - x0, std::min(y1, height) - y0 };
+        tiles[i] = t;
+    }
+
+    std::vector<glm::ivec2> cells;
+    BlindSolveStats stats;
+    if (!blindSolve(&pixels[0], width, height, tiles, board.rows(), board.cols(), cells, &stats)) {
+        LOG_ERROR("Blind solve failed ({}x{} picture)", width, height);
+        return;
+    }
+    SimCommand c = SimCommand();
+    c.type = SIM_ARRANGE;
+    c.centers = new std::vector<glm::vec2>(board.count());
+    unsigned int correct = 0;
+    for (unsigned int i = 0; i < board.count(); ++i) {
+        unsigned int cell = cells[i].y * board.cols() + cells[i].x;
+        (*c.centers)[i] = board.homePosition(cell);
+        correct += cell == i;
+    }
+    simulation.send(c);
+    LOG_INFO("BLIND ASSIST ({}): {}/{} PIECES IN PLACE, {}ms", edgeKernelName(stats.kernel), correct, board.count(),
+             (stats.extractSeconds + stats.compareSeconds + stats.layoutSeconds) * 1000);
+}
 
-    srand(time(NULL));
+void sortIntoTrays(){
+    // colours are sampled here from what setup fixed; the simulation moves the pieces that are still loose then
+    auto start = sc::high_resolution_clock::now();
+    std::vector<unsigned char> pixels;
+    unsigned int width, height;
+    if (PICTURE_SOURCE == nullptr || board.count() == 0
+        || !readMipPicture(*PICTURE_SOURCE, SORT_PICTURE_SIZE, pixels, width, height)) {
+        LOG_ERROR("No picture to sort by");
+        return;
+    }
+    SimCommand c = SimCommand();
+    c.type = SIM_SORT;
+    c.bins = new std::vector<unsigned char>();
+    c.mode = COLOR_BIN_COUNT;
+    dominantColors(board.topology(), &pixels[0], width, height, *c.bins);
+    simulation.send(c);
+    LOG_INFO("SORTED INTO TRAYS BY {} COLOURS ({}x{} PICTURE): {}ms", COLOR_BIN_COUNT, width, height,
+             sc::duration<float, std::milli>(sc::high_resolution_clock::now() - start).count());
+}
 
-    for(auto p : pieces){
-        random = ((float)rand()) / (float) RAND_MAX;
-        p->x = (random * range) + range_min;
-        random = ((float)rand()) / (float) RAND_MAX;
-        p->y = (random * range) + range_min;
-        p->group.clear(); //ungroup all pieces
+// the simulation's answer to the last SIM_HINT
+void showHint(const RenderSnapshot& snap){
+    if (!snap.hintFound) {
+        return;
+    }
+    hint_pieces[0] = snap.hintPieces[0];
+    hint_pieces[1] = snap.hintPieces[1];
+    hint_until = sc::high_resolution_clock::now() + sc::milliseconds((int)(HINT_SECONDS * 1000));
+    // bring the pair into view if either piece is off screen
+    float viewMinX, viewMinY, viewMaxX, viewMaxY;
+    camera.visibleRect(viewMinX, viewMinY, viewMaxX, viewMaxY);
+    glm::vec2 lo = glm::min(snap.hintPositions[0], snap.hintPositions[1]);
+    glm::vec2 hi = glm::max(snap.hintPositions[0], snap.hintPositions[1]);
+    if (lo.x < viewMinX || lo.y < viewMinY || hi.x > viewMaxX || hi.y > viewMaxY) {
+        glm::vec2 to = (lo + hi) * 0.5f - camera.center();
+        camera.pan(to.x, to.y);
     }
+    LOG_INFO("HINT: PIECE {} GOES NEXT TO PIECE {}", hint_pieces[0], hint_pieces[1]);
 }
 
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods){
@@ -347,19 +404,103 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
     } else if(action == GLFW_RELEASE) {
         keys[key] = false;
     }
+    bool solo = !coop.connected(); // in a co-op room only the server moves pieces, and only by pointer
 
-    if(keys[GLFW_KEY_S]){
+    if(keys[GLFW_KEY_S] && solo){
         scramble();
     }
 
-    if(keys[GLFW_KEY_D]){
-        for (auto p : pieces){
-            std::cout << "PIECE " << p->id << " HAS BEEN GROUPED WITH " << p->group.size() << " PIECES" << std::endl;
+    if(key == GLFW_KEY_T && action == GLFW_PRESS && solo){
+        sortIntoTrays();
+    }
+
+    if(key == GLFW_KEY_M && action == GLFW_PRESS && solo){
+        SCRAMBLE_MODE = (ScrambleMode)((SCRAMBLE_MODE + 1) % SCRAMBLE_MODE_COUNT);
+        scramble();
+    }
+
+    if(key == GLFW_KEY_R && action == GLFW_PRESS && solo){
+        ROTATION_MODE = (RotationMode)((ROTATION_MODE + 1) % ROTATION_MODE_COUNT);
+        scramble();
+    }
+
+    // held keys repeat, so free rotation keeps turning while Q or E is down
+    if((key == GLFW_KEY_Q || key == GLFW_KEY_E) && action != GLFW_RELEASE && pointer_down && ROTATION_MODE != ROTATION_NONE){
+        float step = ROTATION_MODE == ROTATION_QUARTER ? glm::radians(90.0f) : glm::radians(FREE_ROTATION_STEP_DEGREES);
+        SimCommand c = SimCommand();
+        c.type = SIM_ROTATE;
+        c.pointer = MOUSE_POINTER;
+        c.x = key == GLFW_KEY_Q ? step : -step;
+        if (coop.connected()) {
+            coop.rotate(c.x);
+        } else {
+            simulation.send(c);
         }
     }
+
+    if(key == GLFW_KEY_A && action == GLFW_PRESS && solo){
+        PUSH_APART = !PUSH_APART;
+        SimCommand c = SimCommand();
+        c.type = SIM_PUSH_APART;
+        c.mode = PUSH_APART;
+        simulation.send(c);
+        LOG_INFO("PUSH APART {}", PUSH_APART ? "ON" : "OFF");
+    }
+
+    if(key == GLFW_KEY_W && action == GLFW_PRESS && solo){
+        double xpos, ypos;
+        int width, height;
+        glfwGetCursorPos(window, &xpos, &ypos);
+        glfwGetWindowSize(window, &width, &height);
+        glm::vec2 cursor = camera.screenToWorld(xpos, ypos, width, height);
+        float viewWidth = camera.screenToWorld(width, 0, width, height).x - camera.screenToWorld(0, 0, width, height).x;
+        SimCommand c = SimCommand();
+        c.type = SIM_SWEEP;
+        // kept to the table, as a replay verifier only accepts it there
+        float extent = board.tableExtent();
+        c.x = std::min(std::max(cursor.x, -extent), extent);
+        c.y = std::min(std::max(cursor.y, -extent), extent);
+        c.x2 = std::min(SWEEP_RADIUS * viewWidth, 2 * extent);
+        c.y2 = SWEEP_SPEED * viewWidth;
+        simulation.send(c);
+    }
+
+    if(keys[GLFW_KEY_F]){
+        fitCameraToTable();
+    }
+
+    if(keys[GLFW_KEY_D]){
+        SimCommand c = SimCommand();
+        c.type = SIM_DUMP_GROUPS;
+        simulation.send(c);
+    }
+
+    if(key == GLFW_KEY_L && action == GLFW_PRESS){
+        late_latch = !late_latch;
+        LOG_INFO("LATE LATCHING {}", late_latch ? "ON" : "OFF");
+    }
+
+    if(key == GLFW_KEY_P && action == GLFW_PRESS){
+        PACING_MODE = (PacingMode)((PACING_MODE + 1) % PACING_MODE_COUNT);
+        pacer.setMode(PACING_MODE, TARGET_FPS);
+        glfwSwapInterval(pacer.swapInterval(tear_control));
+        LOG_INFO("FRAME PACING: {} (SWAP INTERVAL {}, TARGET {} FPS)", pacingModeName(PACING_MODE),
+                 pacer.swapInterval(tear_control), TARGET_FPS);
+    }
+
+    if(key == GLFW_KEY_H && action == GLFW_PRESS){
+        SimCommand c = SimCommand();
+        c.type = SIM_HINT;
+        simulation.send(c);
+    }
+
+    if(key == GLFW_KEY_B && action == GLFW_PRESS && DEBUG_MODE && solo){
+        blindAssist();
+    }
 }
 
-GLuint loadTexture(unsigned char * image) {
+// allocates every mip of the picture's texture; the pixels are uploaded by uploadTexture over the next frames
+GLuint createPictureTexture(unsigned int numMips) {
 
     GLuint textureID = 0;
     glGenTextures(1, &textureID);
@@ -370,74 +511,75 @@ GLuint loadTexture(unsigned char * image) {
     // set texture filtering parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    stbi_image_free(image);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numMips - 1);
+    for (unsigned int m = 0; m < numMips; ++m) {
+        GLsizei w = std::max(1, IMG_WIDTH >> m);
+        GLsizei h = std::max(1, IMG_HEIGHT >> m);
+        glTexImage2D(GL_TEXTURE_2D, m, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
     return textureID;
 }
 
-void setup_pieces(){ //set up a grid of puzzle pieces
-    // draws pieces in reading order (left -> right, top -> bottom)
-    int pieces_per_row = NUM_PIECES / PIECE_ROWS;
-    for(int i=0; i<NUM_PIECES; ++i){
-        auto p = new PuzzlePiece;
-        p->x = PIECE_WIDTH*(i % pieces_per_row) - (1-PIECE_HEIGHT/2);
-        p->y = -PIECE_HEIGHT*(i/pieces_per_row) + (1-PIECE_HEIGHT/2);
-        p->z = i;
-        p->tx = PIECE_WIDTH*(i % pieces_per_row)/2;
-        p->ty = PIECE_HEIGHT*(i/pieces_per_row)/2;
-        //std::cout << "placing piece " << i << " at (" << p->x << "," << p->y << ") rgb: (" << p->tx << "," << p->ty << ")" << std::endl;
-        p->id = i;
-
-        //[L,R,T,B]
-        p->neighborList[0] = (i%pieces_per_row == 0) ? -1 : i-1;
-        p->neighborList[1] = (i%pieces_per_row == pieces_per_row-1) ? -1: i+1;
-        p->neighborList[2] = (0 <= i && i < pieces_per_row) ? -1 : i - pieces_per_row;
-        p->neighborList[3] = (NUM_PIECES - pieces_per_row <= i && i < NUM_PIECES) ? -1: i + pieces_per_row;
-        pieces.push_back(p);
-    }
-    // DEBUG
-    /*
-    for (auto p : pieces) {
-        std::cout << "--------------------\nPiece " << p->id << " has following neighbors:" << std::endl;
-        if (p->neighborList[0] == -1){
-            std::cout << "LEFT NEIGHBOR: NONE" << std::endl;
-        }
-        else {
-            std::cout << "LEFT NEIGHBOR: " << p->neighborList[0] << std::endl;
-        }
-        if (p->neighborList[1] == -1){
-            std::cout << "RIGHT NEIGHBOR: NONE" << std::endl;
-        }
-        else {
-            std::cout << "RIGHT NEIGHBOR: " << p->neighborList[1] << std::endl;
-        }
-        if (p->neighborList[2] == -1){
-            std::cout << "TOP NEIGHBOR: NONE" << std::endl;
+// a frame task uploading mip(m) for every mip of tex, a band of rows per step; mip(m) may return nullptr while
+// that mip is not ready yet, which blocks the task until a later frame
+std::function<FrameStep()> uploadTexture(GLuint tex, unsigned int numMips, std::function<const unsigned char*(unsigned int)> mip) {
+    unsigned int m = 0, row = 0;
+    return [=]() mutable {
+        const unsigned char* pixels = mip(m);
+        if (pixels == nullptr) {
+            return FRAME_STEP_BLOCKED;
         }
-        else {
-            std::cout << "TOP NEIGHBOR: " << p->neighborList[2] << std::endl;
+        unsigned int w = std::max(1, IMG_WIDTH >> m), h = std::max(1, IMG_HEIGHT >> m);
+        unsigned int rows = std::min(h - row, std::max(1u, TEXTURE_UPLOAD_BAND_BYTES / (w * 4)));
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage2D(GL_TEXTURE_2D, m, 0, row, w, rows, GL_RGBA, GL_UNSIGNED_BYTE, pixels + (size_t)row * w * 4);
+        row += rows;
+        if (row == h) {
+            row = 0;
+            m++;
         }
-        if (p->neighborList[3] == -1){
-            std::cout << "BOTTOM NEIGHBOR: NONE" << std::endl;
-        }
-        else {
-            std::cout << "BOTTOM NEIGHBOR: " << p->neighborList[3] << std::endl;
-        }
-    }
-     */
+        return m == numMips ? FRAME_STEP_DONE : FRAME_STEP_MORE;
+    };
+}
 
-    //manually group first two pieces for testing
-    /*
-    PuzzlePiece* p = *pieces.begin();
-    PuzzlePiece* p2 = *(++pieces.begin());
-    glm::vec2 v(p2->x - p->x,p2->y - p->y);
-    p->group.insert(std::pair<PuzzlePiece*,glm::vec2>(p2,v));
-    v.x = p->x - p2->x;
-    v.y = p->y - p2->y;
-    p2->group.insert(std::pair<PuzzlePiece*,glm::vec2>(p,v));
-    */
+GLuint buildShaderProgram(const char* vertexSource, const char* fragmentSource) {
+    // vertex shader
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexSource, nullptr);
+    glCompileShader(vertexShader);
+    // check for shader compile errors
+    int success;
+    char infoLog[512];
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(vertexShader, 512, nullptr, infoLog);
+        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+    // fragment shader
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
+    glCompileShader(fragmentShader);
+    // check for shader compile errors
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(fragmentShader, 512, nullptr, infoLog);
+        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+    // link shaders
+    GLuint shaderProgram = glCreateProgram();
+    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, fragmentShader);
+    glLinkProgram(shaderProgram);
+    // check for linking errors
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(shaderProgram, 512, nullptr, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return shaderProgram;
 }
 
 GLFWwindow *window = nullptr;
@@ -453,7 +595,7 @@ int main(int argc, char** argv)
 {
     /*
     if(argc > 1){
-        IMAGE_FILENAME = argv[1];
+        LEVEL_BUNDLE = argv[1];
     }
     if(argc > 2){
         PIECE_ROWS = std::atoi(argv[2]);
@@ -461,41 +603,118 @@ int main(int argc, char** argv)
     if(argc > 3){
         PIECE_COLS = std::atoi(argv[3]);
     }*/
+    // in-game diagnostics go through the log ring, written by its own thread
+    startLogger();
+
+    // levels are data: use the pre-decoded bundle when it has been built, otherwise decode the manifest's pictures
+    LevelBundle bundle;
+    std::vector<LevelDesc> levels;
+    if (bundle.open(LEVEL_BUNDLE)) {
+        for (unsigned int i = 0; i < bundle.numLevels(); ++i) {
+            const BundleLevel& lvl = bundle.level(i);
+            LevelDesc desc;
+            desc.rows = lvl.rows;
+            desc.cols = lvl.cols;
+            desc.countdown = lvl.countdown;
+            desc.kind = (LevelKind)lvl.kind;
+            desc.cut = (TopologyKind)lvl.cut;
+            levels.push_back(desc);
+        }
+    } else if (!readLevelManifest(LEVEL_MANIFEST, levels)) {
+        std::cout << "[ERROR] No level bundle (" << LEVEL_BUNDLE << ") or level manifest (" << LEVEL_MANIFEST << ") found" << std::endl;
+        return -1;
+    }
+
+    // stages are the playable levels in order followed by the "done" screen
+    std::vector<unsigned int> stageLevels;
+    int doneLevel = -1, gameOverLevel = -1;
+    for (unsigned int i = 0; i < levels.size(); ++i) {
+        if (levels[i].kind == LEVEL_PLAY) stageLevels.push_back(i);
+        else if (levels[i].kind == LEVEL_DONE && doneLevel < 0) doneLevel = i;
+        else if (levels[i].kind == LEVEL_GAMEOVER && gameOverLevel < 0) gameOverLevel = i;
+    }
+    if (stageLevels.empty() || doneLevel < 0 || gameOverLevel < 0) {
+        std::cout << "[ERROR] Level data needs at least one play level, a done level and a gameover level" << std::endl;
+        return -1;
+    }
+    stageLevels.push_back(doneLevel);
+    const unsigned int NUM_STAGES = stageLevels.size();
+
     unsigned int stage = 0;
     bool terminated = false;
 
-    while (stage < 4 && !terminated || GAME_OVER_FLAG) {
+    // pick up where the last session left off if its save belongs to one of the play stages
+    BoardSnapshot resume;
+    bool resuming = COOP_SERVER == nullptr && readSnapshot(SAVE_FILE, resume) && resume.stage >= 1 && resume.stage < NUM_STAGES
+                    && levels[stageLevels[resume.stage - 1]].rows == resume.rows
+                    && levels[stageLevels[resume.stage - 1]].cols == resume.cols
+                    && (uint32_t)levels[stageLevels[resume.stage - 1]].cut == resume.topology;
+    if (resuming) {
+        stage = resume.stage - 1;
+        LOG_INFO("RESUMING STAGE {} FROM {}", resume.stage, SAVE_FILE);
+    }
+    SaveWriter saveWriter(SAVE_FILE);
+
+    while (stage < NUM_STAGES && !terminated || GAME_OVER_FLAG) {
         auto start = sc::high_resolution_clock::now(); // start the clock
         stage++;
-        pieces.clear();
-        active_piece = NULL;
 
-        switch(stage)
-        {
-            case 1: IMAGE_FILENAME = "../testimage.jpg";
-                    break;
-            case 2: PIECE_COLS = PIECE_ROWS = PIECE_ROWS + 1;
-                    IMAGE_FILENAME = "../castle.jpg";
-                    break;
-            case 3: PIECE_COLS = PIECE_ROWS = PIECE_ROWS + 2;
-                    IMAGE_FILENAME = "../chick.jpg";
-                    break;
-            case 4: PIECE_COLS = PIECE_ROWS = 1;
-                    IMAGE_FILENAME = "../done.jpg";
-                    break;
-            default: IMAGE_FILENAME = "../gameover.jpg";
-        }
+        unsigned int levelIndex = GAME_OVER_FLAG ? gameOverLevel : stageLevels[stage - 1];
+        const LevelDesc& level = levels[levelIndex];
+        bool playable = level.kind == LEVEL_PLAY && !GAME_OVER_FLAG;
 
-        if (GAME_OVER_FLAG){
-            IMAGE_FILENAME = "../gameover.jpg";
+        PIECE_ROWS = level.rows;
+        PIECE_COLS = level.cols;
+        if (playable) {
+            COUNTDOWN_MAX = level.countdown;
         }
 
-        NUM_PIECES = PIECE_ROWS * PIECE_COLS;
-        PIECE_WIDTH = 2.0f / (float) PIECE_COLS; //in OpenGL space x = [-1,1]
-        PIECE_HEIGHT = 2.0f / (float) PIECE_ROWS; // in OpenGL space y = [-1,1]
-
-        int nrChannels;
-        unsigned char *image = stbi_load(IMAGE_FILENAME, &SCR_WIDTH, &SCR_HEIGHT, &nrChannels, 0);
+        board.setup(PIECE_ROWS, PIECE_COLS, level.cut);
+        // every co-op level is a room of its own on the server, joined over a connection of its own
+        if (COOP_SERVER != nullptr && playable && !coop.connect(COOP_SERVER)) {
+            LOG_ERROR("No co-op server at {}, playing alone", COOP_SERVER);
+        }
+        // A toggles it through the simulation from here on, but only alone: a co-op board that settled by itself
+        // between the server's frames would drift from the server's, which never pushes apart
+        board.setPushApart(PUSH_APART && !coop.connected());
+        const PieceTopology& topology = board.topology();
+        fitCameraToTable();
+        panning = false;
+
+        // the picture comes from a bundle level (pictureBundle/pictureIndex) or, failing that, is decoded whole
+        unsigned char *image = nullptr;
+        const LevelBundle* pictureBundle = bundle.isOpen() ? &bundle : nullptr;
+        unsigned int pictureIndex = levelIndex;
+        LevelBundle streamedBundle;
+        unsigned int sourceWidth = 0, sourceHeight = 0;
+        if (pictureBundle == nullptr && readImageSize(level.image.c_str(), sourceWidth, sourceHeight)
+            && (sourceWidth > VIRTUAL_TEXTURE_MIN_SIZE || sourceHeight > VIRTUAL_TEXTURE_MIN_SIZE)) {
+            // too large to decode in one piece: stream it into tiles on disk and map those
+            IngestStats stats;
+            if (!ingestLevelBundle(level, STREAMED_LEVEL, &stats) || !streamedBundle.open(STREAMED_LEVEL)) {
+                std::cout << "[ERROR] Could not stream " << level.image << std::endl;
+                return -1;
+            }
+            std::cout << "Streamed " << level.image << " into " << stats.tiles << " tiles in " << stats.seconds << "s" << std::endl;
+            pictureBundle = &streamedBundle;
+            pictureIndex = 0;
+        }
+        if (pictureBundle != nullptr) {
+            IMG_WIDTH = pictureBundle->level(pictureIndex).width;
+            IMG_HEIGHT = pictureBundle->level(pictureIndex).height;
+        } else {
+            int nrChannels;
+            image = stbi_load(level.image.c_str(), &IMG_WIDTH, &IMG_HEIGHT, &nrChannels, STBI_rgb_alpha);
+            if (image == nullptr) {
+                std::cout << "[ERROR] Could not load " << level.image << ": " << stbi_failure_reason() << std::endl;
+                return -1;
+            }
+        }
+        bool pictureTiled = pictureBundle != nullptr && pictureBundle->level(pictureIndex).tileContent != 0;
+        // window has the picture's aspect ratio, shrunk to fit on screen when the picture is poster sized
+        float windowScale = std::min(1.0f, std::min((float)MAX_WINDOW_WIDTH / IMG_WIDTH, (float)MAX_WINDOW_HEIGHT / IMG_HEIGHT));
+        SCR_WIDTH = std::max(1, (int)(IMG_WIDTH * windowScale));
+        SCR_HEIGHT = std::max(1, (int)(IMG_HEIGHT * windowScale));
 
 
 
@@ -522,6 +741,8 @@ int main(int argc, char** argv)
         glfwMakeContextCurrent(window);
         glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
         glfwSetMouseButtonCallback(window, mouse_button_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetCursorPosCallback(window, cursor_position_callback);
         glfwSetKeyCallback(window, key_callback);
 
 
@@ -532,60 +753,37 @@ int main(int argc, char** argv)
             return -1;
         }
 
+        // pace frames as configured rather than by whatever the driver defaults to
+        tear_control = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+        pacer.setMode(PACING_MODE, TARGET_FPS);
+        glfwSwapInterval(pacer.swapInterval(tear_control));
+
         //glEnable(GL_DEPTH_TEST);
 
 
         // build and compile our shader program
         // ------------------------------------
-        // vertex shader
-        GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-        glCompileShader(vertexShader);
-        // check for shader compile errors
-        int success;
-        char infoLog[512];
-        glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(vertexShader, 512, nullptr, infoLog);
-            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-        }
-        // fragment shader
-        GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-        glCompileShader(fragmentShader);
-        // check for shader compile errors
-        glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(fragmentShader, 512, nullptr, infoLog);
-            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-        }
-        // link shaders
-        GLuint shaderProgram = glCreateProgram();
-        glAttachShader(shaderProgram, vertexShader);
-        glAttachShader(shaderProgram, fragmentShader);
-        glLinkProgram(shaderProgram);
-        // check for linking errors
-        glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(shaderProgram, 512, nullptr, infoLog);
-            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-        }
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-
-        setup_pieces();
+        GLint maxTextureSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+        int wholeTextureLimit = std::min((int)VIRTUAL_TEXTURE_MIN_SIZE, maxTextureSize);
+        bool useVirtualTexture = pictureTiled || IMG_WIDTH > wholeTextureLimit || IMG_HEIGHT > wholeTextureLimit;
+        GLuint shaderProgram = buildShaderProgram(vertexShaderSource, useVirtualTexture
+                                                                      ? virtualTextureFragmentShaderSource
+                                                                      : fragmentShaderSource);
 
         // set up vertex data (and buffer(s)) and configure vertex attributes
         // ------------------------------------------------------------------
-        float vertices[] = {
-                -PIECE_WIDTH / 2, -PIECE_HEIGHT / 2, 0.0f, 0.0f, PIECE_HEIGHT / 2, // left bottom
-                PIECE_WIDTH / 2, -PIECE_HEIGHT / 2, 0.0f, PIECE_WIDTH / 2, PIECE_HEIGHT / 2, // right bottom
-                -PIECE_WIDTH / 2, PIECE_HEIGHT / 2, 0.0f, 0.0f, 0.0f,// left top
-                -PIECE_WIDTH / 2, PIECE_HEIGHT / 2, 0.0f, 0.0f, 0.0f,// left top
-                PIECE_WIDTH / 2, -PIECE_HEIGHT / 2, 0.0f, PIECE_WIDTH / 2, PIECE_HEIGHT / 2,  // right bottom
-                PIECE_WIDTH / 2, PIECE_HEIGHT / 2, 0.0f, PIECE_WIDTH / 2, 0.0f,// right top
-        };
-        //note: having corners at (0,0) (WIDTH, WIDTH) might reduce code complexity.
+        // every piece's outline (convex, so it draws as a triangle fan), with texture coordinates relative to the
+        // top left corner of its bounding box (texOffset adds where that lies in the picture)
+        std::vector<float> vertices;
+        for (unsigned int i = 0; i < topology.count(); ++i) {
+            glm::vec2 lo = topology.boundsMin[i], hi = topology.boundsMax[i];
+            for (unsigned int v = topology.outlineStart[i]; v < topology.outlineStart[i + 1]; ++v) {
+                glm::vec2 corner = topology.outline[v];
+                float vertex[5] = { corner.x, corner.y, 0.0f, (corner.x - lo.x) / 2, (hi.y - corner.y) / 2 };
+                vertices.insert(vertices.end(), vertex, vertex + 5);
+            }
+        }
 
         unsigned int VBO, VAO;
         glGenVertexArrays(1, &VAO);
@@ -594,7 +792,7 @@ int main(int argc, char** argv)
         glBindVertexArray(VAO);
 
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
 
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *) (0 * sizeof(float)));
         glEnableVertexAttribArray(0);
@@ -609,7 +807,60 @@ int main(int argc, char** argv)
         glBindVertexArray(0);
 
         // Load texture
-        GLuint tex = loadTexture(image);
+        GLuint tex = 0;
+        JobHandle mipChain;
+        auto mips = std::make_shared<std::vector<std::vector<unsigned char> > >();
+        VirtualTexture virtualTexture;
+        MipChainTileSource tileSource(IMG_WIDTH, IMG_HEIGHT);
+        BundleTileSource bundleTiles(pictureBundle != nullptr ? *pictureBundle : bundle, pictureIndex);
+        if (pictureTiled) {
+            virtualTexture.create(&bundleTiles);
+        } else if (useVirtualTexture) {
+            if (pictureBundle != nullptr) {
+                for (unsigned int m = 0; m < pictureBundle->level(pictureIndex).numMips; ++m) {
+                    tileSource.addMip(pictureBundle->mipData(pictureIndex, m));
+                }
+            } else {
+                std::vector<std::vector<unsigned char> > mips;
+                buildMipChain(image, IMG_WIDTH, IMG_HEIGHT, mips);
+                stbi_image_free(image);
+                image = nullptr;
+                for (auto &mip : mips) {
+                    tileSource.addOwnedMip(mip);
+                }
+            }
+            virtualTexture.create(&tileSource);
+        } else {
+            if (pictureBundle != nullptr) {
+                // every mip is already decoded in the mapping: hand the mapped pages straight to the driver
+                unsigned int numMips = pictureBundle->level(pictureIndex).numMips;
+                tex = createPictureTexture(numMips);
+                gl_tasks.add(uploadTexture(tex, numMips, [=](unsigned int m) { return pictureBundle->mipData(pictureIndex, m); }));
+            } else {
+                // the finer mips are filtered on the job system while the full size picture uploads
+                unsigned int numMips = fullMipCount(IMG_WIDTH, IMG_HEIGHT);
+                tex = createPictureTexture(numMips);
+                unsigned int width = IMG_WIDTH, height = IMG_HEIGHT;
+                mipChain = createJob("mip chain", [=] { buildMipChain(image, width, height, *mips); });
+                runJob(mipChain);
+                JobHandle chain = mipChain;
+                gl_tasks.add(uploadTexture(tex, numMips, [=](unsigned int m) -> const unsigned char* {
+                    if (m == 0) {
+                        return image;
+                    }
+                    return jobFinished(chain) ? &(*mips)[m][0] : nullptr;
+                }));
+            }
+            // not sampled through, only kept for reading the picture back on the CPU
+            if (pictureBundle != nullptr) {
+                for (unsigned int m = 0; m < pictureBundle->level(pictureIndex).numMips; ++m) {
+                    tileSource.addMip(pictureBundle->mipData(pictureIndex, m));
+                }
+            } else {
+                tileSource.addMip(image);
+            }
+        }
+        PICTURE_SOURCE = pictureTiled ? (TileSource*)&bundleTiles : &tileSource;
 
         // uncomment this call to draw in wireframe polygons.
         //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -620,11 +871,43 @@ int main(int argc, char** argv)
         bool loadedImageForBeginning = false;
         auto countDownStart = sc::high_resolution_clock::now();
         auto countDownCurrent = sc::high_resolution_clock::now();
+        auto lastAutosave = countDownCurrent;
+        bool scrambled = false; // the level is being played, i.e. worth saving
+        bool solved = false;
+        // every command that moves pieces, for a leaderboard to verify the level by; the setup is as it is now
+        Replay replay = Replay();
+        replay.level = levelIndex;
+        replay.rows = PIECE_ROWS;
+        replay.cols = PIECE_COLS;
+        replay.topology = level.cut;
+        replay.pushApart = PUSH_APART;
+        auto saveProgress = [&]() {
+            // captured on the simulation thread between ticks, written out by the save thread
+            SimCommand c = SimCommand();
+            c.type = SIM_SAVE;
+            c.stage = stage;
+            c.elapsedSeconds = (uint32_t)sc::duration_cast<sc::seconds>(sc::high_resolution_clock::now() - countDownStart).count();
+            simulation.send(c);
+            lastAutosave = sc::high_resolution_clock::now();
+        };
+        GLint offsetLoc = glGetUniformLocation(shaderProgram, "offset");
+        GLint texOffsetLoc = glGetUniformLocation(shaderProgram, "texOffset");
+        GLint rotationLoc = glGetUniformLocation(shaderProgram, "rotation");
+        GLint viewProjectionLoc = glGetUniformLocation(shaderProgram, "viewProjection");
+        GLint highlightLoc = glGetUniformLocation(shaderProgram, "highlight");
+        float sentView[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        unsigned int hintSerial = 0;
+        uint64_t playFrom = 0; // completion counts from the snapshot that has the level scrambled or restored
+        pointer_down = false;
+        simulation.start(board, &saveWriter, REPLAY_PREFIX != nullptr && playable ? &replay : nullptr);
         while (!glfwWindowShouldClose(window)) {
             terminated = true;
+            // a capped frame waits here, before input is read, so it starts from the freshest input
+            pacer.wait();
+
             // input
             // -----
-            if (stage < 4 && !GAME_OVER_FLAG) {
+            if (playable) {
                 processInput(window);
             }
 
@@ -634,45 +917,160 @@ int main(int argc, char** argv)
             glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT);//| GL_DEPTH_BUFFER_BIT);
 
+            latchCursor(window);
+
+            // cull: the simulation only snapshots pieces overlapping the view, sent with a margin so that small pans
+            // are drawn from the snapshot at hand
+            float viewMinX, viewMinY, viewMaxX, viewMaxY;
+            camera.visibleRect(viewMinX, viewMinY, viewMaxX, viewMaxY);
+            if (viewMinX < sentView[0] || viewMinY < sentView[1] || viewMaxX > sentView[2] || viewMaxY > sentView[3]
+                || (viewMaxX - viewMinX) * 2.0f < sentView[2] - sentView[0]) {
+                float marginX = (viewMaxX - viewMinX) * 0.25f, marginY = (viewMaxY - viewMinY) * 0.25f;
+                SimCommand c = SimCommand();
+                c.type = SIM_VIEW;
+                c.x = sentView[0] = viewMinX - marginX;
+                c.y = sentView[1] = viewMinY - marginY;
+                c.x2 = sentView[2] = viewMaxX + marginX;
+                c.y2 = sentView[3] = viewMaxY + marginY;
+                simulation.send(c);
+            }
+            if (coop.connected()) {
+                SimCommand c = SimCommand();
+                c.type = SIM_MIRROR;
+                c.states = new std::vector<PieceState>();
+                if (!coop.poll(*c.states)) {
+                    LOG_ERROR("Lost the co-op server, playing on alone");
+                }
+                if (c.states->empty()) {
+                    delete c.states;
+                } else {
+                    simulation.send(c);
+                }
+            }
+            simulation.update();
+            const RenderSnapshot& snap = simulation.snapshot();
+            if (snap.hintSerial != hintSerial) {
+                hintSerial = snap.hintSerial;
+                showHint(snap);
+            }
+            // late latching: the held group is drawn at the latest cursor even if no tick has applied it yet
+            glm::vec2 heldShift(0.0f);
+            const RenderPointer& mouse = snap.pointers[MOUSE_POINTER];
+            if (late_latch && pointer_down && mouse.holding) {
+                float extent = board.tableExtent();
+                heldShift = glm::clamp(drag_cursor - mouse.grab, glm::vec2(-extent), glm::vec2(extent)) - mouse.heldPosition;
+            }
+
+            // the table stays empty until the picture has been uploaded
+            bool pictureReady = gl_tasks.empty();
+
             // draw our first triangle
             glUseProgram(shaderProgram);
+            glUniformMatrix4fv(viewProjectionLoc, 1, GL_FALSE, glm::value_ptr(camera.viewProjection()));
             glBindVertexArray(
                     VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
-            glBindTexture(GL_TEXTURE_2D, tex);
+            if (useVirtualTexture) {
+                // stream the tiles the visible pieces need at the size the picture is shown at (the board spans
+                // 1/halfExtent of the window)
+                float texelsPerPixel = std::max((float)IMG_WIDTH / SCR_WIDTH, (float)IMG_HEIGHT / SCR_HEIGHT) * camera.halfExtent();
+                virtualTexture.beginFrame();
+                for (const auto &piece : snap.pieces) {
+                    glm::vec2 size = topology.boundsMax[piece.id] - topology.boundsMin[piece.id];
+                    virtualTexture.request(piece.tx, piece.ty, piece.tx + size.x / 2, piece.ty + size.y / 2, texelsPerPixel);
+                }
+                virtualTexture.update();
+                virtualTexture.bind(shaderProgram);
+            } else {
+                glBindTexture(GL_TEXTURE_2D, tex);
+            }
 
-            for (const auto &piece : pieces) { //forward iterate (lowest Z pieces first)
+            bool hintShown = sc::high_resolution_clock::now() < hint_until;
+            for (const auto &piece : snap.pieces) { //forward iterate (lowest Z pieces first)
+                if (!pictureReady) {
+                    break;
+                }
                 // draw triangle 1 (arrow key controlled)
-                glUniform2f(glGetUniformLocation(shaderProgram, "texOffset"), piece->tx, piece->ty);
-                glUniform3f(glGetUniformLocation(shaderProgram, "offset"), piece->x, piece->y, 0.0f);
-                glDrawArrays(GL_TRIANGLES, 0, 6);
+                bool hinted = hintShown && (piece.id == hint_pieces[0] || piece.id == hint_pieces[1]);
+                glm::vec2 shift = piece.pointer == (int)MOUSE_POINTER ? heldShift : glm::vec2(0.0f);
+                glUniform1f(highlightLoc, hinted ? HINT_HIGHLIGHT : 0.0f);
+                glUniform2f(texOffsetLoc, piece.tx, piece.ty);
+                glUniform2f(rotationLoc, std::cos(piece.angle), std::sin(piece.angle));
+                glUniform3f(offsetLoc, piece.x + shift.x, piece.y + shift.y, 0.0f);
+                glDrawArrays(GL_TRIANGLE_FAN, topology.outlineStart[piece.id],
+                             topology.outlineStart[piece.id + 1] - topology.outlineStart[piece.id]);
             }
 
 
 
             // glBindVertexArray(0); // no need to unbind it every time
 
+            // GL work too big for one frame gets what is left of the budget once the frame is submitted
+            if (gl_tasks.run(GL_TASK_BUDGET_MS / 1000.0)) {
+                const FrameTaskStats& taskStats = gl_tasks.stats();
+                LOG_INFO("GL TASKS DONE: {} STEPS OVER {} FRAMES, {}ms TOTAL, {}ms WORST FRAME", taskStats.steps,
+                         taskStats.frames, taskStats.seconds * 1000, taskStats.worstFrame * 1000);
+            }
+
             // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
             // -------------------------------------------------------------------------------
             glfwSwapBuffers(window);
+            pacer.frameDone();
+            FrameTimeStats frameStats;
+            if (pacer.report(FRAME_REPORT_SECONDS, frameStats)) {
+                LOG_INFO("FRAMES ({}): {} FPS, {}ms MEAN, {}ms STDDEV, {}ms P99, {}ms WORST", pacingModeName(pacer.mode()),
+                         1.0 / frameStats.mean, frameStats.mean * 1000, frameStats.stddev * 1000, frameStats.p99 * 1000,
+                         frameStats.worst * 1000);
+            }
+            if (playable) {
+                reportDragLatency(mouse.holding && pointer_down, late_latch ? drag_cursor_ns : mouse.dragSampledNs);
+            }
             glfwPollEvents();
 
-            if (!loadedImageForBeginning && stage < 4 && !GAME_OVER_FLAG) {
+            if (!loadedImageForBeginning && pictureReady && playable) {
                 struct timespec deadline;
                 deadline.tv_sec = 5;
                 clock_nanosleep(CLOCK_REALTIME, 0, &deadline, NULL);
-                if (!DEBUG_MODE){
+                if (coop.connected()) {
+                    // the room is scrambled by the server as its first player asked for, and streamed from then on
+                    uint64_t seed = SCRAMBLE_SEED != 0 ? SCRAMBLE_SEED : freshScrambleSeed();
+                    uint32_t room = (COOP_ROOM << 8) | stage;
+                    coop.join(room, PIECE_ROWS, PIECE_COLS, level.cut, seed, SCRAMBLE_MODE, ROTATION_MODE, topology);
+                    countDownStart = sc::high_resolution_clock::now();
+                    countDownCurrent = countDownStart;
+                    LOG_INFO("JOINED CO-OP ROOM {} ON {}", room, COOP_SERVER);
+                } else if (resuming) {
+                    // checked against the level before it was chosen; resume stays put until the simulation stops
+                    SimCommand c = SimCommand();
+                    c.type = SIM_RESTORE;
+                    c.snapshot = &resume;
+                    simulation.send(c);
+                    countDownCurrent = sc::high_resolution_clock::now();
+                    countDownStart = countDownCurrent - sc::seconds(resume.elapsedSeconds);
+                    scrambled = true;
+                } else if (!DEBUG_MODE){
                     scramble();
                     countDownStart = sc::high_resolution_clock::now();
                     countDownCurrent = countDownStart;
+                    scrambled = true;
                 }
+                resuming = false;
+                playFrom = simulation.sent();
+                pacer.reset(); // the countdown pause is not a frame time
+                lastAutosave = sc::high_resolution_clock::now();
+            }
+            loadedImageForBeginning = loadedImageForBeginning || pictureReady;
+
+            // the simulation copies the board between ticks; the writer thread does the disk work
+            if (scrambled && snap.holding == 0
+                && sc::duration<float>(sc::high_resolution_clock::now() - lastAutosave).count() >= AUTOSAVE_SECONDS) {
+                saveProgress();
             }
-            loadedImageForBeginning = true;
 
             if (GAME_OVER_FLAG){
                 //GAME_OVER WAS TRIGGERED
                 glfwSetWindowTitle(window, "FAILURE");
-                std::cout << "HIGHEST STAGE REACHED: " << stage - 1 << std::endl;
-                stage = 10; //so it can exit the while loop
+                LOG_INFO("HIGHEST STAGE REACHED: {}", stage - 1);
+                stage = NUM_STAGES; //so it can exit the while loop
                 terminated = true;
                 GAME_OVER_FLAG = false;
                 struct timespec deadline;
@@ -681,22 +1079,17 @@ int main(int argc, char** argv)
                 break;
             }
 
-            bool gameCompleted = true;
-            for (auto p : pieces) {
-                //std::cout << p->group.size() << std::endl;
-                if (p->group.size() < NUM_PIECES - 1) {
-                    gameCompleted = false;
-                    break;
-                }
-            }
+            bool gameCompleted = snap.complete && snap.applied >= playFrom;
 
             if (gameCompleted) {
                 terminated = false;
+                solved = true;
                 auto end = sc::high_resolution_clock::now(); // end the clock
-                std::cout << "LEVEL " << stage << " COMPLETE!" << std::endl;
-                std::cout << "Game Time: " << sc::duration_cast<sc::minutes>(end - start).count() << "min "
-                          << sc::duration_cast<sc::seconds>(end - start).count() % 60 << "sec" << std::endl;
-                if (stage == 4)
+                replay.claimedSeconds = (uint32_t)sc::duration_cast<sc::seconds>(end - countDownStart).count();
+                LOG_INFO("LEVEL {} COMPLETE!", stage);
+                LOG_INFO("Game Time: {}min {}sec", sc::duration_cast<sc::minutes>(end - start).count(),
+                         sc::duration_cast<sc::seconds>(end - start).count() % 60);
+                if (stage == NUM_STAGES)
                 {
                     struct timespec deadline;
                     deadline.tv_sec = 10;
@@ -720,18 +1113,48 @@ int main(int argc, char** argv)
 
         // optional: de-allocate all resources once they've outlived their purpose:
         // ------------------------------------------------------------------------
+        // a finished or lost level has nothing left to resume; one that was quit is saved as it stands
+        if (scrambled && !GAME_OVER_FLAG) {
+            saveProgress();
+        }
+        simulation.stop();
+        coop.close();
+        if (solved && scrambled && REPLAY_PREFIX != nullptr && !replay.unreplayable) {
+            std::string replayFile = REPLAY_PREFIX + std::to_string(stage) + ".rpl";
+            if (writeReplay(replayFile.c_str(), replay)) {
+                // the logger keeps string pointers, not copies, so not replayFile's
+                LOG_INFO("REPLAY OF STAGE {} SAVED TO {}{}.rpl", stage, REPLAY_PREFIX, stage);
+            }
+        }
+        std::vector<JobStats> jobTimes;
+        jobStats(jobTimes);
+        for (auto &j : jobTimes) {
+            LOG_DEBUG("JOB {}: {} RUNS, {}ms TOTAL, {}ms WORST", j.name, j.count, j.seconds * 1000, j.worst * 1000);
+        }
+        resetJobStats();
+        if (scrambled && (GAME_OVER_FLAG || board.isComplete())) {
+            saveWriter.discard();
+        } else if (scrambled) {
+            saveWriter.flush();
+        }
+
         glDeleteVertexArrays(1, &VAO);
         glDeleteBuffers(1, &VBO);
-
-
-        for (auto p : pieces) {
-            delete p;
+        virtualTexture.destroy();
+        PICTURE_SOURCE = nullptr;
+        gl_tasks.clear();
+        if (mipChain) {
+            waitJob(mipChain); // it reads image
         }
+        stbi_image_free(image);
+
+        board.clear();
 
         // glfw: terminate, clearing all previously allocated GLFW resources.
         // ------------------------------------------------------------------
         glfwTerminate();
     }
+    flushLog();
     return 0;
 }
 
@@ -742,27 +1165,18 @@ void processInput(GLFWwindow *window)
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    //process mouse dragging
-    if(mouseDown){
+    //arrow keys and right dragging pan the camera
+    float step = KEY_PAN_SPEED * camera.halfExtent();
+    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) camera.pan(-step, 0.0f);
+    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) camera.pan(step, 0.0f);
+    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) camera.pan(0.0f, step);
+    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) camera.pan(0.0f, -step);
+
+    //without late latching, panning and dragging follow the cursor as sampled once at the start of the frame
+    if(!late_latch){
         double xpos, ypos;
         glfwGetCursorPos(window, &xpos, &ypos);
-        //transform screen coordinates into GL coordinates
-        float offset_x = 2.0f * ((float)xpos / SCR_WIDTH - 0.5f) - drag_location_x;
-        float offset_y = -2.0f * ((float)ypos / SCR_HEIGHT - 0.5f) - drag_location_y;
-
-        if(offset_x > 1.0f) offset_x = 1.0f;
-        else if(offset_x < -1.0f) offset_x = -1.0f;
-        if(offset_y > 1.0f) offset_y = 1.0f;
-        else if(offset_y < -1.0f) offset_y = -1.0f;
-
-        //PuzzlePiece temp = active_piece;
-        active_piece->x = offset_x;
-        active_piece->y = offset_y;
-        for(auto p : active_piece->group){
-            p.first->x = offset_x + p.second.x;
-            p.first->y = offset_y + p.second.y;
-        }
-
+        followCursor(window, xpos, ypos);
     }
 }
 
@@ -774,22 +1188,3 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
 }
-
-PuzzlePiece* retrievePuzzlePieceByID(int& id){
-    for (auto p : pieces){
-        if (p->id == id){
-            return p;
-        }
-    }
-    return nullptr;
-}
-
-void addToPuzzleGroup(PuzzlePiece* src, PuzzlePiece* dst){
-    glm::vec2 v(src->x - dst->x,src->y - dst->y);
-    dst->group.insert(std::pair<PuzzlePiece*,glm::vec2>(src,v));
-    v.x = dst->x - src->x;
-    v.y = dst->y - src->y;
-    src->group.insert(std::pair<PuzzlePiece*,glm::vec2>(dst,v));
-}
-
-
@@ -0,0 +1,81 @@
+/*
+PACK_LEVELS: offline packer for PuzzleGL level bundles
+
+USAGE: pack_levels <levels.txt> <levels.pzl>
+
+Decodes every picture listed in the manifest once, expands it to RGBA8, builds its mip chain and writes the
+result as a bundle the game can memory-map (see level_bundle.h). Pictures too large for one texture are streamed
+through the ingest instead and stored as tiles for the virtual texture.
+ */
+#include <iostream>
+#include <vector>
+
+#include "image_ingest.h"
+#include "level_bundle.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        std::cout << "USAGE: " << argv[0] << " <levels.txt> <levels.pzl>" << std::endl;
+        return -1;
+    }
+
+    std::vector<LevelDesc> levels;
+    if (!readLevelManifest(argv[1], levels)) {
+        std::cout << "[ERROR] could not read level manifest " << argv[1] << std::endl;
+        return -1;
+    }
+
+    // the bundle's layout depends on every picture's size, so read the headers first
+    std::vector<unsigned int> widths(levels.size()), heights(levels.size());
+    std::vector<bool> tiled(levels.size());
+    for (size_t i = 0; i < levels.size(); ++i) {
+        if (!readImageSize(levels[i].image.c_str(), widths[i], heights[i])) {
+            std::cout << "[ERROR] could not read " << levels[i].image << ": " << stbi_failure_reason() << std::endl;
+            return -1;
+        }
+        tiled[i] = widths[i] > VIRTUAL_TEXTURE_MIN_SIZE || heights[i] > VIRTUAL_TEXTURE_MIN_SIZE;
+    }
+
+    BundleWriter writer;
+    if (!writer.open(argv[2], levels, widths, heights, tiled)) {
+        return -1;
+    }
+    for (size_t i = 0; i < levels.size(); ++i) {
+        std::cout << "LEVEL " << i + 1 << ": " << levels[i].image << " " << widths[i] << "x" << heights[i] << ", "
+                  << levels[i].rows << "x" << levels[i].cols << " pieces, " << writer.level(i).numMips
+                  << (tiled[i] ? " tiled mips (" : " mips (") << levelKindName(levels[i].kind) << ")" << std::endl;
+        if (tiled[i]) {
+            BundleTileSink sink(writer, i);
+            IngestStats stats;
+            if (!ingestImage(levels[i].image.c_str(), writer.level(i).numMips, sink, &stats)) {
+                return -1;
+            }
+            std::cout << "    " << stats.tiles << " tiles in " << stats.seconds << "s, "
+                      << stats.peakBufferBytes / (1024 * 1024) << "MB of buffers"
+                      << (stats.progressive ? " (progressive)" : "") << std::endl;
+            continue;
+        }
+
+        int width, height, nrChannels;
+        unsigned char *image = stbi_load(levels[i].image.c_str(), &width, &height, &nrChannels, STBI_rgb_alpha);
+        if (image == nullptr) {
+            std::cout << "[ERROR] could not decode " << levels[i].image << ": " << stbi_failure_reason() << std::endl;
+            return -1;
+        }
+        std::vector<std::vector<unsigned char> > mips;
+        buildMipChain(image, (unsigned int)width, (unsigned int)height, mips);
+        stbi_image_free(image);
+        for (unsigned int m = 0; m < mips.size(); ++m) {
+            writer.writeMip(i, m, &mips[m][0]);
+        }
+    }
+
+    if (!writer.close()) {
+        return -1;
+    }
+    return 0;
+}
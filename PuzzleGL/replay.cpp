@@ -0,0 +1,238 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "glide.h"
+#include "job_system.h"
+#include "simulation.h"
+
+namespace {
+
+const unsigned int REPLAYS_PER_JOB = 4; // played back one after the other on one Board
+
+const char* VERDICT_NAMES[REPLAY_VERDICT_COUNT] = {
+    "verified", "malformed", "wrong level", "not scrambled", "incomplete", "overtime", "faster than claimed"
+};
+
+// tick order, and every value within what the board takes (set up for the replay). A NaN gets past the board's
+// clamps and snaps a held group onto everything, so no coordinate may be one.
+bool wellFormed(const Replay& replay, const Board& board) {
+    const unsigned int numPieces = board.count();
+    const float extent = board.tableExtent();
+    size_t bins = 0;
+    for (size_t i = 0; i < replay.events.size(); ++i) {
+        const ReplayEvent& e = replay.events[i];
+        if ((i > 0 && e.tick < replay.events[i - 1].tick) || e.type >= REPLAY_EVENT_TYPE_COUNT
+            || e.pointer >= MAX_POINTERS) {
+            return false;
+        }
+        if (!std::isfinite(e.x) || !std::isfinite(e.y) || !std::isfinite(e.x2) || !std::isfinite(e.y2)) {
+            return false;
+        }
+        // a sweep is centred on the table and no wider than it, and pushes pieces away rather than towards it
+        if (e.type == REPLAY_SWEEP && (std::abs(e.x) > extent || std::abs(e.y) > extent || e.x2 < 0
+                                       || e.x2 > 2 * extent || e.y2 < 0)) {
+            return false;
+        }
+        if (e.type == REPLAY_SCRAMBLE && (e.mode >= SCRAMBLE_MODE_COUNT || e.rotation >= ROTATION_MODE_COUNT)) {
+            return false;
+        }
+        if (e.type == REPLAY_SORT) {
+            if (bins + numPieces > replay.bins.size()) {
+                return false;
+            }
+            for (size_t k = bins; k < bins + numPieces; ++k) {
+                if (replay.bins[k] >= e.mode) {
+                    return false;
+                }
+            }
+            bins += numPieces;
+        }
+    }
+    return bins == replay.bins.size();
+}
+
+// as Simulation::apply does with the command it was recorded from
+void apply(Board& board, PointerTrack* tracks, const ReplayEvent& e, const Replay& replay, size_t& bins) {
+    PointerTrack& track = tracks[e.pointer];
+    switch (e.type) {
+        case REPLAY_PRESS:
+            board.press(e.x, e.y, e.pointer);
+            track.dragSampledNs = e.sampledNs;
+            track.numDragSamples = 0;
+            break;
+        case REPLAY_DRAG:
+            board.drag(e.x, e.y, e.pointer);
+            track.dragSampledNs = e.sampledNs;
+            track.dragSamples[track.numDragSamples++ % FLICK_SAMPLES] = { glm::vec2(e.x, e.y), e.sampledNs };
+            break;
+        case REPLAY_ROTATE:
+            board.rotate(e.x, e.pointer);
+            break;
+        case REPLAY_RELEASE:
+            board.release(flickVelocity(track, e.sampledNs), e.pointer);
+            break;
+        case REPLAY_SWEEP:
+            board.sweep(e.x, e.y, e.x2, e.y2);
+            break;
+        case REPLAY_SCRAMBLE:
+            board.scramble((ScrambleMode)e.mode, e.seed, (RotationMode)e.rotation);
+            break;
+        case REPLAY_PUSH_APART:
+            board.setPushApart(e.mode != 0);
+            break;
+        case REPLAY_SORT: {
+            std::vector<unsigned char> bin(replay.bins.begin() + bins, replay.bins.begin() + bins + board.count());
+            board.sortIntoTrays(bin, e.mode);
+            bins += board.count();
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+} // namespace
+
+bool writeReplay(const char* filename, const Replay& replay) {
+    ReplayHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = REPLAY_MAGIC;
+    hdr.version = REPLAY_VERSION;
+    hdr.level = replay.level;
+    hdr.rows = replay.rows;
+    hdr.cols = replay.cols;
+    hdr.topology = replay.topology;
+    hdr.pushApart = replay.pushApart ? 1 : 0;
+    hdr.claimedSeconds = replay.claimedSeconds;
+    hdr.numEvents = (uint32_t)replay.events.size();
+    hdr.numBins = (uint32_t)replay.bins.size();
+
+    FILE* out = fopen(filename, "wb");
+    if (out == nullptr) {
+        std::cout << "[ERROR] could not open " << filename << " for writing" << std::endl;
+        return false;
+    }
+    size_t n = replay.events.size(), b = replay.bins.size();
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+    ok = ok && (n == 0 || fwrite(&replay.events[0], sizeof(ReplayEvent), n, out) == n);
+    ok = ok && (b == 0 || fwrite(&replay.bins[0], 1, b, out) == b);
+    ok = fclose(out) == 0 && ok;
+    if (!ok) {
+        std::cout << "[ERROR] could not write " << filename << std::endl;
+        remove(filename);
+    }
+    return ok;
+}
+
+bool readReplay(const char* filename, Replay& replay) {
+    FILE* in = fopen(filename, "rb");
+    if (in == nullptr) {
+        std::cout << "[ERROR] could not open " << filename << std::endl;
+        return false;
+    }
+    ReplayHeader hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, in) == 1 && hdr.magic == REPLAY_MAGIC && hdr.version == REPLAY_VERSION
+              && hdr.numEvents <= REPLAY_MAX_EVENTS && hdr.numBins <= REPLAY_MAX_BINS;
+    if (ok) {
+        replay.level = hdr.level;
+        replay.rows = hdr.rows;
+        replay.cols = hdr.cols;
+        replay.topology = hdr.topology;
+        replay.pushApart = hdr.pushApart != 0;
+        replay.claimedSeconds = hdr.claimedSeconds;
+        replay.unreplayable = false;
+        replay.events.resize(hdr.numEvents);
+        replay.bins.resize(hdr.numBins);
+        size_t n = hdr.numEvents, b = hdr.numBins;
+        ok = (n == 0 || fread(&replay.events[0], sizeof(ReplayEvent), n, in) == n)
+             && (b == 0 || fread(&replay.bins[0], 1, b, in) == b);
+    }
+    fclose(in);
+    if (!ok) {
+        std::cout << "[ERROR] " << filename << " is not a valid replay" << std::endl;
+    }
+    return ok;
+}
+
+const char* replayVerdictName(ReplayVerdict verdict) {
+    return verdict < REPLAY_VERDICT_COUNT ? VERDICT_NAMES[verdict] : "?";
+}
+
+ReplayResult verifyReplay(const Replay& replay, const std::vector<LevelDesc>& levels, Board& board) {
+    ReplayResult result = ReplayResult();
+    if (replay.level >= levels.size() || levels[replay.level].kind != LEVEL_PLAY
+        || levels[replay.level].rows != replay.rows || levels[replay.level].cols != replay.cols
+        || (uint32_t)levels[replay.level].cut != replay.topology) {
+        result.verdict = REPLAY_WRONG_LEVEL;
+        return result;
+    }
+    board.setup(replay.rows, replay.cols, (TopologyKind)replay.topology);
+    board.setPushApart(replay.pushApart);
+    if (!wellFormed(replay, board)) {
+        result.verdict = REPLAY_MALFORMED;
+        return result;
+    }
+
+    PointerTrack tracks[MAX_POINTERS];
+    for (auto& track : tracks) {
+        track.dragSampledNs = 0;
+        track.numDragSamples = 0;
+    }
+    const uint64_t allowed = (uint64_t)levels[replay.level].countdown * SIM_TICK_HZ;
+    const float dt = 1.0f / SIM_TICK_HZ;
+    const std::vector<ReplayEvent>& events = replay.events;
+    size_t next = 0, bins = 0;
+    uint64_t tick = 0, scrambledAt = 0;
+    bool scrambled = false;
+    for (;;) {
+        if (board.atRest()) {
+            if (next == events.size()) {
+                break; // nothing is left that could change the board
+            }
+            tick = std::max<uint64_t>(tick, events[next].tick);
+        }
+        for (; next < events.size() && events[next].tick == tick; ++next) {
+            if (events[next].type == REPLAY_SCRAMBLE && !scrambled) {
+                scrambled = true;
+                scrambledAt = tick;
+            }
+            apply(board, tracks, events[next], replay, bins);
+        }
+        board.advance(dt);
+        board.settle();
+        result.simulated++;
+        tick++;
+        // the board is solved before the scramble; the game only looks once it has been scrambled
+        if (scrambled && board.isComplete()) {
+            // ticks runs from the start of the scrambling tick to the end of the completing one, a tick more than the
+            // game's clock (started once the scramble was sent, maybe just after it was applied) can have seen
+            result.ticks = tick - scrambledAt;
+            result.verdict = result.ticks >= allowed ? REPLAY_OVERTIME
+                             : (result.ticks - 1) / SIM_TICK_HZ > replay.claimedSeconds ? REPLAY_TOO_FAST
+                             : REPLAY_VERIFIED;
+            return result;
+        }
+        if (scrambled && tick - scrambledAt >= allowed) {
+            result.verdict = REPLAY_OVERTIME; // the countdown ran out
+            return result;
+        }
+    }
+    result.verdict = scrambled ? REPLAY_INCOMPLETE : REPLAY_NOT_SCRAMBLED;
+    return result;
+}
+
+void verifyReplays(const std::vector<Replay>& replays, const std::vector<LevelDesc>& levels,
+                   std::vector<ReplayResult>& results) {
+    results.resize(replays.size());
+    parallelFor("verify replays", replays.size(), REPLAYS_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        Board board;
+        for (unsigned int i = begin; i < end; ++i) {
+            results[i] = verifyReplay(replays[i], levels, board);
+        }
+    });
+}
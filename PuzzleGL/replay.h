@@ -0,0 +1,114 @@
+/*
+REPLAY
+
+A recorded level: which level of the manifest it was, how its board was set up, and every command the simulation
+applied that moves pieces (pointer input, scrambles, sweeps, sorting into trays, push apart toggles), each with the
+simulation tick it was applied at. Played back on a fresh board, a tick at a time the way the simulation runs
+(that tick's commands in order, then one glide step and one push apart step), the same build arrives at the very
+same board, so a leaderboard can take a result from the replay instead of from the player.
+
+A level counts from the tick of its first scramble to the tick after which the board is complete, at SIM_TICK_HZ.
+The simulation never runs ahead of the clock (it falls behind instead), so the countdown the game showed is never
+shorter than that: a replay is only verified if its ticks fit both the countdown it claims and the level's. Levels
+played with a command that cannot be replayed (a restored save, the blind assist's arrangement, a co-op room's
+stream) are marked and never saved.
+
+Playback skips the ticks in which the board is at rest and no command comes, which is most of them, so a verifier
+gets through a level in a small fraction of the time it took to play.
+
+FILE LAYOUT (little endian):
+    ReplayHeader
+    ReplayEvent events[numEvents]
+    uint8_t bins[numBins]              (every REPLAY_SORT's bins, per piece, one sort after the other)
+ */
+#ifndef PUZZLEGL_REPLAY_H
+#define PUZZLEGL_REPLAY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "board.h"
+#include "level_bundle.h"
+
+const uint32_t REPLAY_MAGIC = 0x50525A50; // "PZRP"
+const uint32_t REPLAY_VERSION = 1;
+const uint32_t REPLAY_MAX_EVENTS = 1 << 24; // files with more are refused rather than read
+const uint32_t REPLAY_MAX_BINS = 1 << 26;
+
+enum ReplayEventType {
+    REPLAY_PRESS,      // pointer, x, y, sampledNs
+    REPLAY_DRAG,       // pointer, x, y, sampledNs
+    REPLAY_ROTATE,     // pointer, x: radians counter-clockwise
+    REPLAY_RELEASE,    // pointer, sampledNs
+    REPLAY_SWEEP,      // x, y, x2: radius, y2: speed
+    REPLAY_SCRAMBLE,   // mode, rotation, seed
+    REPLAY_PUSH_APART, // mode: 1 on, 0 off
+    REPLAY_SORT,       // mode: number of bins, the piece's bins next in the file's bins
+    REPLAY_EVENT_TYPE_COUNT
+};
+
+struct ReplayHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t level;          // index into the level manifest
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t topology;       // TopologyKind
+    uint32_t pushApart;      // at the start: 1 on, 0 off
+    uint32_t claimedSeconds; // the countdown when the game saw the board complete
+    uint32_t numEvents;
+    uint32_t numBins;
+};
+
+struct ReplayEvent {
+    int64_t sampledNs;  // the player's steady clock (only differences are used)
+    uint64_t seed;
+    uint32_t tick;      // simulation ticks since the simulation started on the level
+    uint32_t type;      // ReplayEventType
+    uint32_t pointer;
+    uint32_t mode;
+    uint32_t rotation;
+    float x, y, x2, y2;
+    uint32_t reserved;
+};
+
+struct Replay {
+    uint32_t level;
+    uint32_t rows, cols;
+    uint32_t topology;
+    bool pushApart;
+    uint32_t claimedSeconds;
+    std::vector<ReplayEvent> events; // in the order they were applied
+    std::vector<unsigned char> bins;
+    bool unreplayable;               // not saved: see above
+};
+
+bool writeReplay(const char* filename, const Replay& replay);
+bool readReplay(const char* filename, Replay& replay);
+
+enum ReplayVerdict {
+    REPLAY_VERIFIED,
+    REPLAY_MALFORMED,     // commands out of tick order, out of range or not finite
+    REPLAY_WRONG_LEVEL,   // not a play level of the manifest, or not its board
+    REPLAY_NOT_SCRAMBLED, // the level was never scrambled
+    REPLAY_INCOMPLETE,    // the commands run out before the board is complete
+    REPLAY_OVERTIME,      // not complete within the level's countdown
+    REPLAY_TOO_FAST,      // complete later than the countdown it claims
+    REPLAY_VERDICT_COUNT
+};
+
+const char* replayVerdictName(ReplayVerdict verdict);
+
+struct ReplayResult {
+    ReplayVerdict verdict;
+    uint64_t ticks;     // from the first scramble to complete, if it was
+    uint64_t simulated; // ticks actually stepped, the rest were skipped at rest
+};
+
+// plays the replay back on board (set up afresh) and checks it against the levels of the manifest
+ReplayResult verifyReplay(const Replay& replay, const std::vector<LevelDesc>& levels, Board& board);
+// the same for many replays at once, on the job system
+void verifyReplays(const std::vector<Replay>& replays, const std::vector<LevelDesc>& levels,
+                   std::vector<ReplayResult>& results);
+
+#endif //PUZZLEGL_REPLAY_H
@@ -0,0 +1,190 @@
+/*
+REPLAY BENCHMARK
+
+Records the solver bot solving many independently scrambled boards, as the game records a player (see REPLAY), then
+verifies every recording on every core (or on [threads] of them) as a leaderboard would and reports replays and
+simulated ticks per second. Each recording is also delayed to finish on the last tick of a whole second and claimed
+at the second before, as a clock that started a tick late reads it, which must verify. Three tampered copies of each recording, one
+claiming to be faster than it was, one with its last moves cut off and one with a drag to NaN (which would snap the
+held group onto every neighbour), are verified as well and must all be rejected.
+
+usage: replay_bench [replays] [rows] [cols] [threads] [none|quarter|free] [seed]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "job_system.h"
+#include "replay.h"
+#include "simulation.h"
+#include "solver.h"
+
+namespace sc = std::chrono;
+
+namespace {
+
+const unsigned int REPLAYS_PER_JOB = 4;
+const unsigned int DRAG_STEPS = 8;
+
+// how many of the replays got each verdict
+void printVerdicts(const char* name, const std::vector<ReplayResult>& results, double seconds) {
+    unsigned int counts[REPLAY_VERDICT_COUNT] = {};
+    for (auto& r : results) {
+        counts[r.verdict]++;
+    }
+    std::cout << name << ": " << results.size() << " in " << seconds << "s (" << results.size() / seconds
+              << " replays/s):";
+    for (int v = 0; v < REPLAY_VERDICT_COUNT; ++v) {
+        if (counts[v] != 0) {
+            std::cout << " " << counts[v] << " " << replayVerdictName((ReplayVerdict)v);
+        }
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned int numReplays = argc > 1 ? std::atoi(argv[1]) : 200;
+    unsigned int rows = argc > 2 ? std::atoi(argv[2]) : 10;
+    unsigned int cols = argc > 3 ? std::atoi(argv[3]) : rows;
+    unsigned int threads = argc > 4 ? std::atoi(argv[4]) : 0;
+    RotationMode rotation = ROTATION_NONE;
+    if (argc > 5) {
+        for (int r = 0; r < ROTATION_MODE_COUNT; ++r) {
+            if (std::strcmp(argv[5], rotationModeName((RotationMode)r)) == 0) {
+                rotation = (RotationMode)r;
+            }
+        }
+    }
+    uint64_t seed = argc > 6 ? std::strtoull(argv[6], nullptr, 10) : 1;
+    if (numReplays == 0 || rows == 0 || cols == 0) {
+        std::cout << "usage: replay_bench [replays] [rows] [cols] [threads] [none|quarter|free] [seed]" << std::endl;
+        return -1;
+    }
+    if (threads != 0) {
+        startJobSystem(threads - 1); // the main thread works while it waits
+    }
+
+    // the bot plays level 0 of a manifest of one, pieces dropped where they are and never pushed apart
+    std::vector<Replay> replays(numReplays);
+    std::vector<char> solved(numReplays);
+    auto start = sc::steady_clock::now();
+    parallelFor("record replays", numReplays, REPLAYS_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        Board board;
+        SolveStats stats = SolveStats();
+        for (unsigned int i = begin; i < end; ++i) {
+            Replay& replay = replays[i];
+            replay.rows = rows;
+            replay.cols = cols;
+            replay.topology = TOPOLOGY_GRID;
+            board.setup(rows, cols);
+            board.scramble(SCRAMBLE_SPREAD, seed + i, rotation);
+            ReplayEvent scramble = ReplayEvent();
+            scramble.type = REPLAY_SCRAMBLE;
+            scramble.mode = SCRAMBLE_SPREAD;
+            scramble.rotation = rotation;
+            scramble.seed = seed + i;
+            replay.events.push_back(scramble);
+            solved[i] = solveBoard(board, DRAG_STEPS, stats, &replay);
+            // the countdown rounded up, as the game would have shown it
+            replay.claimedSeconds = replay.events.back().tick / SIM_TICK_HZ + 1;
+        }
+    });
+    double recordSeconds = sc::duration<double>(sc::steady_clock::now() - start).count();
+
+    LevelDesc level = LevelDesc();
+    level.rows = rows;
+    level.cols = cols;
+    level.kind = LEVEL_PLAY;
+    level.cut = TOPOLOGY_GRID;
+    uint64_t played = 0;
+    for (auto& replay : replays) {
+        level.countdown = std::max<int>(level.countdown, replay.claimedSeconds + 1);
+        played += replay.events.back().tick;
+    }
+    std::vector<LevelDesc> levels(1, level);
+    unsigned int stuck = (unsigned int)std::count(solved.begin(), solved.end(), 0);
+    std::cout << numReplays << " replays of " << rows << "x" << cols << " (" << rotationModeName(rotation)
+              << " rotation) recorded in " << recordSeconds << "s, " << stuck << " stuck; "
+              << (double)played / numReplays << " ticks (" << (double)played / numReplays / SIM_TICK_HZ
+              << "s) played each" << std::endl;
+
+    std::vector<ReplayResult> results;
+    start = sc::steady_clock::now();
+    verifyReplays(replays, levels, results);
+    double seconds = sc::duration<double>(sc::steady_clock::now() - start).count();
+    printVerdicts("honest", results, seconds);
+    uint64_t simulated = 0;
+    unsigned int wrong = 0;
+    for (unsigned int i = 0; i < numReplays; ++i) {
+        simulated += results[i].simulated;
+        wrong += (results[i].verdict == REPLAY_VERIFIED) != (solved[i] != 0);
+    }
+    std::cout << "ticks stepped: " << simulated << " of " << played << " played (" << simulated / seconds
+              << "/s), " << (double)played / SIM_TICK_HZ / seconds << "x real time on " << jobConcurrency()
+              << " threads" << std::endl;
+
+    // every move after the scramble comes later, which the board (at rest until the first press) cannot tell
+    std::vector<Replay> tampered(replays);
+    for (unsigned int i = 0; i < numReplays; ++i) {
+        uint32_t delay = (SIM_TICK_HZ - results[i].ticks % SIM_TICK_HZ) % SIM_TICK_HZ;
+        for (size_t k = 1; k < tampered[i].events.size(); ++k) {
+            tampered[i].events[k].tick += delay;
+            tampered[i].events[k].sampledNs += (int64_t)delay * 1000000000 / SIM_TICK_HZ;
+        }
+        tampered[i].claimedSeconds = (uint32_t)((results[i].ticks + delay - 1) / SIM_TICK_HZ);
+    }
+    start = sc::steady_clock::now();
+    verifyReplays(tampered, levels, results);
+    printVerdicts("claimed on a second", results, sc::duration<double>(sc::steady_clock::now() - start).count());
+    for (unsigned int i = 0; i < numReplays; ++i) {
+        wrong += (results[i].verdict == REPLAY_VERIFIED) != (solved[i] != 0);
+    }
+
+    tampered = replays;
+    for (auto& replay : tampered) {
+        replay.claimedSeconds = 0;
+    }
+    start = sc::steady_clock::now();
+    verifyReplays(tampered, levels, results);
+    printVerdicts("claiming 0s", results, sc::duration<double>(sc::steady_clock::now() - start).count());
+    for (auto& r : results) {
+        wrong += r.verdict == REPLAY_VERIFIED;
+    }
+
+    tampered = replays;
+    for (auto& replay : tampered) {
+        replay.events.resize(replay.events.size() * 3 / 4);
+    }
+    start = sc::steady_clock::now();
+    verifyReplays(tampered, levels, results);
+    printVerdicts("last moves cut", results, sc::duration<double>(sc::steady_clock::now() - start).count());
+    for (auto& r : results) {
+        wrong += r.verdict == REPLAY_VERIFIED;
+    }
+
+    tampered = replays;
+    for (auto& replay : tampered) {
+        for (auto& e : replay.events) {
+            if (e.type == REPLAY_DRAG) {
+                e.x = e.y = NAN;
+                break;
+            }
+        }
+    }
+    start = sc::steady_clock::now();
+    verifyReplays(tampered, levels, results);
+    printVerdicts("drag to NaN", results, sc::duration<double>(sc::steady_clock::now() - start).count());
+    for (auto& r : results) {
+        wrong += r.verdict == REPLAY_VERIFIED;
+    }
+
+    std::cout << "wrong verdicts: " << wrong << std::endl;
+    return wrong == 0 ? 0 : -1;
+}
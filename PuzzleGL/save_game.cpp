@@ -0,0 +1,155 @@
+#include "save_game.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+bool writeSnapshot(const char* filename, const BoardSnapshot& snapshot) {
+    size_t n = snapshot.x.size();
+    if (snapshot.y.size() != n || snapshot.z.size() != n || snapshot.angle.size() != n
+        || snapshot.component.size() != n) {
+        std::cout << "[ERROR] inconsistent board snapshot" << std::endl;
+        return false;
+    }
+    SaveHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SAVE_MAGIC;
+    hdr.version = SAVE_VERSION;
+    hdr.stage = snapshot.stage;
+    hdr.elapsedSeconds = snapshot.elapsedSeconds;
+    hdr.rows = snapshot.rows;
+    hdr.cols = snapshot.cols;
+    hdr.numPieces = (uint32_t)n;
+    hdr.topology = snapshot.topology;
+
+    // written next to the save and renamed over it, so the save on disk is always a whole one
+    std::string temp = std::string(filename) + ".tmp";
+    FILE* out = fopen(temp.c_str(), "wb");
+    if (out == nullptr) {
+        std::cout << "[ERROR] could not open " << temp << " for writing" << std::endl;
+        return false;
+    }
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+    if (n > 0) {
+        ok = ok && fwrite(&snapshot.x[0], sizeof(float), n, out) == n;
+        ok = ok && fwrite(&snapshot.y[0], sizeof(float), n, out) == n;
+        ok = ok && fwrite(&snapshot.z[0], sizeof(float), n, out) == n;
+        ok = ok && fwrite(&snapshot.angle[0], sizeof(float), n, out) == n;
+        ok = ok && fwrite(&snapshot.component[0], sizeof(uint32_t), n, out) == n;
+    }
+    ok = fclose(out) == 0 && ok;
+#ifdef _WIN32
+    remove(filename); // rename does not replace an existing file on Windows
+#endif
+    if (!ok || rename(temp.c_str(), filename) != 0) {
+        std::cout << "[ERROR] could not write " << filename << std::endl;
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readSnapshot(const char* filename, BoardSnapshot& snapshot) {
+    FILE* in = fopen(filename, "rb");
+    if (in == nullptr) {
+        return false;
+    }
+    SaveHeader hdr;
+    // only a grid cut has exactly rows * cols pieces; the board checks the count against its own cut on restore
+    bool ok = fread(&hdr, sizeof(hdr), 1, in) == 1 && hdr.magic == SAVE_MAGIC && hdr.version >= 1
+              && hdr.version <= SAVE_VERSION
+              && (hdr.topology != 0 || hdr.numPieces == hdr.rows * hdr.cols);
+    if (ok) {
+        size_t n = hdr.numPieces;
+        snapshot.stage = hdr.stage;
+        snapshot.elapsedSeconds = hdr.elapsedSeconds;
+        snapshot.rows = hdr.rows;
+        snapshot.cols = hdr.cols;
+        snapshot.topology = hdr.topology;
+        snapshot.x.resize(n);
+        snapshot.y.resize(n);
+        snapshot.z.resize(n);
+        snapshot.angle.assign(n, 0.0f);
+        snapshot.component.resize(n);
+        if (n > 0) {
+            ok = fread(&snapshot.x[0], sizeof(float), n, in) == n && fread(&snapshot.y[0], sizeof(float), n, in) == n
+                 && fread(&snapshot.z[0], sizeof(float), n, in) == n
+                 && (hdr.version < 2 || fread(&snapshot.angle[0], sizeof(float), n, in) == n)
+                 && fread(&snapshot.component[0], sizeof(uint32_t), n, in) == n;
+        }
+        for (size_t i = 0; ok && i < n; ++i) {
+            ok = snapshot.component[i] < n;
+        }
+    }
+    fclose(in);
+    if (!ok) {
+        std::cout << "[ERROR] " << filename << " is not a valid save" << std::endl;
+    }
+    return ok;
+}
+
+SaveWriter::SaveWriter(const char* filename)
+    : filename(filename), hasPending(false), writing(false), stopping(false) {
+    worker = std::thread(&SaveWriter::run, this);
+}
+
+SaveWriter::~SaveWriter() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void SaveWriter::submit(const BoardSnapshot& snapshot) {
+    // copied outside the lock into buffers that have been through here before, so they rarely reallocate
+    staging.stage = snapshot.stage;
+    staging.elapsedSeconds = snapshot.elapsedSeconds;
+    staging.rows = snapshot.rows;
+    staging.cols = snapshot.cols;
+    staging.topology = snapshot.topology;
+    staging.x.assign(snapshot.x.begin(), snapshot.x.end());
+    staging.y.assign(snapshot.y.begin(), snapshot.y.end());
+    staging.z.assign(snapshot.z.begin(), snapshot.z.end());
+    staging.angle.assign(snapshot.angle.begin(), snapshot.angle.end());
+    staging.component.assign(snapshot.component.begin(), snapshot.component.end());
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        // a snapshot still waiting is stale now; its buffers come back as the next staging
+        std::swap(pending, staging);
+        hasPending = true;
+    }
+    wake.notify_one();
+}
+
+void SaveWriter::flush() {
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [this]() { return !hasPending && !writing; });
+}
+
+void SaveWriter::discard() {
+    std::unique_lock<std::mutex> guard(lock);
+    hasPending = false;
+    idle.wait(guard, [this]() { return !writing; });
+    remove(filename.c_str());
+}
+
+void SaveWriter::run() {
+    BoardSnapshot current;
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+        wake.wait(guard, [this]() { return hasPending || stopping; });
+        if (!hasPending) {
+            return;
+        }
+        std::swap(current, pending);
+        hasPending = false;
+        writing = true;
+        guard.unlock();
+        writeSnapshot(filename.c_str(), current);
+        guard.lock();
+        writing = false;
+        idle.notify_all();
+    }
+}
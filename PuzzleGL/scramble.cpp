@@ -0,0 +1,236 @@
+#include "scramble.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include "job_system.h"
+
+namespace {
+
+// pieces per chunk: each chunk draws from its own stream, so the layout does not depend on the thread count
+const unsigned int SCRAMBLE_CHUNK = 8192;
+
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+inline uint32_t rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+uint64_t chunkSeed(uint64_t seed, unsigned int chunk) {
+    uint64_t state = seed ^ (0xD1B54A32D192ED03ull * (chunk + 1));
+    return splitmix64(state);
+}
+
+// run fn(begin, end, chunk) over [0,count) in SCRAMBLE_CHUNK sized chunks on the job system
+template<class Fn>
+void forEachChunk(unsigned int count, Fn fn) {
+    parallelFor("scramble", count, SCRAMBLE_CHUNK, [&](unsigned int begin, unsigned int end) {
+        fn(begin, end, begin / SCRAMBLE_CHUNK);
+    });
+}
+
+struct Region {
+    float minX, minY, maxX, maxY;
+};
+
+// pieces at uniformly random centers that keep them inside the region
+void uniformOver(const std::vector<unsigned int>& ids, const Region& r, const ScrambleParams& params, uint64_t seed,
+                 std::vector<glm::vec2>& centers) {
+    float halfW = std::min(params.pieceWidth / 2, (r.maxX - r.minX) / 2);
+    float halfH = std::min(params.pieceHeight / 2, (r.maxY - r.minY) / 2);
+    float rangeX = r.maxX - r.minX - 2 * halfW;
+    float rangeY = r.maxY - r.minY - 2 * halfH;
+    forEachChunk(ids.size(), [&](unsigned int begin, unsigned int end, unsigned int chunk) {
+        Rng rng(chunkSeed(seed, chunk));
+        for (unsigned int k = begin; k < end; ++k) {
+            float x = r.minX + halfW + rng.uniform() * rangeX;
+            float y = r.minY + halfH + rng.uniform() * rangeY;
+            centers[ids[k]] = glm::vec2(x, y);
+        }
+    });
+}
+
+// one piece per cell of a grid whose cells have the piece's aspect ratio, in shuffled cell order, jittered within
+// the cell by whatever room the cell leaves around the piece
+void spreadOver(const std::vector<unsigned int>& ids, const Region& r, const ScrambleParams& params, uint64_t seed,
+                std::vector<glm::vec2>& centers) {
+    unsigned int n = ids.size();
+    if (n == 0) {
+        return;
+    }
+    float w = r.maxX - r.minX, h = r.maxY - r.minY;
+    float pw = params.pieceWidth, ph = params.pieceHeight;
+    unsigned int cols = (unsigned int)std::lround(std::sqrt((double)n * w * ph / (h * pw)));
+    cols = std::min(std::max(cols, 1u), n);
+    unsigned int rows = (n + cols - 1) / cols;
+    float cellW = w / cols, cellH = h / rows;
+    float slackX = std::max(0.0f, cellW - pw), slackY = std::max(0.0f, cellH - ph);
+
+    // fewer than a row of cells stay empty; shuffle which ones
+    std::vector<unsigned int> cells(cols * rows);
+    for (unsigned int c = 0; c < cells.size(); ++c) {
+        cells[c] = c;
+    }
+    Rng shuffleRng(seed);
+    for (unsigned int c = cells.size() - 1; c > 0; --c) {
+        std::swap(cells[c], cells[shuffleRng.below(c + 1)]);
+    }
+
+    uint64_t jitterSeed = chunkSeed(seed, 0xFFFFFFFFu);
+    forEachChunk(n, [&](unsigned int begin, unsigned int end, unsigned int chunk) {
+        Rng rng(chunkSeed(jitterSeed, chunk));
+        for (unsigned int k = begin; k < end; ++k) {
+            unsigned int cell = cells[k];
+            float x = r.minX + (cell % cols) * cellW + (cellW - slackX) / 2 + rng.uniform() * slackX;
+            float y = r.maxY - (cell / cols) * cellH - (cellH - slackY) / 2 - rng.uniform() * slackY;
+            centers[ids[k]] = glm::vec2(x, y);
+        }
+    });
+}
+
+} // namespace
+
+Rng::Rng(uint64_t seed) {
+    uint64_t state = seed;
+    uint64_t a = splitmix64(state), b = splitmix64(state);
+    s[0] = (uint32_t)a;
+    s[1] = (uint32_t)(a >> 32);
+    s[2] = (uint32_t)b;
+    s[3] = (uint32_t)(b >> 32);
+}
+
+uint32_t Rng::next() {
+    uint32_t result = rotl(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+    return result;
+}
+
+float Rng::uniform() {
+    return (next() >> 8) * (1.0f / 16777216.0f);
+}
+
+uint32_t Rng::below(uint32_t n) {
+    return (uint32_t)(((uint64_t)next() * n) >> 32);
+}
+
+const char* scrambleModeName(ScrambleMode mode) {
+    switch (mode) {
+        case SCRAMBLE_UNIFORM: return "uniform";
+        case SCRAMBLE_SPREAD: return "spread";
+        case SCRAMBLE_TRAYS: return "trays";
+        default: return "unknown";
+    }
+}
+
+const char* rotationModeName(RotationMode mode) {
+    switch (mode) {
+        case ROTATION_NONE: return "none";
+        case ROTATION_QUARTER: return "quarter";
+        case ROTATION_FREE: return "free";
+        default: return "unknown";
+    }
+}
+
+uint64_t freshScrambleSeed() {
+    static std::atomic<uint64_t> counter(0);
+    uint64_t state = (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count() + counter++;
+    return splitmix64(state);
+}
+
+void scrambleLayout(ScrambleMode mode, uint64_t seed, const ScrambleParams& params, std::vector<glm::vec2>& centers) {
+    centers.resize(params.count);
+    float e = params.tableExtent;
+    Region table = { -e, -e, e, e };
+
+    if (mode == SCRAMBLE_TRAYS) {
+        std::vector<unsigned int> border, inner;
+        for (unsigned int id = 0; id < params.count; ++id) {
+            (id < params.edge.size() && params.edge[id] ? border : inner).push_back(id);
+        }
+        // deal the shuffled border pieces into rows of slots from the top of the table down
+        float slotW = params.pieceWidth * TRAY_GAP, slotH = params.pieceHeight * TRAY_GAP;
+        unsigned int perRow = std::max(1u, (unsigned int)(2 * e / slotW));
+        unsigned int trayRows = (border.size() + perRow - 1) / perRow;
+        float trayHeight = trayRows * slotH;
+        if (trayHeight > e) {
+            // no room for neat rows: split the table between border and inner pieces by count instead
+            trayHeight = 2 * e * border.size() / params.count;
+            Region trays = { -e, e - trayHeight, e, e };
+            spreadOver(border, trays, params, seed, centers);
+        } else {
+            Rng rng(seed);
+            for (unsigned int k = border.size(); k > 1; --k) {
+                std::swap(border[k - 1], border[rng.below(k)]);
+            }
+            float left = -e + (2 * e - perRow * slotW) / 2 + slotW / 2;
+            for (unsigned int k = 0; k < border.size(); ++k) {
+                centers[border[k]] = glm::vec2(left + (k % perRow) * slotW, e - slotH / 2 - (k / perRow) * slotH);
+            }
+        }
+        Region rest = { -e, -e, e, e - trayHeight };
+        spreadOver(inner, rest, params, chunkSeed(seed, 0xFFFFFFFEu), centers);
+        return;
+    }
+
+    std::vector<unsigned int> all(params.count);
+    for (unsigned int id = 0; id < params.count; ++id) {
+        all[id] = id;
+    }
+    if (mode == SCRAMBLE_UNIFORM) {
+        uniformOver(all, table, params, seed, centers);
+    } else {
+        spreadOver(all, table, params, seed, centers);
+    }
+}
+
+void scrambleAngles(RotationMode mode, uint64_t seed, unsigned int count, std::vector<float>& angles) {
+    angles.assign(count, 0.0f);
+    if (mode == ROTATION_NONE) {
+        return;
+    }
+    const float turn = 6.28318530718f;
+    uint64_t angleSeed = chunkSeed(seed, 0xFFFFFFFDu);
+    forEachChunk(count, [&](unsigned int begin, unsigned int end, unsigned int chunk) {
+        Rng rng(chunkSeed(angleSeed, chunk));
+        for (unsigned int id = begin; id < end; ++id) {
+            angles[id] = mode == ROTATION_QUARTER ? rng.below(4) * (turn / 4) : rng.uniform() * turn;
+        }
+    });
+}
+
+void trayLayout(const std::vector<unsigned int>& ids, const std::vector<unsigned int>& tray,
+                const ScrambleParams& params, std::vector<glm::vec2>& centers) {
+    float e = params.tableExtent;
+    float slotW = params.pieceWidth * TRAY_GAP, slotH = params.pieceHeight * TRAY_GAP;
+    unsigned int perRow = std::max(1u, (unsigned int)(2 * e / slotW));
+    unsigned int rows = 0;
+    for (size_t k = 0, inRow = 0; k < ids.size(); ++k, ++inRow) {
+        if (k == 0 || inRow == perRow || tray[ids[k]] != tray[ids[k - 1]]) {
+            rows++;
+            inRow = 0;
+        }
+    }
+    slotH = std::min(slotH, 2 * e / std::max(rows, 1u));
+    float left = -e + (2 * e - perRow * slotW) / 2 + slotW / 2;
+    int row = -1;
+    for (size_t k = 0, inRow = 0; k < ids.size(); ++k, ++inRow) {
+        if (k == 0 || inRow == perRow || tray[ids[k]] != tray[ids[k - 1]]) {
+            row++;
+            inRow = 0;
+        }
+        centers[ids[k]] = glm::vec2(left + inRow * slotW, e - slotH / 2 - row * slotH);
+    }
+}
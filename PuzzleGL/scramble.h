@@ -0,0 +1,79 @@
+/*
+SCRAMBLE
+
+Layouts for scrambling the board over the table. Every strategy is driven by one 64-bit seed, so a layout can be
+reproduced exactly, and the per-piece work is cut into fixed-size chunks that each get their own generator
+stream: the chunks run in parallel and still give the same layout for the same seed on any number of cores.
+
+    SCRAMBLE_UNIFORM  every piece anywhere on the table (pieces pile up on big boards)
+    SCRAMBLE_SPREAD   jittered grid: one piece per cell of a shuffled grid, jittered inside its cell. The cells
+                      are sized from the table and piece count, so pieces never overlap while the table has room
+                      for them and overlap as little as possible when it does not
+    SCRAMBLE_TRAYS    edge pieces first: the border pieces are dealt into tray rows along the top of the table,
+                      the rest are spread over what is left below them
+
+Sorting loose pieces uses the same tray rows, one tray after the other (trayLayout).
+
+Orientations are scrambled separately, from their own streams of the same seed:
+
+    ROTATION_NONE     every piece upright
+    ROTATION_QUARTER  each piece turned by a random multiple of 90 degrees
+    ROTATION_FREE     each piece turned by a random angle
+ */
+#ifndef PUZZLEGL_SCRAMBLE_H
+#define PUZZLEGL_SCRAMBLE_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+enum ScrambleMode {
+    SCRAMBLE_UNIFORM = 0,
+    SCRAMBLE_SPREAD = 1,
+    SCRAMBLE_TRAYS = 2,
+    SCRAMBLE_MODE_COUNT
+};
+
+// xoshiro128** seeded through splitmix64: a few cycles per number and independent streams per seed
+class Rng {
+public:
+    explicit Rng(uint64_t seed);
+    uint32_t next();
+    float uniform(); // [0,1)
+    uint32_t below(uint32_t n); // [0,n)
+
+private:
+    uint32_t s[4];
+};
+
+const float TRAY_GAP = 1.1f; // tray slots are this much larger than a piece
+
+struct ScrambleParams {
+    unsigned int count;   // pieces, indexed by id
+    float pieceWidth;
+    float pieceHeight;
+    float tableExtent;    // the table is [-tableExtent,tableExtent] on both axes
+    std::vector<bool> edge; // per id: on the border of the board (used by SCRAMBLE_TRAYS)
+};
+
+enum RotationMode {
+    ROTATION_NONE = 0,
+    ROTATION_QUARTER = 1,
+    ROTATION_FREE = 2,
+    ROTATION_MODE_COUNT
+};
+
+const char* scrambleModeName(ScrambleMode mode);
+const char* rotationModeName(RotationMode mode);
+// a seed that differs on every call, for when no seed was chosen
+uint64_t freshScrambleSeed();
+// writes the center of every piece, by id
+void scrambleLayout(ScrambleMode mode, uint64_t seed, const ScrambleParams& params, std::vector<glm::vec2>& centers);
+// writes the orientation of every piece (radians counter-clockwise, in [0, 2pi)), by id
+void scrambleAngles(RotationMode mode, uint64_t seed, unsigned int count, std::vector<float>& angles);
+// deals the pieces in ids, which come ordered by tray, into trays: each tray starts a new row of slots, from the top
+// of the table down, and the rows squeeze together when they do not all fit; writes the centers of those pieces only
+void trayLayout(const std::vector<unsigned int>& ids, const std::vector<unsigned int>& tray,
+                const ScrambleParams& params, std::vector<glm::vec2>& centers);
+
+#endif //PUZZLEGL_SCRAMBLE_H
@@ -0,0 +1,56 @@
+/*
+SERVE_COOP: headless host for co-op rooms (see coop_server.h)
+
+USAGE: serve_coop <socket path | port> [threads]
+
+Serves until interrupted, then prints how busy it was. A port listens on the loopback interface only.
+ */
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+
+#include "coop_server.h"
+#include "job_system.h"
+
+namespace {
+
+CoopServer* serving = nullptr;
+
+void interrupted(int) {
+    if (serving != nullptr) {
+        serving->stop();
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cout << "USAGE: " << argv[0] << " <socket path | port> [threads]" << std::endl;
+        return -1;
+    }
+    unsigned int threads = argc > 2 ? std::atoi(argv[2]) : 0;
+    if (threads != 0) {
+        startJobSystem(threads - 1); // the socket thread works while it waits
+    }
+
+    CoopServer server;
+    if (!server.listen(argv[1])) {
+        return -1;
+    }
+    serving = &server;
+    std::signal(SIGINT, interrupted);
+    std::signal(SIGTERM, interrupted);
+    std::cout << "Serving co-op rooms on " << argv[1] << " at " << COOP_TICK_HZ << " ticks/s on "
+              << jobConcurrency() << " threads" << std::endl;
+    server.run();
+
+    CoopServerStats stats;
+    server.stats(stats);
+    std::cout << stats.ticks << " ticks, " << stats.rooms << " rooms and " << stats.players << " players left, "
+              << stats.bytesSent << " bytes sent" << std::endl;
+    std::cout << "tick: " << stats.meanTick * 1000 << "ms mean, " << stats.p99Tick * 1000 << "ms p99, "
+              << stats.worstTick * 1000 << "ms worst" << std::endl;
+    return 0;
+}
@@ -0,0 +1,280 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "log.h"
+
+namespace sc = std::chrono;
+
+int64_t steadyNanoseconds() {
+    return sc::duration_cast<sc::nanoseconds>(sc::steady_clock::now().time_since_epoch()).count();
+}
+
+Simulation::Simulation()
+    : board(nullptr), writer(nullptr), recording(nullptr), commands(SIM_COMMAND_RING), stopping(false), sentCount(0),
+      tick(0), applied(0), hintSerial(0), hintFound(false) {
+    for (auto& track : tracks) {
+        track.dragSampledNs = 0;
+        track.numDragSamples = 0;
+    }
+    view[0] = view[1] = -1.0f;
+    view[2] = view[3] = 1.0f;
+    hintPieces[0] = hintPieces[1] = -1;
+}
+
+Simulation::~Simulation() {
+    stop();
+}
+
+void Simulation::start(Board& b, SaveWriter* w, Replay* r) {
+    stop();
+    board = &b;
+    writer = w;
+    recording = r;
+    stopping = false;
+    tick = 0;
+    hintSerial = 0;
+    hintFound = false;
+    hintPieces[0] = hintPieces[1] = -1;
+    // the first snapshot is there before the first tick; the thread takes over the writer side from here
+    publish();
+    thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+    stopping = true;
+    thread.join();
+}
+
+void Simulation::send(const SimCommand& command) {
+    if (commands.push(command)) {
+        sentCount++;
+        return;
+    }
+    if (command.type == SIM_DRAG) {
+        return; // a dropped drag is superseded by the next one
+    }
+    while (!commands.push(command)) {
+        std::this_thread::yield();
+    }
+    sentCount++;
+}
+
+void Simulation::run() {
+    attachLogThread(); // so a group dump logs into a ring rather than to the terminal, mid-tick
+    const sc::nanoseconds period(1000000000 / SIM_TICK_HZ);
+    auto next = sc::steady_clock::now();
+    for (;;) {
+        bool stop = stopping.load(); // read before draining so everything sent before stop() is applied
+        bool changed = false;
+        SimCommand command;
+        while (commands.pop(command)) {
+            apply(command);
+            applied++;
+            changed = true;
+        }
+        changed = board->advance(1.0f / SIM_TICK_HZ) || changed;
+        changed = board->settle() || changed;
+        tick++;
+        if (changed) {
+            publish();
+        }
+        if (stop) {
+            return;
+        }
+        next += period;
+        auto now = sc::steady_clock::now();
+        if (next + 4 * period < now) {
+            next = now; // fell far behind (a huge merge): carry on from now rather than rushing through ticks
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void Simulation::apply(const SimCommand& c) {
+    if (recording != nullptr) {
+        record(c);
+    }
+    PointerTrack& track = tracks[c.pointer % MAX_POINTERS]; // the board ignores pointers out of range
+    switch (c.type) {
+        case SIM_PRESS:
+            board->press(c.x, c.y, c.pointer);
+            track.dragSampledNs = c.sampledNs;
+            track.numDragSamples = 0;
+            break;
+        case SIM_DRAG:
+            board->drag(c.x, c.y, c.pointer);
+            track.dragSampledNs = c.sampledNs;
+            track.dragSamples[track.numDragSamples++ % FLICK_SAMPLES] = { glm::vec2(c.x, c.y), c.sampledNs };
+            break;
+        case SIM_ROTATE:
+            board->rotate(c.x, c.pointer);
+            break;
+        case SIM_RELEASE:
+            board->release(flickVelocity(track, c.sampledNs), c.pointer);
+            break;
+        case SIM_SWEEP:
+            board->sweep(c.x, c.y, c.x2, c.y2);
+            break;
+        case SIM_VIEW:
+            view[0] = c.x;
+            view[1] = c.y;
+            view[2] = c.x2;
+            view[3] = c.y2;
+            break;
+        case SIM_SCRAMBLE:
+            board->scramble((ScrambleMode)c.mode, c.seed, (RotationMode)c.rotation);
+            break;
+        case SIM_PUSH_APART:
+            board->setPushApart(c.mode != 0);
+            break;
+        case SIM_ARRANGE:
+            board->arrange(*c.centers);
+            delete c.centers;
+            break;
+        case SIM_SORT:
+            board->sortIntoTrays(*c.bins, c.mode);
+            delete c.bins;
+            break;
+        case SIM_MIRROR:
+            board->mirror(*c.states);
+            delete c.states;
+            break;
+        case SIM_RESTORE:
+            if (!board->restore(*c.snapshot)) {
+                LOG_ERROR("Saved board does not fit this level");
+            }
+            break;
+        case SIM_HINT: {
+            PuzzlePiece *a, *b;
+            hintFound = board->hint(a, b);
+            if (hintFound) {
+                hintPieces[0] = a->id;
+                hintPieces[1] = b->id;
+            }
+            hintSerial++;
+            break;
+        }
+        case SIM_DUMP_GROUPS:
+            board->dumpGroups();
+            break;
+        case SIM_SAVE:
+            if (writer != nullptr) {
+                board->capture(saved);
+                saved.stage = c.stage;
+                saved.elapsedSeconds = c.elapsedSeconds;
+                writer->submit(saved);
+            }
+            break;
+    }
+}
+
+void Simulation::record(const SimCommand& c) {
+    ReplayEvent e = ReplayEvent();
+    e.tick = (uint32_t)tick;
+    e.pointer = c.pointer;
+    e.x = c.x;
+    e.y = c.y;
+    e.x2 = c.x2;
+    e.y2 = c.y2;
+    e.sampledNs = c.sampledNs;
+    switch (c.type) {
+        case SIM_PRESS:
+            e.type = REPLAY_PRESS;
+            break;
+        case SIM_DRAG:
+            e.type = REPLAY_DRAG;
+            break;
+        case SIM_ROTATE:
+            e.type = REPLAY_ROTATE;
+            break;
+        case SIM_RELEASE:
+            e.type = REPLAY_RELEASE;
+            break;
+        case SIM_SWEEP:
+            e.type = REPLAY_SWEEP;
+            break;
+        case SIM_SCRAMBLE:
+            e.type = REPLAY_SCRAMBLE;
+            e.mode = c.mode;
+            e.rotation = c.rotation;
+            e.seed = c.seed;
+            break;
+        case SIM_PUSH_APART:
+            e.type = REPLAY_PUSH_APART;
+            e.mode = c.mode;
+            break;
+        case SIM_SORT:
+            e.type = REPLAY_SORT;
+            e.mode = c.mode;
+            recording->bins.insert(recording->bins.end(), c.bins->begin(), c.bins->end());
+            break;
+        case SIM_ARRANGE:
+        case SIM_MIRROR:
+        case SIM_RESTORE:
+            recording->unreplayable = true; // pieces put where a replay cannot follow
+            return;
+        default:
+            return; // nothing moves
+    }
+    recording->events.push_back(e);
+}
+
+void Simulation::publish() {
+    RenderSnapshot& s = snapshots.back();
+    board->piecesIn(view[0], view[1], view[2], view[3], visible);
+    s.pieces.clear();
+    for (auto p : visible) {
+        if (board->holder(p) < 0) {
+            RenderPiece r = { p->x, p->y, p->angle, p->tx, p->ty, p->id, -1 };
+            s.pieces.push_back(r);
+        }
+    }
+    s.holding = 0;
+    heldPieces.clear();
+    for (unsigned int i = 0; i < MAX_POINTERS; ++i) {
+        RenderPointer& pointer = s.pointers[i];
+        PuzzlePiece* held = board->heldPiece(i);
+        pointer.holding = held != nullptr;
+        pointer.dragSampledNs = tracks[i].dragSampledNs;
+        if (held != nullptr) {
+            pointer.heldPosition = glm::vec2(held->x, held->y);
+            pointer.grab = board->grabOffset(i);
+            heldPieces.push_back(held);
+            s.holding++;
+        }
+    }
+    // the held groups are on top, the latest grabbed highest, and drawn even where they have been dragged out of
+    // view; their members are only put in place on release, so they are drawn where the held piece's pose puts them
+    std::sort(heldPieces.begin(), heldPieces.end(), [](const PuzzlePiece* a, const PuzzlePiece* b) {
+        return a->z < b->z;
+    });
+    for (auto held : heldPieces) {
+        int pointer = board->holder(held);
+        RenderPiece r = { held->x, held->y, held->angle, held->tx, held->ty, held->id, pointer };
+        s.pieces.push_back(r);
+        float c = std::cos(held->angle), sn = std::sin(held->angle);
+        glm::mat2 turn(c, sn, -sn, c);
+        for (auto g : held->group) {
+            glm::vec2 at = glm::vec2(held->x, held->y) + turn * g.second;
+            RenderPiece m = { at.x, at.y, held->angle, g.first->tx, g.first->ty, g.first->id, pointer };
+            s.pieces.push_back(m);
+        }
+    }
+    s.tick = tick;
+    s.applied = applied;
+    s.complete = board->isComplete();
+    s.hintSerial = hintSerial;
+    s.hintFound = hintFound;
+    for (int i = 0; i < 2; ++i) {
+        s.hintPieces[i] = hintPieces[i];
+        PuzzlePiece* p = board->piece(hintPieces[i]);
+        s.hintPositions[i] = p != nullptr ? glm::vec2(p->x, p->y) : glm::vec2(0.0f);
+    }
+    snapshots.publish();
+}
@@ -0,0 +1,154 @@
+/*
+SIMULATION
+
+Runs the board on its own thread at a fixed tick rate, so a slow frame never delays snapping and a heavy merge
+never delays a frame. The frame thread owns the window and the camera and talks to the board only through two
+lock-free channels:
+
+- commands (pointer press/drag/release in world space, scramble, hint, save, ...) go through an SPSC ring and are
+  applied at the start of the next tick, in order, after which thrown pieces glide and the board settles by one
+  step (see BOARD);
+- after every tick that changed something the simulation publishes an immutable RenderSnapshot through a triple
+  buffer: the pieces overlapping the last view the frame reported (plus the held groups), lowest z first, with
+  completion, hint and drag state.
+
+Pointer commands name their pointer (the mouse is pointer 0, see BOARD for several at once); each pointer's recent
+drag samples, for measuring throws, are kept in its own small ring. Every command that moves pieces can be recorded
+with the tick it was applied at, for a REPLAY of the level.
+
+While the simulation runs, the frame thread may still read what never changes after Board::setup (size, piece
+size, table extent, each piece's tx/ty) but nothing else. Stopping the simulation applies every command still
+queued and joins the thread, after which the board is the caller's again.
+ */
+#ifndef PUZZLEGL_SIMULATION_H
+#define PUZZLEGL_SIMULATION_H
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "board.h"
+#include "replay.h"
+#include "save_game.h"
+#include "spsc_ring.h"
+#include "triple_buffer.h"
+
+const unsigned int SIM_TICK_HZ = 240;
+const unsigned int SIM_COMMAND_RING = 4096;
+
+enum SimCommandType {
+    SIM_PRESS,       // pointer, x, y, sampledNs
+    SIM_DRAG,        // pointer, x, y, sampledNs
+    SIM_ROTATE,      // pointer, x: radians counter-clockwise
+    SIM_RELEASE,     // pointer, sampledNs: when the pointer was let go
+    SIM_SWEEP,       // x, y: the point to sweep pieces away from, x2: radius, y2: speed
+    SIM_VIEW,        // x, y, x2, y2: the rectangle the frame shows
+    SIM_SCRAMBLE,    // mode, rotation, seed
+    SIM_PUSH_APART,  // mode: 1 on, 0 off
+    SIM_ARRANGE,     // centers, deleted by the simulation
+    SIM_SORT,        // bins (per piece, below mode), deleted by the simulation
+    SIM_MIRROR,      // states streamed by a co-op server, deleted by the simulation
+    SIM_RESTORE,     // snapshot, kept alive by the caller until the simulation stops
+    SIM_HINT,
+    SIM_DUMP_GROUPS,
+    SIM_SAVE         // stage, elapsedSeconds
+};
+
+struct SimCommand {
+    SimCommandType type;
+    unsigned int pointer;
+    float x, y, x2, y2;
+    int64_t sampledNs; // steady clock time the pointer position was read
+    int mode;
+    int rotation;
+    uint64_t seed;
+    uint32_t stage, elapsedSeconds;
+    std::vector<glm::vec2>* centers;
+    std::vector<unsigned char>* bins;
+    std::vector<PieceState>* states;
+    const BoardSnapshot* snapshot;
+};
+
+struct RenderPiece {
+    float x, y;
+    float angle;
+    float tx, ty;
+    int id;
+    int pointer; // holding its group, -1 if none
+};
+
+struct RenderPointer {
+    bool holding;
+    glm::vec2 heldPosition; // of the held piece
+    glm::vec2 grab;         // pointer position relative to the held piece
+    int64_t dragSampledNs;  // when the pointer position behind the held group's place was read
+};
+
+struct RenderSnapshot {
+    std::vector<RenderPiece> pieces; // in view or held, lowest z first
+    uint64_t tick;
+    uint64_t applied;       // commands applied so far, to compare with Simulation::sent()
+    bool complete;
+    unsigned int holding;   // pointers holding a group
+    RenderPointer pointers[MAX_POINTERS];
+    unsigned int hintSerial; // bumped by every answered hint request
+    bool hintFound;
+    int hintPieces[2];
+    glm::vec2 hintPositions[2];
+};
+
+int64_t steadyNanoseconds();
+
+class Simulation {
+public:
+    Simulation();
+    ~Simulation();
+
+    // starts ticking the board; saves go to writer if there is one, and the commands that move pieces are appended
+    // to recording if there is one (which is the caller's again once the simulation stops)
+    void start(Board& board, SaveWriter* writer, Replay* recording = nullptr);
+    // applies what is still queued and joins the thread
+    void stop();
+    bool running() const { return thread.joinable(); }
+
+    // frame thread: queue a command (drags are dropped when the ring is full, anything else waits for room)
+    void send(const SimCommand& command);
+    // frame thread: commands queued so far; a snapshot with applied >= sent() reflects all of them
+    uint64_t sent() const { return sentCount; }
+    // frame thread: the latest published state; true if it changed since the last call
+    bool update() { return snapshots.update(); }
+    const RenderSnapshot& snapshot() const { return snapshots.front(); }
+
+private:
+    Simulation(const Simulation&);
+    Simulation& operator=(const Simulation&);
+
+    void run();
+    void apply(const SimCommand& command);
+    void record(const SimCommand& command);
+    void publish();
+
+    Board* board;
+    SaveWriter* writer;
+    Replay* recording;
+    SpscRing<SimCommand> commands;
+    TripleBuffer<RenderSnapshot> snapshots;
+    std::thread thread;
+    std::atomic<bool> stopping;
+    uint64_t sentCount; // frame thread only
+
+    // simulation thread only
+    uint64_t tick;
+    uint64_t applied;
+    float view[4];
+    PointerTrack tracks[MAX_POINTERS];
+    unsigned int hintSerial;
+    bool hintFound;
+    int hintPieces[2];
+    BoardSnapshot saved; // kept current incrementally by Board::capture
+    std::vector<PuzzlePiece*> visible;
+    std::vector<PuzzlePiece*> heldPieces;
+};
+
+#endif //PUZZLEGL_SIMULATION_H
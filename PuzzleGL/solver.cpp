@@ -0,0 +1,245 @@
+#include "solver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include "job_system.h"
+#include "simulation.h"
+
+namespace sc = std::chrono;
+
+namespace {
+
+const unsigned int BOARDS_PER_JOB = 4; // boards solved one after the other on one Board
+const int64_t TICK_NS = 1000000000 / SIM_TICK_HZ;
+// a recorded release waits this many ticks after the last drag, so the pointer has stopped and nothing is thrown
+const uint32_t HOLD_TICKS = (uint32_t)(FLICK_WINDOW_NS / TICK_NS) + 1;
+
+bool inGroup(const PuzzlePiece* member, const PuzzlePiece* p) {
+    return p == member || member->group.count(const_cast<PuzzlePiece*>(p)) != 0;
+}
+
+bool upright(const PuzzlePiece* p) {
+    return std::abs(angleBetween(p->angle, 0.0f)) < 1e-4f;
+}
+
+// a point where a press grabs p itself, i.e. not hidden under a higher group: the centroid, then halfway out to
+// each corner of the outline
+bool visiblePoint(const Board& board, const PuzzlePiece* p, glm::vec2& point) {
+    const PieceTopology& topo = board.topology();
+    unsigned int first = topo.outlineStart[p->id], last = topo.outlineStart[p->id + 1];
+    for (unsigned int v = first; v <= last; ++v) {
+        glm::vec2 corner = v == first ? glm::vec2(0.0f) : rotated(topo.outline[v - 1], p->angle);
+        glm::vec2 candidate = glm::vec2(p->x, p->y) + corner * 0.5f;
+        const PuzzlePiece* hit = board.pick(candidate.x, candidate.y);
+        if (hit == p) {
+            point = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// appends one operation of the mouse pointer, after the last one by ticks
+void record(Replay* replay, ReplayEventType type, float x, float y, uint32_t ticks = 1) {
+    if (replay == nullptr) {
+        return;
+    }
+    ReplayEvent e = ReplayEvent();
+    e.tick = replay->events.empty() ? 0 : replay->events.back().tick + ticks;
+    e.type = type;
+    e.x = x;
+    e.y = y;
+    e.sampledNs = e.tick * TICK_NS;
+    replay->events.push_back(e);
+}
+
+// press at from, drag the pointer to to in steps, release
+void dragTo(Board& board, glm::vec2 from, glm::vec2 to, unsigned int dragSteps, SolveStats& stats, Replay* replay) {
+    board.press(from.x, from.y);
+    record(replay, REPLAY_PRESS, from.x, from.y);
+    for (unsigned int s = 1; s <= dragSteps; ++s) {
+        glm::vec2 at = from + (to - from) * ((float)s / dragSteps);
+        board.drag(at.x, at.y);
+        record(replay, REPLAY_DRAG, at.x, at.y);
+    }
+    board.release();
+    record(replay, REPLAY_RELEASE, 0.0f, 0.0f, HOLD_TICKS);
+    stats.operations += dragSteps + 2;
+    stats.moves++;
+}
+
+// press on a visible member of the group, turn the group upright about that point, release
+bool turnUpright(Board& board, const std::vector<PuzzlePiece*>& members, SolveStats& stats, Replay* replay) {
+    glm::vec2 grip;
+    for (auto h : members) {
+        if (visiblePoint(board, h, grip)) {
+            float turn = angleBetween(h->angle, 0.0f);
+            board.press(grip.x, grip.y);
+            board.rotate(turn);
+            board.release();
+            record(replay, REPLAY_PRESS, grip.x, grip.y);
+            record(replay, REPLAY_ROTATE, turn, 0.0f);
+            record(replay, REPLAY_RELEASE, 0.0f, 0.0f);
+            stats.operations += 3;
+            stats.moves++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// a visible member of the group that stays on the table when the group is moved by delta
+bool findGrip(const Board& board, const std::vector<PuzzlePiece*>& members, glm::vec2 delta, glm::vec2& point) {
+    float extent = board.tableExtent();
+    for (auto h : members) {
+        // the held piece is clamped to the table, so it has to end up on it
+        if (std::abs(h->x + delta.x) <= extent && std::abs(h->y + delta.y) <= extent && visiblePoint(board, h, point)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// one move: merge a group onto a neighbour, smallest groups first (bringing loose pieces to the big groups is
+// cheapest to plan); failing that put a group where it belongs on the solved board (always on the table) so later
+// merges have room, or slide aside a group that hides another
+bool makeMove(Board& board, unsigned int dragSteps, std::vector<char>& seen, SolveStats& stats, Replay* replay) {
+    const std::vector<PuzzlePiece*>& byZ = board.piecesByZ();
+    std::fill(seen.begin(), seen.end(), 0);
+    std::vector<std::vector<PuzzlePiece*> > groups;
+
+    // groups from the top of the pile down, then by size
+    for (auto it = byZ.rbegin(); it != byZ.rend(); ++it) {
+        PuzzlePiece* top = *it;
+        if (seen[top->id]) {
+            continue;
+        }
+        groups.push_back(std::vector<PuzzlePiece*>(1, top));
+        for (auto g : top->group) {
+            groups.back().push_back(g.first);
+        }
+        for (auto m : groups.back()) {
+            seen[m->id] = 1;
+        }
+    }
+    std::stable_sort(groups.begin(), groups.end(),
+                     [](const std::vector<PuzzlePiece*>& l, const std::vector<PuzzlePiece*>& r) { return l.size() < r.size(); });
+
+    for (auto& members : groups) {
+        if (!upright(members.front()) && turnUpright(board, members, stats, replay)) {
+            return true;
+        }
+    }
+
+    const PieceTopology& topo = board.topology();
+    for (auto& members : groups) {
+        for (auto a : members) {
+            for (unsigned int e = topo.edgeStart[a->id]; e < topo.edgeStart[a->id + 1]; ++e) {
+                PuzzlePiece* b = board.piece(topo.edgeTarget[e]);
+                if (inGroup(a, b) || !upright(a) || !upright(b)) {
+                    continue;
+                }
+                glm::vec2 delta = glm::vec2(b->x, b->y) + topo.edgeOffset[e] - glm::vec2(a->x, a->y);
+                glm::vec2 grip;
+                if (findGrip(board, members, delta, grip)) {
+                    dragTo(board, grip, grip + delta, dragSteps, stats, replay);
+                    return true;
+                }
+            }
+        }
+    }
+
+    // nothing merges: put a group where it lies on the solved board, smallest first so the big groups, which
+    // hide the most, go home last
+    for (auto& members : groups) {
+        PuzzlePiece* a = members.front();
+        glm::vec2 delta = board.homePosition(a->id) - glm::vec2(a->x, a->y);
+        glm::vec2 grip;
+        if (upright(a) && std::abs(delta.x) + std::abs(delta.y) > SNAP_THRESHOLD
+            && findGrip(board, members, delta, grip)) {
+            dragTo(board, grip, grip + delta, dragSteps, stats, replay);
+            return true;
+        }
+    }
+
+    // every group that could move is home: slide the group hiding another one aside until it clears it
+    for (auto& members : groups) {
+        glm::vec2 grip;
+        bool hidden = true;
+        for (auto m : members) {
+            hidden = hidden && !visiblePoint(board, m, grip);
+        }
+        if (!hidden) {
+            continue;
+        }
+        PuzzlePiece* a = members.front();
+        PuzzlePiece* cover = board.pick(a->x, a->y);
+        std::vector<PuzzlePiece*> covering(1, cover);
+        glm::vec2 lo(cover->x, cover->y), hi = lo;
+        for (auto g : cover->group) {
+            covering.push_back(g.first);
+            lo = glm::min(lo, glm::vec2(g.first->x, g.first->y));
+            hi = glm::max(hi, glm::vec2(g.first->x, g.first->y));
+        }
+        glm::vec2 half(board.pieceWidth() * 0.75f, board.pieceHeight() * 0.75f);
+        glm::vec2 aside[4] = {
+            glm::vec2(0.0f, a->y - lo.y + half.y), glm::vec2(0.0f, a->y - hi.y - half.y),
+            glm::vec2(a->x - lo.x + half.x, 0.0f), glm::vec2(a->x - hi.x - half.x, 0.0f)
+        };
+        std::sort(aside, aside + 4, [](glm::vec2 l, glm::vec2 r) {
+            return std::abs(l.x) + std::abs(l.y) < std::abs(r.x) + std::abs(r.y);
+        });
+        for (int d = 0; d < 4; ++d) {
+            if (findGrip(board, covering, aside[d], grip)) {
+                dragTo(board, grip, grip + aside[d], dragSteps, stats, replay);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool solveBoard(Board& board, unsigned int dragSteps, SolveStats& stats, Replay* replay) {
+    std::vector<char> seen(board.count());
+    unsigned int maxMoves = board.count() * 5; // n-1 merges plus turns and moves home and aside
+    for (unsigned int m = 0; m < maxMoves && !board.isComplete(); ++m) {
+        if (!makeMove(board, std::max(1u, dragSteps), seen, stats, replay)) {
+            return false;
+        }
+    }
+    return board.isComplete();
+}
+
+SolverBenchmarkResult runSolverBenchmark(const SolverBenchmark& bench) {
+    SolverBenchmarkResult result = SolverBenchmarkResult();
+    std::atomic<unsigned int> solved(0), failed(0);
+    std::atomic<unsigned long long> moves(0), operations(0);
+
+    auto start = sc::high_resolution_clock::now();
+    parallelFor("solve boards", bench.boards, BOARDS_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        Board board;
+        SolveStats stats = SolveStats();
+        for (unsigned int i = begin; i < end; ++i) {
+            board.setup(bench.rows, bench.cols, bench.cut);
+            board.scramble(bench.mode, bench.seed + i, bench.rotation);
+            if (solveBoard(board, bench.dragSteps, stats)) {
+                solved++;
+            } else {
+                failed++;
+            }
+        }
+        moves += stats.moves;
+        operations += stats.operations;
+    });
+    result.seconds = sc::duration<double>(sc::high_resolution_clock::now() - start).count();
+    result.solved = solved;
+    result.failed = failed;
+    result.moves = moves;
+    result.operations = operations;
+    return result;
+}
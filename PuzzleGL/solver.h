@@ -0,0 +1,47 @@
+/*
+SOLVER BOT
+
+An automated player for benchmarking the snapping and grouping engine. It only ever does what a player can do:
+press on a visible point of a piece, drag or turn it, release. A group that is turned is first turned upright, so
+every pair of neighbours it could merge with is turned the same way. Each move takes the smallest group that can make
+progress, grabs one of its pieces and drags the group so that a piece a lands exactly where it snaps onto its
+neighbour b outside the group. When no group can reach a neighbour without leaving the table, a group is moved to
+where it lies on the solved board instead (which is always on the table), or a group hiding another is slid aside.
+ */
+#ifndef PUZZLEGL_SOLVER_H
+#define PUZZLEGL_SOLVER_H
+
+#include "board.h"
+#include "replay.h"
+
+struct SolveStats {
+    unsigned long long moves;
+    unsigned long long operations; // press, drag and release calls
+};
+
+// plays the board until it is complete; false if it got stuck (no group could reach a neighbour). Every press,
+// drag, turn and release is appended to replay if given, a tick apart, as the simulation would have applied them.
+bool solveBoard(Board& board, unsigned int dragSteps, SolveStats& stats, Replay* replay = nullptr);
+
+struct SolverBenchmark {
+    unsigned int boards;
+    unsigned int rows, cols;
+    TopologyKind cut;
+    unsigned int dragSteps;   // pointer positions per drag
+    ScrambleMode mode;
+    RotationMode rotation;
+    uint64_t seed;            // board i is scrambled with seed + i
+};
+
+struct SolverBenchmarkResult {
+    unsigned int solved;
+    unsigned int failed;
+    unsigned long long moves;
+    unsigned long long operations;
+    double seconds;
+};
+
+// solves independent boards on the job system
+SolverBenchmarkResult runSolverBenchmark(const SolverBenchmark& bench);
+
+#endif //PUZZLEGL_SOLVER_H
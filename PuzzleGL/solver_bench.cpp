@@ -0,0 +1,74 @@
+/*
+SOLVER BENCHMARK
+
+Solves many independently scrambled boards with the solver bot on every core (or on [threads] of them) and reports
+end-to-end throughput of the board engine (picking, dragging, snapping and grouping).
+
+usage: solver_bench [boards] [rows] [cols] [threads] [uniform|spread|trays] [seed] [grid|hex|triangle|voronoi]
+                    [none|quarter|free]
+ */
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "job_system.h"
+#include "solver.h"
+
+int main(int argc, char** argv)
+{
+    SolverBenchmark bench;
+    bench.boards = argc > 1 ? std::atoi(argv[1]) : 1000;
+    bench.rows = argc > 2 ? std::atoi(argv[2]) : 10;
+    bench.cols = argc > 3 ? std::atoi(argv[3]) : bench.rows;
+    unsigned int threads = argc > 4 ? std::atoi(argv[4]) : 0;
+    bench.mode = SCRAMBLE_SPREAD;
+    if (argc > 5) {
+        for (int m = 0; m < SCRAMBLE_MODE_COUNT; ++m) {
+            if (std::strcmp(argv[5], scrambleModeName((ScrambleMode)m)) == 0) {
+                bench.mode = (ScrambleMode)m;
+            }
+        }
+    }
+    bench.seed = argc > 6 ? std::strtoull(argv[6], nullptr, 10) : 1;
+    bench.cut = TOPOLOGY_GRID;
+    if (argc > 7) {
+        for (int k = 0; k < TOPOLOGY_KIND_COUNT; ++k) {
+            if (std::strcmp(argv[7], topologyKindName((TopologyKind)k)) == 0) {
+                bench.cut = (TopologyKind)k;
+            }
+        }
+    }
+    bench.rotation = ROTATION_NONE;
+    if (argc > 8) {
+        for (int r = 0; r < ROTATION_MODE_COUNT; ++r) {
+            if (std::strcmp(argv[8], rotationModeName((RotationMode)r)) == 0) {
+                bench.rotation = (RotationMode)r;
+            }
+        }
+    }
+    bench.dragSteps = 8;
+    if (bench.boards == 0 || bench.rows == 0 || bench.cols == 0) {
+        std::cout << "usage: solver_bench [boards] [rows] [cols] [threads] [uniform|spread|trays] [seed] [grid|hex|triangle|voronoi]"
+                  << " [none|quarter|free]" << std::endl;
+        return -1;
+    }
+
+    if (threads != 0) {
+        startJobSystem(threads - 1); // the main thread works while it waits
+    }
+
+    SolverBenchmarkResult result = runSolverBenchmark(bench);
+    std::cout << bench.boards << " boards of " << bench.rows << "x" << bench.cols << " " << topologyKindName(bench.cut)
+              << " (" << scrambleModeName(bench.mode) << ", " << rotationModeName(bench.rotation) << " rotation) in " << result.seconds << "s" << std::endl;
+    std::cout << "solved: " << result.solved << ", stuck: " << result.failed << std::endl;
+    std::cout << "solves/s: " << result.solved / result.seconds << std::endl;
+    std::cout << "moves/s: " << result.moves / result.seconds << std::endl;
+    std::cout << "ops/s: " << result.operations / result.seconds << std::endl;
+    std::vector<JobStats> jobTimes;
+    jobStats(jobTimes);
+    for (auto& j : jobTimes) {
+        std::cout << "job " << j.name << ": " << j.count << " runs, " << j.seconds * 1000 << "ms total, "
+                  << j.worst * 1000 << "ms worst" << std::endl;
+    }
+    return result.failed == 0 ? 0 : -1;
+}
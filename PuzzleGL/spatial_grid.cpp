@@ -0,0 +1,64 @@
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+SpatialGrid::SpatialGrid()
+    : originX(0), originY(0), invCellWidth(1), invCellHeight(1), cols(0), rows(0) {
+}
+
+void SpatialGrid::reset(float minX, float minY, float maxX, float maxY, float cellWidth, float cellHeight,
+                        unsigned int count) {
+    originX = minX;
+    originY = minY;
+    invCellWidth = 1.0f / cellWidth;
+    invCellHeight = 1.0f / cellHeight;
+    cols = std::max(1, (int)std::ceil((maxX - minX) * invCellWidth));
+    rows = std::max(1, (int)std::ceil((maxY - minY) * invCellHeight));
+    cells.assign((size_t)cols * rows, std::vector<unsigned int>());
+    cellOf.assign(count, -1);
+    slotOf.assign(count, 0);
+}
+
+int SpatialGrid::cellX(float x) const {
+    int c = (int)std::floor((x - originX) * invCellWidth);
+    return std::min(std::max(c, 0), cols - 1);
+}
+
+int SpatialGrid::cellY(float y) const {
+    int r = (int)std::floor((y - originY) * invCellHeight);
+    return std::min(std::max(r, 0), rows - 1);
+}
+
+void SpatialGrid::place(unsigned int id, float x, float y) {
+    int cell = cellY(y) * cols + cellX(x);
+    int old = cellOf[id];
+    if (old == cell) {
+        return;
+    }
+    if (old >= 0) {
+        std::vector<unsigned int>& from = cells[old];
+        unsigned int last = from.back();
+        from[slotOf[id]] = last;
+        slotOf[last] = slotOf[id];
+        from.pop_back();
+    }
+    std::vector<unsigned int>& to = cells[cell];
+    cellOf[id] = cell;
+    slotOf[id] = to.size();
+    to.push_back(id);
+}
+
+void SpatialGrid::query(float minX, float minY, float maxX, float maxY, std::vector<unsigned int>& out) const {
+    if (cells.empty()) {
+        return;
+    }
+    int x0 = cellX(minX), x1 = cellX(maxX);
+    int y0 = cellY(minY), y1 = cellY(maxY);
+    for (int r = y0; r <= y1; ++r) {
+        for (int c = x0; c <= x1; ++c) {
+            const std::vector<unsigned int>& cell = cells[(size_t)r * cols + c];
+            out.insert(out.end(), cell.begin(), cell.end());
+        }
+    }
+}
@@ -0,0 +1,37 @@
+/*
+SPATIAL GRID
+
+Uniform grid over the table that buckets pieces by the cell their center lies in. With cells at least as large as
+a piece, everything overlapping a rectangle is found by scanning the cells the rectangle (grown by half a piece)
+touches, so culling and picking cost what is near the view or the cursor rather than the whole board. Moving a
+piece is O(1): it is swapped out of its old cell and appended to the new one.
+ */
+#ifndef PUZZLEGL_SPATIAL_GRID_H
+#define PUZZLEGL_SPATIAL_GRID_H
+
+#include <vector>
+
+class SpatialGrid {
+public:
+    SpatialGrid();
+
+    // empty grid over [minX,maxX] x [minY,maxY] for ids 0..count-1; positions outside go to the border cells
+    void reset(float minX, float minY, float maxX, float maxY, float cellWidth, float cellHeight, unsigned int count);
+    // insert the id, or move it if its cell changed
+    void place(unsigned int id, float x, float y);
+    // appends every id whose cell overlaps the rectangle; callers do the exact overlap test
+    void query(float minX, float minY, float maxX, float maxY, std::vector<unsigned int>& out) const;
+
+private:
+    int cellX(float x) const;
+    int cellY(float y) const;
+
+    float originX, originY;
+    float invCellWidth, invCellHeight;
+    int cols, rows;
+    std::vector<std::vector<unsigned int> > cells;
+    std::vector<int> cellOf;       // per id, -1 until placed
+    std::vector<unsigned int> slotOf; // per id, index inside its cell
+};
+
+#endif //PUZZLEGL_SPATIAL_GRID_H
@@ -0,0 +1,64 @@
+/*
+SPSC RING
+
+Bounded lock-free queue between exactly one producer thread and one consumer thread. Each side owns one index
+and only reads the other's, so push and pop are a copy plus one release store: no locks and no waiting. A full
+ring refuses the push and leaves it to the producer to drop or retry.
+ */
+#ifndef PUZZLEGL_SPSC_RING_H
+#define PUZZLEGL_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template<class T>
+class SpscRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        items.resize(size);
+        mask = size - 1;
+    }
+
+    // producer side
+    bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask) {
+            return false;
+        }
+        items[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side
+    bool pop(T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // items pushed so far, e.g. for the producer to wait until the consumer has caught up with them
+    size_t pushed() const { return head.load(std::memory_order_acquire); }
+    size_t popped() const { return tail.load(std::memory_order_acquire); }
+
+private:
+    SpscRing(const SpscRing&);
+    SpscRing& operator=(const SpscRing&);
+
+    std::vector<T> items;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head; // next slot the producer fills; apart from tail so the sides do not
+    alignas(64) std::atomic<size_t> tail; // share a cache line
+};
+
+#endif //PUZZLEGL_SPSC_RING_H
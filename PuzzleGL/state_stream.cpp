@@ -0,0 +1,419 @@
+#include "state_stream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const float TWO_PI = 6.28318530718f;
+const float QUANTA = 65535.0f;       // steps across a position's range
+const float ANGLE_QUANTA = 65536.0f; // steps in a turn, which wraps
+const unsigned int MAX_VARINT_BYTES = 5;
+const unsigned char POSE_FIELDS = STREAM_X | STREAM_Y | STREAM_ANGLE;
+
+uint16_t quantize(float v, float reach) {
+    float t = (v + reach) / (2.0f * reach) * QUANTA;
+    return (uint16_t)(std::min(std::max(t, 0.0f), QUANTA) + 0.5f);
+}
+
+float unquantize(uint16_t q, float reach) {
+    return q / QUANTA * 2.0f * reach - reach;
+}
+
+uint16_t quantizeAngle(float radians) {
+    float turns = radians / TWO_PI;
+    turns -= std::floor(turns);
+    return (uint16_t)((uint32_t)(turns * ANGLE_QUANTA + 0.5f) & 0xFFFF);
+}
+
+float unquantizeAngle(uint16_t q) {
+    return q / ANGLE_QUANTA * TWO_PI;
+}
+
+uint32_t wholeZ(float z) {
+    return z > 0.0f ? (uint32_t)(z + 0.5f) : 0;
+}
+
+void putVarint(std::vector<unsigned char>& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((unsigned char)v);
+}
+
+void putU16(std::vector<unsigned char>& out, uint16_t v) {
+    out.push_back((unsigned char)v);
+    out.push_back((unsigned char)(v >> 8));
+}
+
+bool takeVarint(const unsigned char*& at, const unsigned char* end, uint32_t& v) {
+    v = 0;
+    for (unsigned int i = 0; i < MAX_VARINT_BYTES && at < end; ++i) {
+        unsigned char b = *at++;
+        v |= (uint32_t)(b & 0x7F) << (7 * i);
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool takeU16(const unsigned char*& at, const unsigned char* end, uint16_t& v) {
+    if (end - at < 2) {
+        return false;
+    }
+    v = (uint16_t)(at[0] | at[1] << 8);
+    at += 2;
+    return true;
+}
+
+} // namespace
+
+StateEncoder::StateEncoder() : reach(0), keyframeDue(true) {
+}
+
+void StateEncoder::reset() {
+    keyframeDue = true;
+}
+
+bool StateEncoder::encode(Board& board, std::vector<unsigned char>& out) {
+    changed.clear();
+    board.capture(captured, &changed);
+    if (captured.x.size() != component.size() || board.tableExtent() + STREAM_MARGIN != reach) {
+        reach = board.tableExtent() + STREAM_MARGIN;
+        keyframeDue = true;
+    }
+    if (keyframeDue) {
+        adopt();
+        keyframe(out);
+        keyframeDue = false;
+        return true;
+    }
+    if (changed.empty()) {
+        return false;
+    }
+
+    // pieces that changed label: whole groups joining a group that keeps its label are merges
+    merges.clear();
+    bool apart = false;
+    for (auto id : changed) {
+        uint32_t from = component[id], to = captured.component[id];
+        if (from == to) {
+            continue;
+        }
+        if (moving[from]++ == 0) {
+            mergeTo[from] = to;
+            merges.push_back(from);
+        } else if (mergeTo[from] != to) {
+            apart = true;
+        }
+    }
+    for (auto from : merges) {
+        uint32_t to = mergeTo[from];
+        if (moving[from] != groupSize[from] || component[to] != to || captured.component[to] != to) {
+            apart = true;
+        }
+        moving[from] = 0;
+    }
+    if (apart) {
+        adopt();
+        keyframe(out);
+        return true;
+    }
+    for (auto from : merges) {
+        groupSize[mergeTo[from]] += groupSize[from];
+        groupSize[from] = 0;
+    }
+
+    updates.clear();
+    for (auto id : changed) {
+        component[id] = captured.component[id];
+        unsigned char fields = 0;
+        if (component[id] == id) {
+            uint16_t x = quantize(captured.x[id], reach), y = quantize(captured.y[id], reach);
+            uint16_t a = quantizeAngle(captured.angle[id]);
+            fields |= (x != qx[id] ? STREAM_X : 0) | (y != qy[id] ? STREAM_Y : 0) | (a != qa[id] ? STREAM_ANGLE : 0);
+            qx[id] = x;
+            qy[id] = y;
+            qa[id] = a;
+        }
+        uint32_t pz = wholeZ(captured.z[id]);
+        if (pz != z[id]) {
+            fields |= STREAM_Z;
+            z[id] = pz;
+        }
+        if (fields != 0) {
+            Update u = { id, fields };
+            updates.push_back(u);
+        }
+    }
+    if (merges.empty() && updates.empty()) {
+        return false;
+    }
+    std::sort(updates.begin(), updates.end(), [](const Update& a, const Update& b) { return a.id < b.id; });
+
+    out.push_back(STREAM_DELTA);
+    putVarint(out, merges.size());
+    for (auto from : merges) {
+        putVarint(out, from);
+        putVarint(out, mergeTo[from]);
+    }
+    putVarint(out, updates.size());
+    uint32_t next = 0, lastZ = 0;
+    bool haveZ = false;
+    for (auto& u : updates) {
+        unsigned char fields = u.fields;
+        // a raised group shares one z
+        if ((fields & STREAM_Z) && haveZ && z[u.id] == lastZ) {
+            fields = (fields & ~STREAM_Z) | STREAM_SAME_Z;
+        }
+        putVarint(out, u.id - next);
+        next = u.id + 1;
+        out.push_back(fields);
+        if (fields & STREAM_X) {
+            putU16(out, qx[u.id]);
+        }
+        if (fields & STREAM_Y) {
+            putU16(out, qy[u.id]);
+        }
+        if (fields & STREAM_ANGLE) {
+            putU16(out, qa[u.id]);
+        }
+        if (fields & STREAM_Z) {
+            putVarint(out, z[u.id]);
+        }
+        if (u.fields & STREAM_Z) {
+            lastZ = z[u.id];
+            haveZ = true;
+        }
+    }
+    return true;
+}
+
+void StateEncoder::keyframe(std::vector<unsigned char>& out) const {
+    out.push_back(STREAM_KEYFRAME);
+    unsigned char bytes[sizeof(float)];
+    std::memcpy(bytes, &reach, sizeof(reach));
+    out.insert(out.end(), bytes, bytes + sizeof(bytes));
+    uint32_t n = component.size();
+    putVarint(out, n);
+    for (uint32_t id = 0; id < n; ++id) {
+        putVarint(out, component[id]);
+        if (component[id] == id) {
+            putU16(out, qx[id]);
+            putU16(out, qy[id]);
+            putU16(out, qa[id]);
+        }
+        putVarint(out, z[id]);
+    }
+}
+
+void StateEncoder::adopt() {
+    size_t n = captured.x.size();
+    qx.resize(n);
+    qy.resize(n);
+    qa.resize(n);
+    z.resize(n);
+    component.resize(n);
+    groupSize.assign(n, 0);
+    moving.assign(n, 0);
+    mergeTo.resize(n);
+    for (size_t id = 0; id < n; ++id) {
+        qx[id] = quantize(captured.x[id], reach);
+        qy[id] = quantize(captured.y[id], reach);
+        qa[id] = quantizeAngle(captured.angle[id]);
+        z[id] = wholeZ(captured.z[id]);
+        component[id] = captured.component[id];
+        groupSize[component[id]]++;
+    }
+}
+
+StateDecoder::StateDecoder() : topo(nullptr), reach(0), haveKeyframe(false) {
+}
+
+void StateDecoder::reset(const PieceTopology& topology) {
+    topo = &topology;
+    unsigned int n = topology.count();
+    haveKeyframe = false;
+    qx.assign(n, 0);
+    qy.assign(n, 0);
+    qa.assign(n, 0);
+    x.assign(n, 0.0f);
+    y.assign(n, 0.0f);
+    angle.assign(n, 0.0f);
+    z.assign(n, 0);
+    component.resize(n);
+    members.assign(n, std::vector<uint32_t>());
+    for (unsigned int id = 0; id < n; ++id) {
+        component[id] = id;
+        members[id].push_back(id);
+    }
+    touched.clear();
+    placing.clear();
+    isTouched.assign(n, 0);
+    isPlacing.assign(n, 0);
+}
+
+bool StateDecoder::apply(const unsigned char* data, size_t size, std::vector<PieceState>& states) {
+    if (topo == nullptr || size == 0) {
+        return false;
+    }
+    const unsigned char* at = data + 1;
+    const unsigned char* end = data + size;
+    bool ok = data[0] == STREAM_KEYFRAME ? keyframe(at, end)
+              : data[0] == STREAM_DELTA && haveKeyframe ? delta(at, end) : false;
+    ok = ok && at == end;
+    for (auto anchor : placing) {
+        isPlacing[anchor] = 0;
+        if (ok) {
+            place(anchor);
+        }
+    }
+    placing.clear();
+    for (auto id : touched) {
+        isTouched[id] = 0;
+        if (ok) {
+            PieceState s = { id, x[id], y[id], (float)z[id], angle[id], component[id] };
+            states.push_back(s);
+        }
+    }
+    touched.clear();
+    if (!ok) {
+        haveKeyframe = false; // what was applied of it is wrong until the next keyframe
+    }
+    return ok;
+}
+
+bool StateDecoder::keyframe(const unsigned char*& at, const unsigned char* end) {
+    uint32_t n;
+    if (end - at < (long)sizeof(float)) {
+        return false;
+    }
+    std::memcpy(&reach, at, sizeof(reach));
+    at += sizeof(reach);
+    if (!(reach > 0.0f) || !takeVarint(at, end, n) || n != topo->count()) {
+        return false;
+    }
+    for (uint32_t id = 0; id < n; ++id) {
+        if (!takeVarint(at, end, component[id]) || component[id] >= n) {
+            return false;
+        }
+        if (component[id] == id
+            && !(takeU16(at, end, qx[id]) && takeU16(at, end, qy[id]) && takeU16(at, end, qa[id]))) {
+            return false;
+        }
+        if (!takeVarint(at, end, z[id])) {
+            return false;
+        }
+    }
+    for (uint32_t id = 0; id < n; ++id) {
+        members[id].clear();
+    }
+    for (uint32_t id = 0; id < n; ++id) {
+        if (component[component[id]] != component[id]) {
+            return false; // a label that is not its own label
+        }
+        if (component[id] == id) {
+            members[id].push_back(id);
+            if (!isPlacing[id]) {
+                isPlacing[id] = 1;
+                placing.push_back(id);
+            }
+        }
+    }
+    for (uint32_t id = 0; id < n; ++id) {
+        if (component[id] != id) {
+            members[component[id]].push_back(id);
+        }
+        touch(id);
+    }
+    haveKeyframe = true;
+    return true;
+}
+
+bool StateDecoder::delta(const unsigned char*& at, const unsigned char* end) {
+    uint32_t n = topo->count(), numMerges, numUpdates;
+    if (!takeVarint(at, end, numMerges)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < numMerges; ++i) {
+        uint32_t from, to;
+        if (!takeVarint(at, end, from) || !takeVarint(at, end, to) || from >= n || to >= n || from == to
+            || component[from] != from || component[to] != to) {
+            return false;
+        }
+        for (auto m : members[from]) {
+            component[m] = to;
+            members[to].push_back(m);
+            touch(m);
+        }
+        members[from].clear();
+        if (!isPlacing[to]) {
+            isPlacing[to] = 1;
+            placing.push_back(to);
+        }
+    }
+
+    if (!takeVarint(at, end, numUpdates)) {
+        return false;
+    }
+    uint32_t next = 0, lastZ = 0;
+    bool haveZ = false;
+    for (uint32_t i = 0; i < numUpdates; ++i) {
+        uint32_t gap;
+        if (!takeVarint(at, end, gap) || gap >= n - std::min(next, n) || at == end) {
+            return false;
+        }
+        uint32_t id = next + gap;
+        next = id + 1;
+        unsigned char fields = *at++;
+        if ((fields & POSE_FIELDS) && component[id] != id) {
+            return false; // only anchors have a pose of their own
+        }
+        if (((fields & STREAM_X) && !takeU16(at, end, qx[id])) || ((fields & STREAM_Y) && !takeU16(at, end, qy[id]))
+            || ((fields & STREAM_ANGLE) && !takeU16(at, end, qa[id]))) {
+            return false;
+        }
+        if ((fields & POSE_FIELDS) && !isPlacing[id]) {
+            isPlacing[id] = 1;
+            placing.push_back(id);
+        }
+        if (fields & STREAM_Z) {
+            if (!takeVarint(at, end, z[id])) {
+                return false;
+            }
+            lastZ = z[id];
+            haveZ = true;
+            touch(id);
+        } else if (fields & STREAM_SAME_Z) {
+            if (!haveZ) {
+                return false;
+            }
+            z[id] = lastZ;
+            touch(id);
+        }
+    }
+    return true;
+}
+
+void StateDecoder::place(uint32_t anchor) {
+    float ax = unquantize(qx[anchor], reach), ay = unquantize(qy[anchor], reach), a = unquantizeAngle(qa[anchor]);
+    float c = std::cos(a), s = std::sin(a);
+    glm::vec2 home = topo->home[anchor];
+    for (auto m : members[anchor]) {
+        glm::vec2 offset = topo->home[m] - home;
+        x[m] = ax + c * offset.x - s * offset.y;
+        y[m] = ay + s * offset.x + c * offset.y;
+        angle[m] = a;
+        touch(m);
+    }
+}
+
+void StateDecoder::touch(uint32_t id) {
+    if (!isTouched[id]) {
+        isTouched[id] = 1;
+        touched.push_back(id);
+    }
+}
@@ -0,0 +1,112 @@
+/*
+STATE STREAM
+
+A compact, per-tick encoding of how a board changes, for players mirroring a board played elsewhere (and spectators
+and replays, which only ever read it). The encoder keeps what every decoder has been sent and each frame carries only
+the difference, worked out from Board::capture's dirty list:
+
+    merges   groups that joined another group this tick, as (old label, new label) pairs
+    updates  per piece, in id order: the pose of a group's anchor (its label, see BoardSnapshot::component) or a loose
+             piece, and any piece's z, each field only if it changed
+
+A group moves rigidly, so one anchor pose moves all of it: the decoder puts every member at its home offset from the
+anchor (the offset a snap leaves between them), turned by the anchor's angle. Positions are quantized to 16 bits over
+the table plus STREAM_MARGIN, angles to 16 bits of a turn; ids, counts and z (whole numbers, as the board stacks
+them) are varints. A keyframe carries the whole board, anchors' poses only; the encoder sends one first, after a
+board of another size, and whenever groups came apart (a scramble, restore or arrange), which deltas cannot express.
+
+    keyframe  uint8 STREAM_KEYFRAME, float reach, varint count, count x (varint label[, uint16 x, y, angle if it is
+              its own label], varint z)
+    delta     uint8 STREAM_DELTA, varint merges, merges x (varint from, to), varint updates, updates x (varint id gap
+              from the previous update's id + 1, uint8 fields, [uint16 x], [uint16 y], [uint16 angle], [varint z])
+ */
+#ifndef PUZZLEGL_STATE_STREAM_H
+#define PUZZLEGL_STATE_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "board.h"
+#include "save_game.h"
+
+const float STREAM_MARGIN = 3.0f; // beyond the table: a held group's anchor may lie a board's diagonal off it
+
+enum StreamFrame {
+    STREAM_KEYFRAME = 1,
+    STREAM_DELTA
+};
+
+enum StreamField {
+    STREAM_X = 1,
+    STREAM_Y = 2,
+    STREAM_ANGLE = 4,
+    STREAM_Z = 8,       // a varint follows
+    STREAM_SAME_Z = 16  // the z of the previous update that had one, with nothing following
+};
+
+class StateEncoder {
+public:
+    StateEncoder();
+
+    // the next frame is a keyframe
+    void reset();
+    // appends the frame of what changed on the board since the last one; false (with nothing appended) if nothing
+    // did. The encoder captures the board itself, so nothing else may capture it in between.
+    bool encode(Board& board, std::vector<unsigned char>& out);
+    // appends a keyframe of the board as the last frame left every decoder, without changing what comes next: for a
+    // decoder that joins now
+    void keyframe(std::vector<unsigned char>& out) const;
+    bool empty() const { return component.empty(); }
+
+private:
+    struct Update {
+        uint32_t id;
+        unsigned char fields;
+    };
+
+    void adopt(); // everything captured, as a keyframe leaves it
+
+    BoardSnapshot captured;
+    std::vector<unsigned int> changed;
+    float reach;
+    bool keyframeDue;
+    // what the decoders have, by piece id
+    std::vector<uint16_t> qx, qy, qa;
+    std::vector<uint32_t> z, component;
+    std::vector<uint32_t> groupSize; // by label
+    // scratch, by label
+    std::vector<uint32_t> moving, mergeTo;
+    std::vector<uint32_t> merges;
+    std::vector<Update> updates;
+};
+
+class StateDecoder {
+public:
+    StateDecoder();
+
+    // for frames of boards with this topology, which must outlive the decoder's use; a keyframe comes first
+    void reset(const PieceTopology& topology);
+    // applies one frame and appends the state of every piece it changed; false if the frame is malformed, is of
+    // another board, or is a delta with no keyframe before it (the decoder then waits for a keyframe)
+    bool apply(const unsigned char* data, size_t size, std::vector<PieceState>& states);
+    bool synced() const { return haveKeyframe; }
+
+private:
+    bool keyframe(const unsigned char*& at, const unsigned char* end);
+    bool delta(const unsigned char*& at, const unsigned char* end);
+    void place(uint32_t anchor); // every member of the anchor's group, from the anchor's pose
+    void touch(uint32_t id);
+
+    const PieceTopology* topo;
+    float reach;
+    bool haveKeyframe;
+    std::vector<uint16_t> qx, qy, qa;
+    std::vector<float> x, y, angle;
+    std::vector<uint32_t> z, component;
+    std::vector<std::vector<uint32_t> > members; // by label, the label first
+    std::vector<uint32_t> touched, placing;
+    std::vector<char> isTouched, isPlacing;
+};
+
+#endif //PUZZLEGL_STATE_STREAM_H
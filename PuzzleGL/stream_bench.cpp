@@ -0,0 +1,191 @@
+/*
+STATE STREAM BENCHMARK
+
+Plays a large board with every pointer dragging at once and streams it as a co-op server would (see STATE STREAM),
+one frame per tick, to a player's board that only ever mirrors it. Each pointer over and over grabs a random piece,
+drags its group for DRAG_TICKS ticks to where it snaps onto a neighbour and drops it there, so groups keep growing
+and the large ones keep moving. Reports the bytes per tick against the plain PieceState records the stream replaced,
+the encode, decode and mirror time per tick, and how closely the player's board ends up following the server's.
+
+usage: stream_bench [rows] [cols] [ticks] [pointers] [seed]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "board.h"
+#include "state_stream.h"
+
+namespace sc = std::chrono;
+
+namespace {
+
+const unsigned int TICK_HZ = 30; // as COOP_TICK_HZ
+const unsigned int DRAG_TICKS = 20;
+
+struct BenchPointer {
+    unsigned int tick; // of the current drag, 0 while not dragging
+    glm::vec2 from, to;
+};
+
+struct Timings {
+    std::vector<float> samples;
+    void add(sc::steady_clock::time_point start) {
+        samples.push_back(sc::duration<float, std::micro>(sc::steady_clock::now() - start).count());
+    }
+    // mean and p99, in microseconds
+    void print(const char* name) {
+        std::sort(samples.begin(), samples.end());
+        double total = 0;
+        for (auto s : samples) {
+            total += s;
+        }
+        std::cout << name << ": " << total / samples.size() << "us mean, "
+                  << samples[std::min(samples.size() - 1, samples.size() * 99 / 100)] << "us p99, "
+                  << samples.back() << "us worst per tick" << std::endl;
+    }
+};
+
+// where the pointer goes for the piece it holds to snap onto a neighbour outside its group, false if there is none
+bool snapTarget(Board& board, unsigned int pointer, glm::vec2& target) {
+    const PieceTopology& topo = board.topology();
+    PuzzlePiece* held = board.heldPiece(pointer);
+    for (uint32_t e = topo.edgeStart[held->id]; e < topo.edgeStart[held->id + 1]; ++e) {
+        PuzzlePiece* q = board.piece(topo.edgeTarget[e]);
+        if (board.holder(q) >= 0) {
+            continue; // its own group, or another pointer's
+        }
+        glm::vec2 at = glm::vec2(q->x, q->y) + rotated(topo.home[held->id] - topo.home[q->id], q->angle);
+        target = at + board.grabOffset(pointer);
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned int rows = argc > 1 ? std::atoi(argv[1]) : 100;
+    unsigned int cols = argc > 2 ? std::atoi(argv[2]) : rows;
+    unsigned int numTicks = argc > 3 ? std::atoi(argv[3]) : 3000;
+    unsigned int numPointers = argc > 4 ? std::atoi(argv[4]) : MAX_POINTERS;
+    uint64_t seed = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 1;
+    if (rows == 0 || cols == 0 || numTicks == 0 || numPointers == 0 || numPointers > MAX_POINTERS) {
+        std::cout << "usage: stream_bench [rows] [cols] [ticks] [pointers (1-" << MAX_POINTERS << ")] [seed]"
+                  << std::endl;
+        return -1;
+    }
+
+    Board server, player;
+    server.setup(rows, cols);
+    server.scramble(SCRAMBLE_UNIFORM, seed);
+    player.setup(rows, cols);
+    unsigned int n = server.count();
+    StateEncoder encoder;
+    StateDecoder decoder;
+    decoder.reset(player.topology());
+
+    std::mt19937 random((unsigned int)seed);
+    std::vector<BenchPointer> pointers(numPointers);
+    for (auto& p : pointers) {
+        p.tick = 0;
+    }
+    std::vector<unsigned char> frame;
+    std::vector<PieceState> states;
+    std::vector<unsigned int> bytes;
+    Timings encoding, decoding, mirroring;
+    unsigned long long totalBytes = 0, recordBytes = 0, drags = 0;
+    unsigned int keyframes = 0, keyframeBytes = 0;
+    for (unsigned int t = 0; t < numTicks; ++t) {
+        for (unsigned int k = 0; k < numPointers; ++k) {
+            BenchPointer& p = pointers[k];
+            if (p.tick == 0) {
+                PuzzlePiece* grab = server.piece(random() % n);
+                if (!server.press(grab->x, grab->y, k)) {
+                    continue;
+                }
+                p.from = glm::vec2(grab->x, grab->y);
+                if (!snapTarget(server, k, p.to)) {
+                    server.release(glm::vec2(0.0f), k);
+                    continue;
+                }
+                p.tick = 1;
+                drags++;
+            } else if (p.tick < DRAG_TICKS) {
+                glm::vec2 at = p.from + (p.to - p.from) * ((float)p.tick / DRAG_TICKS);
+                server.drag(at.x, at.y, k);
+                p.tick++;
+            } else {
+                server.drag(p.to.x, p.to.y, k);
+                server.release(glm::vec2(0.0f), k);
+                p.tick = 0;
+            }
+        }
+        server.advance(1.0f / TICK_HZ);
+        server.settle();
+
+        frame.clear();
+        auto start = sc::steady_clock::now();
+        bool sent = encoder.encode(server, frame);
+        encoding.add(start);
+        if (!sent) {
+            bytes.push_back(0);
+            continue;
+        }
+        states.clear();
+        start = sc::steady_clock::now();
+        if (!decoder.apply(frame.data(), frame.size(), states)) {
+            std::cout << "[ERROR] the decoder refused frame " << t << std::endl;
+            return -1;
+        }
+        decoding.add(start);
+        start = sc::steady_clock::now();
+        player.mirror(states);
+        mirroring.add(start);
+        if (frame[0] == STREAM_KEYFRAME) {
+            keyframes++;
+            keyframeBytes = frame.size();
+        }
+        bytes.push_back(frame.size());
+        totalBytes += frame.size();
+        recordBytes += states.size() * sizeof(PieceState);
+    }
+
+    // how far the player's board is from the server's: every piece, and every group
+    float worst = 0;
+    unsigned int groupsApart = 0;
+    for (unsigned int id = 0; id < n; ++id) {
+        PuzzlePiece* a = server.piece(id);
+        PuzzlePiece* b = player.piece(id);
+        worst = std::max(worst, std::max(std::abs(a->x - b->x), std::abs(a->y - b->y)));
+        groupsApart += a->group.size() != b->group.size();
+    }
+    unsigned int groups = 0;
+    for (unsigned int id = 0; id < n; ++id) {
+        PuzzlePiece* a = server.piece(id);
+        groups += a->group.empty() || std::less<PuzzlePiece*>()(a, a->group.begin()->first);
+    }
+
+    std::sort(bytes.begin(), bytes.end());
+    double seconds = (double)numTicks / TICK_HZ;
+    std::cout << rows << "x" << cols << " board (" << n << " pieces), " << numPointers << " pointers dragging, "
+              << numTicks << " ticks at " << TICK_HZ << "/s" << std::endl;
+    std::cout << "drags: " << drags << ", groups left: " << groups << ", keyframes: " << keyframes << " ("
+              << keyframeBytes << " bytes)" << std::endl;
+    std::cout << "bytes per tick: " << (double)totalBytes / numTicks << " mean, "
+              << bytes[std::min(bytes.size() - 1, bytes.size() * 99 / 100)] << " p99, " << bytes.back()
+              << " worst; " << totalBytes / seconds / 1024 << " KB/s" << std::endl;
+    std::cout << "as plain PieceState records: " << recordBytes / seconds / 1024 << " KB/s ("
+              << (totalBytes > 0 ? (double)recordBytes / totalBytes : 0) << "x the stream)" << std::endl;
+    encoding.print("encode");
+    decoding.print("decode");
+    mirroring.print("mirror");
+    std::cout << "player's board: positions within " << worst << " of the server's (quantum "
+              << 2 * (server.tableExtent() + STREAM_MARGIN) / 65535 << "), " << groupsApart
+              << " pieces in groups of another size" << std::endl;
+    return groupsApart == 0 ? 0 : -1;
+}
@@ -0,0 +1,56 @@
+/*
+TILE LAYOUT
+
+Geometry shared by everything that cuts, stores or samples picture tiles: the streaming ingest, tiled level
+bundles and the virtual texture. Every tile holds TILE_CONTENT x TILE_CONTENT texels of one mip level plus a
+TILE_BORDER wide copy of its neighbours' texels (clamped at the picture edge), stored as TILE_SLOT_SIZE rows of
+tightly packed RGBA8.
+ */
+#ifndef PUZZLEGL_TILE_LAYOUT_H
+#define PUZZLEGL_TILE_LAYOUT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+const int TILE_CONTENT = 254;
+const int TILE_BORDER = 1;
+const int TILE_SLOT_SIZE = TILE_CONTENT + 2 * TILE_BORDER;
+const size_t TILE_BYTES = (size_t)TILE_SLOT_SIZE * TILE_SLOT_SIZE * 4;
+
+// pictures larger than this on either side are tiled instead of being kept as whole mips
+const unsigned int VIRTUAL_TEXTURE_MIN_SIZE = 4096;
+
+inline unsigned int mipSize(unsigned int size, unsigned int level){
+    return std::max(1u, size >> level);
+}
+
+inline unsigned int tilesAcross(unsigned int size, unsigned int level){
+    return (mipSize(size, level) + TILE_CONTENT - 1) / TILE_CONTENT;
+}
+
+// mip levels down to the first one that fits in a single tile
+inline unsigned int tiledMipCount(unsigned int width, unsigned int height){
+    unsigned int levels = 1;
+    while (tilesAcross(width, levels - 1) > 1 || tilesAcross(height, levels - 1) > 1) {
+        ++levels;
+    }
+    return levels;
+}
+
+// fill one row of tile tx from a row of its mip level (width texels of RGBA8), repeating the edge texel where
+// the tile and its border reach past the picture
+inline void copyTileRow(const unsigned char* row, unsigned int width, unsigned int tx, unsigned char* out){
+    int x0 = (int)tx * TILE_CONTENT - TILE_BORDER;
+    int first = std::max(0, -x0);
+    int last = std::max(first, std::min(TILE_SLOT_SIZE, (int)width - x0)); // one past the last in-picture texel
+    for (int x = 0; x < first; ++x) {
+        memcpy(out + x * 4, row, 4);
+    }
+    memcpy(out + first * 4, row + (size_t)(x0 + first) * 4, (size_t)(last - first) * 4);
+    for (int x = last; x < TILE_SLOT_SIZE; ++x) {
+        memcpy(out + x * 4, row + (size_t)(width - 1) * 4, 4);
+    }
+}
+
+#endif //PUZZLEGL_TILE_LAYOUT_H
@@ -0,0 +1,401 @@
+#include "topology.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+#include "job_system.h"
+#include "scramble.h"
+#include "spatial_grid.h"
+
+namespace {
+
+typedef std::vector<glm::vec2> Polygon;
+
+const float ON_LINE = 1e-5f;          // how far a vertex may lie off an edge's line and still be on it
+const float MIN_SHARED = 1e-4f;       // shorter common borders do not make two pieces neighbours
+const float SHAPE_QUANTUM = 1e4f;     // outlines whose corners agree to 1 / SHAPE_QUANTUM share a mask
+const float VORONOI_JITTER = 0.8f;    // sites move up to this many cells' worth around their grid cell's center
+const unsigned int PIECES_PER_JOB = 1024;
+
+float cross(glm::vec2 a, glm::vec2 b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+// keeps the part of poly where dot(n, p) <= d (Sutherland-Hodgman against one half-plane)
+void clip(Polygon& poly, glm::vec2 n, float d, Polygon& scratch) {
+    scratch.clear();
+    for (size_t i = 0; i < poly.size(); ++i) {
+        glm::vec2 a = poly[i], b = poly[(i + 1) % poly.size()];
+        float da = glm::dot(n, a) - d, db = glm::dot(n, b) - d;
+        if (da <= 0) {
+            scratch.push_back(a);
+        }
+        if ((da < 0 && db > 0) || (da > 0 && db < 0)) {
+            scratch.push_back(a + (b - a) * (da / (da - db)));
+        }
+    }
+    poly.swap(scratch);
+}
+
+void clipToBoard(Polygon& poly, Polygon& scratch) {
+    clip(poly, glm::vec2(1.0f, 0.0f), 1.0f, scratch);
+    clip(poly, glm::vec2(-1.0f, 0.0f), 1.0f, scratch);
+    clip(poly, glm::vec2(0.0f, 1.0f), 1.0f, scratch);
+    clip(poly, glm::vec2(0.0f, -1.0f), 1.0f, scratch);
+    // a clip line through a vertex leaves it twice
+    Polygon& out = scratch;
+    out.clear();
+    for (size_t i = 0; i < poly.size(); ++i) {
+        if (glm::length(poly[i] - poly[(i + 1) % poly.size()]) > ON_LINE) {
+            out.push_back(poly[i]);
+        }
+    }
+    poly.swap(out);
+}
+
+float signedArea(const Polygon& poly) {
+    float a = 0;
+    for (size_t i = 0; i < poly.size(); ++i) {
+        a += cross(poly[i], poly[(i + 1) % poly.size()]);
+    }
+    return a / 2;
+}
+
+glm::vec2 centroid(const Polygon& poly) {
+    glm::vec2 c(0.0f);
+    float a = 0;
+    for (size_t i = 0; i < poly.size(); ++i) {
+        float w = cross(poly[i], poly[(i + 1) % poly.size()]);
+        c += (poly[i] + poly[(i + 1) % poly.size()]) * w;
+        a += w;
+    }
+    return c / (3 * a);
+}
+
+void addCell(std::vector<Polygon>& cells, Polygon poly, Polygon& scratch) {
+    clipToBoard(poly, scratch);
+    if (poly.size() >= 3 && signedArea(poly) > MIN_SHARED * MIN_SHARED) {
+        cells.push_back(poly);
+    }
+}
+
+void gridCells(unsigned int rows, unsigned int cols, std::vector<Polygon>& cells) {
+    float w = 2.0f / cols, h = 2.0f / rows;
+    Polygon scratch;
+    for (unsigned int r = 0; r < rows; ++r) {
+        for (unsigned int c = 0; c < cols; ++c) {
+            float x0 = -1 + w * c, y1 = 1 - h * r;
+            Polygon p = { glm::vec2(x0, y1 - h), glm::vec2(x0 + w, y1 - h), glm::vec2(x0 + w, y1), glm::vec2(x0, y1) };
+            addCell(cells, p, scratch);
+        }
+    }
+}
+
+void hexCells(unsigned int rows, unsigned int cols, std::vector<Polygon>& cells) {
+    // pointy-top hexagons: rows are 3/4 of a hexagon apart
+    float w = 2.0f / cols, rowH = 2.0f / rows, hexH = rowH * 4 / 3;
+    Polygon scratch;
+    for (unsigned int r = 0; r < rows; ++r) {
+        float cy = 1 - rowH * (r + 0.5f);
+        bool shifted = r % 2 == 1;
+        for (unsigned int c = 0; c < cols + (shifted ? 1 : 0); ++c) {
+            float cx = -1 + w * (c + (shifted ? 0.0f : 0.5f));
+            // the first and last rows reach out to the border instead of leaving notches between their points
+            float top = r == 0 ? 1.0f : cy + hexH / 4, topPoint = r == 0 ? 1.0f : cy + hexH / 2;
+            float bottom = r == rows - 1 ? -1.0f : cy - hexH / 4, bottomPoint = r == rows - 1 ? -1.0f : cy - hexH / 2;
+            Polygon p = {
+                glm::vec2(cx, bottomPoint), glm::vec2(cx + w / 2, bottom), glm::vec2(cx + w / 2, top),
+                glm::vec2(cx, topPoint), glm::vec2(cx - w / 2, top), glm::vec2(cx - w / 2, bottom)
+            };
+            addCell(cells, p, scratch);
+        }
+    }
+}
+
+void triangleCells(unsigned int rows, unsigned int cols, std::vector<Polygon>& cells) {
+    float b = 2.0f / cols, rowH = 2.0f / rows;
+    Polygon scratch;
+    for (unsigned int r = 0; r < rows; ++r) {
+        float top = 1 - rowH * r, bottom = top - rowH;
+        for (unsigned int k = 0; k <= 2 * cols; ++k) {
+            float apex = -1 + k * b / 2;
+            if ((k + r) % 2 == 0) {
+                Polygon p = { glm::vec2(apex - b / 2, bottom), glm::vec2(apex + b / 2, bottom), glm::vec2(apex, top) };
+                addCell(cells, p, scratch);
+            } else {
+                Polygon p = { glm::vec2(apex, bottom), glm::vec2(apex + b / 2, top), glm::vec2(apex - b / 2, top) };
+                addCell(cells, p, scratch);
+            }
+        }
+    }
+}
+
+void voronoiCells(unsigned int rows, unsigned int cols, uint64_t seed, std::vector<Polygon>& cells) {
+    float cw = 2.0f / cols, rh = 2.0f / rows;
+    unsigned int n = rows * cols;
+    std::vector<glm::vec2> sites(n);
+    Rng rng(seed);
+    for (unsigned int i = 0; i < n; ++i) {
+        float jx = VORONOI_JITTER * (rng.uniform() - 0.5f), jy = VORONOI_JITTER * (rng.uniform() - 0.5f);
+        sites[i] = glm::vec2(-1 + (i % cols + 0.5f + jx) * cw, 1 - (i / cols + 0.5f + jy) * rh);
+    }
+    // every point is within a cell diagonal of its own cell's site, so a cell fits in that radius around its site
+    // and a neighbour's site is within two diagonals
+    float diagonal = std::sqrt(cw * cw + rh * rh);
+    int reachX = (int)std::ceil(2 * diagonal / cw) + 1, reachY = (int)std::ceil(2 * diagonal / rh) + 1;
+    cells.assign(n, Polygon());
+    parallelFor("voronoi cells", n, PIECES_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        Polygon scratch;
+        std::vector<std::pair<float, unsigned int> > candidates;
+        for (unsigned int i = begin; i < end; ++i) {
+            glm::vec2 p = sites[i];
+            int r0 = i / cols, c0 = i % cols;
+            candidates.clear();
+            for (int r = std::max(0, r0 - reachY); r <= std::min((int)rows - 1, r0 + reachY); ++r) {
+                for (int c = std::max(0, c0 - reachX); c <= std::min((int)cols - 1, c0 + reachX); ++c) {
+                    unsigned int j = r * cols + c;
+                    float distance = glm::length(sites[j] - p);
+                    if (j != i && distance <= 2 * diagonal) {
+                        candidates.push_back(std::make_pair(distance, j));
+                    }
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+            Polygon& poly = cells[i];
+            poly = { p + glm::vec2(-diagonal, -diagonal), p + glm::vec2(diagonal, -diagonal),
+                     p + glm::vec2(diagonal, diagonal), p + glm::vec2(-diagonal, diagonal) };
+            float reach = 2 * std::sqrt(2.0f) * diagonal;
+            for (auto& s : candidates) {
+                // a site further than twice the cell's farthest corner cannot cut it any more
+                if (s.first > reach) {
+                    break;
+                }
+                glm::vec2 q = sites[s.second];
+                clip(poly, q - p, glm::dot(q - p, (q + p) * 0.5f), scratch);
+                reach = 0;
+                for (auto v : poly) {
+                    reach = std::max(reach, glm::length(v - p));
+                }
+                reach *= 2;
+            }
+            clipToBoard(poly, scratch);
+        }
+    });
+}
+
+// the pieces' outlines share a stretch of border at least MIN_SHARED long
+bool shareBorder(const glm::vec2* a, unsigned int na, const glm::vec2* b, unsigned int nb) {
+    for (unsigned int i = 0; i < na; ++i) {
+        glm::vec2 p = a[i], q = a[(i + 1) % na];
+        float length = glm::length(q - p);
+        glm::vec2 u = (q - p) / length;
+        for (unsigned int j = 0; j < nb; ++j) {
+            glm::vec2 c = b[j] - p, d = b[(j + 1) % nb] - p;
+            if (std::abs(cross(u, c)) > ON_LINE || std::abs(cross(u, d)) > ON_LINE) {
+                continue;
+            }
+            float tc = glm::dot(u, c), td = glm::dot(u, d);
+            if (std::min(length, std::max(tc, td)) - std::max(0.0f, std::min(tc, td)) > MIN_SHARED) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool onBoardBorder(glm::vec2 a, glm::vec2 b) {
+    return (std::abs(a.x - b.x) < ON_LINE && std::abs(std::abs(a.x) - 1) < ON_LINE)
+        || (std::abs(a.y - b.y) < ON_LINE && std::abs(std::abs(a.y) - 1) < ON_LINE);
+}
+
+// outlines are compared by their corners rounded to 1 / SHAPE_QUANTUM
+int32_t quantized(float v) {
+    return (int32_t)std::lround(v * SHAPE_QUANTUM);
+}
+
+uint64_t shapeHash(const PieceTopology& t, unsigned int i) {
+    uint64_t hash = 14695981039346656037ull; // FNV-1a over the rounded corners
+    for (unsigned int v = t.outlineStart[i]; v < t.outlineStart[i + 1]; ++v) {
+        hash = (hash ^ (uint32_t)quantized(t.outline[v].x)) * 1099511628211ull;
+        hash = (hash ^ (uint32_t)quantized(t.outline[v].y)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool sameShape(const PieceTopology& t, unsigned int i, unsigned int j) {
+    unsigned int n = t.outlineStart[i + 1] - t.outlineStart[i];
+    if (n != t.outlineStart[j + 1] - t.outlineStart[j]) {
+        return false;
+    }
+    for (unsigned int v = 0; v < n; ++v) {
+        glm::vec2 a = t.outline[t.outlineStart[i] + v], b = t.outline[t.outlineStart[j] + v];
+        if (quantized(a.x) != quantized(b.x) || quantized(a.y) != quantized(b.y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+const char* topologyKindName(TopologyKind kind) {
+    switch (kind) {
+        case TOPOLOGY_GRID: return "grid";
+        case TOPOLOGY_HEX: return "hex";
+        case TOPOLOGY_TRIANGLE: return "triangle";
+        case TOPOLOGY_VORONOI: return "voronoi";
+        default: return "?";
+    }
+}
+
+glm::vec2 PieceTopology::maxPieceSize() const {
+    glm::vec2 size(0.0f);
+    for (unsigned int i = 0; i < count(); ++i) {
+        size = glm::max(size, boundsMax[i] - boundsMin[i]);
+    }
+    return size;
+}
+
+bool PieceTopology::contains(unsigned int id, glm::vec2 local) const {
+    unsigned int first = outlineStart[id], n = outlineStart[id + 1] - first;
+    if (local.x < boundsMin[id].x || local.y < boundsMin[id].y || local.x >= boundsMax[id].x || local.y >= boundsMax[id].y) {
+        return false;
+    }
+    Coverage coverage = masks[shape[id]].at(local);
+    return coverage == COVERAGE_EDGE ? insideOutline(&outline[first], n, local) : coverage == COVERAGE_INSIDE;
+}
+
+void buildTopology(TopologyKind kind, unsigned int rows, unsigned int cols, uint64_t seed, PieceTopology& t) {
+    std::vector<Polygon> cells;
+    switch (kind) {
+        case TOPOLOGY_HEX: hexCells(rows, cols, cells); break;
+        case TOPOLOGY_TRIANGLE: triangleCells(rows, cols, cells); break;
+        case TOPOLOGY_VORONOI: voronoiCells(rows, cols, seed, cells); break;
+        default: kind = TOPOLOGY_GRID; gridCells(rows, cols, cells); break;
+    }
+    t.kind = kind;
+    t.rows = rows;
+    t.cols = cols;
+
+    // outlines around each centroid
+    unsigned int n = cells.size();
+    t.home.resize(n);
+    t.boundsMin.resize(n);
+    t.boundsMax.resize(n);
+    t.border.assign(n, 0);
+    t.inradius.resize(n);
+    t.outlineStart.resize(n + 1);
+    t.outlineStart[0] = 0;
+    for (unsigned int i = 0; i < n; ++i) {
+        t.outlineStart[i + 1] = t.outlineStart[i] + cells[i].size();
+    }
+    t.outline.resize(t.outlineStart[n]);
+    parallelFor("topology outlines", n, PIECES_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            const Polygon& poly = cells[i];
+            glm::vec2 home = centroid(poly);
+            t.home[i] = home;
+            t.boundsMin[i] = t.boundsMax[i] = poly[0] - home;
+            t.inradius[i] = std::numeric_limits<float>::max();
+            for (size_t v = 0; v < poly.size(); ++v) {
+                glm::vec2 local = poly[v] - home, side = poly[(v + 1) % poly.size()] - poly[v];
+                if (glm::length(side) > 0) {
+                    t.inradius[i] = std::min(t.inradius[i], std::abs(cross(side, local)) / glm::length(side));
+                }
+                t.outline[t.outlineStart[i] + v] = local;
+                t.boundsMin[i] = glm::min(t.boundsMin[i], local);
+                t.boundsMax[i] = glm::max(t.boundsMax[i], local);
+                t.border[i] |= onBoardBorder(poly[v], poly[(v + 1) % poly.size()]);
+            }
+        }
+    });
+
+    // one mask per distinct outline; a hash collision just costs the piece a mask of its own
+    t.shape.resize(n);
+    std::unordered_map<uint64_t, uint32_t> shapes(n);
+    std::vector<unsigned int> firstOfShape;
+    for (unsigned int i = 0; i < n; ++i) {
+        auto inserted = shapes.insert(std::make_pair(shapeHash(t, i), (uint32_t)firstOfShape.size()));
+        if (inserted.second || !sameShape(t, i, firstOfShape[inserted.first->second])) {
+            t.shape[i] = firstOfShape.size();
+            firstOfShape.push_back(i);
+        } else {
+            t.shape[i] = inserted.first->second;
+        }
+    }
+    t.masks.resize(firstOfShape.size());
+    parallelFor("topology masks", firstOfShape.size(), PIECES_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int s = begin; s < end; ++s) {
+            unsigned int i = firstOfShape[s], first = t.outlineStart[i];
+            buildCoverageMask(&t.outline[first], t.outlineStart[i + 1] - first, t.boundsMin[i], t.boundsMax[i], t.masks[s]);
+        }
+    });
+
+    // neighbours among the pieces bucketed around each one; a pair is tested once, from its lower id
+    glm::vec2 size = t.maxPieceSize();
+    SpatialGrid grid;
+    grid.reset(-1.0f, -1.0f, 1.0f, 1.0f, size.x, size.y, n);
+    for (unsigned int i = 0; i < n; ++i) {
+        grid.place(i, t.home[i].x, t.home[i].y);
+    }
+    std::vector<std::vector<uint32_t> > higher(n);
+    parallelFor("topology adjacency", n, PIECES_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        std::vector<unsigned int> nearby;
+        for (unsigned int i = begin; i < end; ++i) {
+            nearby.clear();
+            glm::vec2 lo = t.home[i] + t.boundsMin[i] - size, hi = t.home[i] + t.boundsMax[i] + size;
+            grid.query(lo.x, lo.y, hi.x, hi.y, nearby);
+            for (auto j : nearby) {
+                bool overlap = t.home[j].x + t.boundsMin[j].x <= hi.x - size.x + ON_LINE
+                    && t.home[j].x + t.boundsMax[j].x >= lo.x + size.x - ON_LINE
+                    && t.home[j].y + t.boundsMin[j].y <= hi.y - size.y + ON_LINE
+                    && t.home[j].y + t.boundsMax[j].y >= lo.y + size.y - ON_LINE;
+                if (j > i && overlap && shareBorder(&cells[i][0], cells[i].size(), &cells[j][0], cells[j].size())) {
+                    higher[i].push_back(j);
+                }
+            }
+        }
+    });
+
+    // both directions of every pair, each piece's neighbours sorted by id
+    std::vector<uint32_t> degree(n, 0);
+    for (unsigned int i = 0; i < n; ++i) {
+        degree[i] += higher[i].size();
+        for (auto j : higher[i]) {
+            degree[j]++;
+        }
+    }
+    t.edgeStart.resize(n + 1);
+    t.edgeStart[0] = 0;
+    for (unsigned int i = 0; i < n; ++i) {
+        t.edgeStart[i + 1] = t.edgeStart[i] + degree[i];
+    }
+    unsigned int numEdges = t.edgeStart[n];
+    t.edgeTarget.resize(numEdges);
+    std::vector<uint32_t> fill(t.edgeStart.begin(), t.edgeStart.end() - 1);
+    for (unsigned int i = 0; i < n; ++i) {
+        for (auto j : higher[i]) {
+            t.edgeTarget[fill[i]++] = j;
+            t.edgeTarget[fill[j]++] = i;
+        }
+    }
+    t.edgeTwin.resize(numEdges);
+    t.edgeOffset.resize(numEdges);
+    parallelFor("topology edges", n, PIECES_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            std::sort(t.edgeTarget.begin() + t.edgeStart[i], t.edgeTarget.begin() + t.edgeStart[i + 1]);
+        }
+    });
+    parallelFor("topology edges", n, PIECES_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            for (unsigned int e = t.edgeStart[i]; e < t.edgeStart[i + 1]; ++e) {
+                unsigned int j = t.edgeTarget[e];
+                auto back = std::lower_bound(t.edgeTarget.begin() + t.edgeStart[j], t.edgeTarget.begin() + t.edgeStart[j + 1], i);
+                t.edgeTwin[e] = back - t.edgeTarget.begin();
+                t.edgeOffset[e] = t.home[i] - t.home[j];
+            }
+        }
+    });
+}
@@ -0,0 +1,82 @@
+/*
+TOPOLOGY
+
+How the picture is cut into pieces, independent of where the pieces lie. Every cut is a set of convex polygons
+covering the solved board ([-1,1] on both axes):
+
+    TOPOLOGY_GRID      rows x cols rectangles
+    TOPOLOGY_HEX       rows of cols pointy-top hexagons, every other row shifted by half a hexagon; hexagons
+                       sticking out of the board are cut off at its border (odd rows get cols + 1 pieces), and the
+                       first and last rows are stretched flat against it
+    TOPOLOGY_TRIANGLE  rows of 2 * cols + 1 triangles pointing alternately up and down, the two at the ends of
+                       a row cut in half by the border
+    TOPOLOGY_VORONOI   the Voronoi cells of rows x cols sites jittered inside a grid, clipped to the board
+
+Adjacency is a compressed sparse row graph over half-edges: the neighbours of piece i are
+edgeTarget[edgeStart[i] .. edgeStart[i+1]), and edgeOffset of that half-edge is where i lies relative to the
+neighbour when the two are snapped together. Two pieces are neighbours when their outlines share a stretch of
+border (touching corners do not count). Everything is flat arrays, about 40 bytes per piece plus 16 per
+half-edge, 8 per outline vertex and 80 per distinct outline, so a 100k-piece Voronoi board is a few MB walked front
+to back.
+
+Piece outlines are stored counter-clockwise relative to the piece's home position (its centroid, which is inside
+the piece since the pieces are convex), in the same CSR layout. Pieces whose outlines match (to a ten-thousandth of
+the board) share one coverage mask for picking; see coverage_mask.h.
+ */
+#ifndef PUZZLEGL_TOPOLOGY_H
+#define PUZZLEGL_TOPOLOGY_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "coverage_mask.h"
+
+enum TopologyKind {
+    TOPOLOGY_GRID = 0,
+    TOPOLOGY_HEX = 1,
+    TOPOLOGY_TRIANGLE = 2,
+    TOPOLOGY_VORONOI = 3,
+    TOPOLOGY_KIND_COUNT
+};
+
+const char* topologyKindName(TopologyKind kind);
+
+struct PieceTopology {
+    TopologyKind kind;
+    unsigned int rows, cols;
+
+    // per piece
+    std::vector<glm::vec2> home;      // centroid on the solved board
+    std::vector<glm::vec2> boundsMin; // bounding box relative to home
+    std::vector<glm::vec2> boundsMax;
+    std::vector<char> border;         // a side of the piece lies on the board's border
+    std::vector<float> inradius;      // the largest circle around home that fits inside the piece
+
+    // adjacency, per half-edge
+    std::vector<uint32_t> edgeStart;  // count() + 1
+    std::vector<uint32_t> edgeTarget;
+    std::vector<uint32_t> edgeTwin;   // the same edge seen from the neighbour
+    std::vector<glm::vec2> edgeOffset;
+
+    // outlines
+    std::vector<uint32_t> outlineStart; // count() + 1
+    std::vector<glm::vec2> outline;
+
+    // coverage masks, one per distinct outline
+    std::vector<uint32_t> shape;      // per piece, index into masks
+    std::vector<CoverageMask> masks;
+
+    unsigned int count() const { return home.size(); }
+    unsigned int edges() const { return edgeTarget.size(); }
+    // the largest bounding box over all pieces
+    glm::vec2 maxPieceSize() const;
+    // whether the point (relative to the piece's home) is inside piece id: its bounding box, then its mask, then
+    // its outline when the point lands on a mask cell the outline crosses
+    bool contains(unsigned int id, glm::vec2 local) const;
+};
+
+// the same kind, size and seed always give the same cut
+void buildTopology(TopologyKind kind, unsigned int rows, unsigned int cols, uint64_t seed, PieceTopology& topology);
+
+#endif //PUZZLEGL_TOPOLOGY_H
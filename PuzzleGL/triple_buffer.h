@@ -0,0 +1,48 @@
+/*
+TRIPLE BUFFER
+
+Hands whole values from one writer thread to one reader thread without locks or copies. The writer fills the back
+slot and publishes it by swapping it with the middle one; the reader takes the middle slot whenever a newer one
+has been published. Neither side ever waits for the other: the writer can publish faster than the reader reads
+(it overwrites the unread middle) and the reader keeps its front slot for as long as it needs it.
+ */
+#ifndef PUZZLEGL_TRIPLE_BUFFER_H
+#define PUZZLEGL_TRIPLE_BUFFER_H
+
+#include <atomic>
+
+template<class T>
+class TripleBuffer {
+public:
+    TripleBuffer() : backIndex(0), frontIndex(2), middle(1) {}
+
+    // writer side: fill back(), then publish() it
+    T& back() { return slots[backIndex]; }
+    void publish() {
+        backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // reader side: take the latest published value if there is a newer one; true if front() changed
+    bool update() {
+        if (!(middle.load(std::memory_order_acquire) & FRESH)) {
+            return false;
+        }
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& front() const { return slots[frontIndex]; }
+
+private:
+    TripleBuffer(const TripleBuffer&);
+    TripleBuffer& operator=(const TripleBuffer&);
+
+    static const unsigned int INDEX = 3;
+    static const unsigned int FRESH = 4; // the middle slot has not been taken by the reader yet
+
+    T slots[3];
+    unsigned int backIndex;           // writer only
+    unsigned int frontIndex;          // reader only
+    std::atomic<unsigned int> middle; // slot index | FRESH
+};
+
+#endif //PUZZLEGL_TRIPLE_BUFFER_H
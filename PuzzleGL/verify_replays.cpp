@@ -0,0 +1,80 @@
+/*
+VERIFY_REPLAYS: checks leaderboard submissions by playing them back (see REPLAY)
+
+USAGE: verify_replays <levels.txt> <replay>... [-j threads]
+
+Reads every replay, plays them back on every core and prints each one's verdict with the time it verified, then how
+many replays and simulated ticks a second the batch went through. Exits non-zero if any replay was rejected.
+ */
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "job_system.h"
+#include "level_bundle.h"
+#include "replay.h"
+#include "simulation.h"
+
+namespace sc = std::chrono;
+
+int main(int argc, char** argv)
+{
+    std::vector<const char*> files;
+    unsigned int threads = 0;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (argc < 3 || files.empty()) {
+        std::cout << "USAGE: " << argv[0] << " <levels.txt> <replay>... [-j threads]" << std::endl;
+        return -1;
+    }
+    std::vector<LevelDesc> levels;
+    if (!readLevelManifest(argv[1], levels)) {
+        return -1;
+    }
+    if (threads != 0) {
+        startJobSystem(threads - 1);
+    }
+
+    auto start = sc::steady_clock::now();
+    std::vector<Replay> replays(files.size());
+    std::vector<char> read(files.size());
+    parallelFor("read replays", files.size(), 16, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            read[i] = readReplay(files[i], replays[i]);
+        }
+    });
+    auto loaded = sc::steady_clock::now();
+    std::vector<ReplayResult> results;
+    verifyReplays(replays, levels, results);
+    auto verified = sc::steady_clock::now();
+
+    unsigned int accepted = 0;
+    uint64_t ticks = 0, simulated = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!read[i]) {
+            results[i].verdict = REPLAY_MALFORMED;
+        }
+        std::cout << files[i] << ": " << replayVerdictName(results[i].verdict);
+        if (results[i].verdict == REPLAY_VERIFIED) {
+            std::cout << " in " << (double)results[i].ticks / SIM_TICK_HZ << "s (claimed "
+                      << replays[i].claimedSeconds << "s)";
+            accepted++;
+        }
+        std::cout << std::endl;
+        simulated += results[i].simulated;
+        ticks += replays[i].events.empty() ? 0 : replays[i].events.back().tick;
+    }
+    double seconds = sc::duration<double>(verified - loaded).count();
+    std::cout << accepted << " of " << files.size() << " verified in " << seconds << "s on " << jobConcurrency()
+              << " threads (read in " << sc::duration<double>(loaded - start).count() << "s)" << std::endl;
+    std::cout << "replays/s: " << files.size() / seconds << ", ticks stepped: " << simulated << " of " << ticks
+              << " played (" << simulated / seconds << "/s)" << std::endl;
+    return accepted == files.size() ? 0 : -1;
+}
@@ -0,0 +1,300 @@
+#include "virtual_texture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const char *virtualTextureFragmentShaderSource = "#version 330 core\n"
+    "in vec2 TexCoord;\n"
+    "out vec4 FragColor;\n"
+    "uniform sampler2D tileCache;\n"
+    "uniform usampler2DArray pageTable;\n"
+    "uniform vec2 virtualSize;\n"   // texels of mip 0
+    "uniform float maxLevel;\n"
+    "uniform float cacheSize;\n"
+    "uniform float highlight;\n"
+    "const float TILE_CONTENT = 254.0;\n"
+    "const float TILE_BORDER = 1.0;\n"
+    "const float SLOT_SIZE = 256.0;\n"
+    "vec2 levelTexel(vec2 texel, float level)\n"
+    "{\n"
+    "   vec2 levelSize = max(floor(virtualSize / exp2(level)), vec2(1.0));\n"
+    "   return clamp(texel / exp2(level), vec2(0.0), levelSize - 0.5);\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "   vec2 texel = TexCoord * virtualSize;\n"
+    "   vec2 dx = dFdx(texel);\n"
+    "   vec2 dy = dFdy(texel);\n"
+    "   float lod = clamp(floor(0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1.0))), 0.0, maxLevel);\n"
+    "   uvec4 entry = texelFetch(pageTable, ivec3(levelTexel(texel, lod) / TILE_CONTENT, int(lod)), 0);\n"
+    "   vec2 inTile = mod(levelTexel(texel, float(entry.z)), TILE_CONTENT);\n"
+    "   vec2 cacheTexel = vec2(entry.xy) * SLOT_SIZE + TILE_BORDER + inTile;\n"
+    "   FragColor = mix(texture(tileCache, cacheTexel / cacheSize), vec4(1.0, 0.85, 0.2, 1.0), highlight);\n"
+    "}\n\0";
+
+void MipChainTileSource::addOwnedMip(std::vector<unsigned char>& rgba){
+    owned.push_back(std::vector<unsigned char>());
+    owned.back().swap(rgba);
+    mips.push_back(&owned.back()[0]);
+}
+
+void MipChainTileSource::readTile(unsigned int level, unsigned int tx, unsigned int ty, unsigned char* dst){
+    unsigned int lw = mipSize(w, level);
+    int lh = mipSize(h, level);
+    int y0 = (int)ty * TILE_CONTENT - TILE_BORDER;
+    for (int y = 0; y < TILE_SLOT_SIZE; ++y) {
+        int sy = std::min(std::max(y0 + y, 0), lh - 1);
+        copyTileRow(mips[level] + (size_t)sy * lw * 4, lw, tx, dst + (size_t)y * TILE_SLOT_SIZE * 4);
+    }
+}
+
+const unsigned char* BundleTileSource::mapTile(unsigned int level, unsigned int tx, unsigned int ty){
+    return bundle.tileData(index, level, tx, ty);
+}
+
+void BundleTileSource::readTile(unsigned int level, unsigned int tx, unsigned int ty, unsigned char* dst){
+    memcpy(dst, bundle.tileData(index, level, tx, ty), TILE_BYTES);
+}
+
+bool readMipPicture(TileSource& source, unsigned int maxSize, std::vector<unsigned char>& rgba, unsigned int& width,
+                    unsigned int& height){
+    if (source.numMips() == 0) {
+        return false;
+    }
+    unsigned int level = 0;
+    while (level + 1 < source.numMips()
+           && (mipSize(source.width(), level) > maxSize || mipSize(source.height(), level) > maxSize)) {
+        ++level;
+    }
+    width = mipSize(source.width(), level);
+    height = mipSize(source.height(), level);
+    rgba.resize((size_t)width * height * 4);
+
+    // stitch the tiles' content back together, dropping their borders
+    std::vector<unsigned char> tile(TILE_BYTES);
+    for (unsigned int ty = 0; ty < tilesAcross(source.height(), level); ++ty) {
+        for (unsigned int tx = 0; tx < tilesAcross(source.width(), level); ++tx) {
+            const unsigned char* texels = source.mapTile(level, tx, ty);
+            if (texels == nullptr) {
+                source.readTile(level, tx, ty, &tile[0]);
+                texels = &tile[0];
+            }
+            unsigned int x0 = tx * TILE_CONTENT, y0 = ty * TILE_CONTENT;
+            unsigned int w = std::min((unsigned int)TILE_CONTENT, width - x0);
+            unsigned int h = std::min((unsigned int)TILE_CONTENT, height - y0);
+            for (unsigned int y = 0; y < h; ++y) {
+                memcpy(&rgba[((size_t)(y0 + y) * width + x0) * 4],
+                       texels + ((size_t)(y + TILE_BORDER) * TILE_SLOT_SIZE + TILE_BORDER) * 4, (size_t)w * 4);
+            }
+        }
+    }
+    return true;
+}
+
+VirtualTexture::VirtualTexture() : source(nullptr), numLevels(0), cacheTexture(0), pageTableTexture(0), frame(0),
+                                   pageTableDirty(true) {
+}
+
+uint64_t VirtualTexture::tileKey(unsigned int level, unsigned int tx, unsigned int ty){
+    return ((uint64_t)level << 48) | ((uint64_t)ty << 24) | tx;
+}
+
+bool VirtualTexture::create(TileSource* src){
+    source = src;
+    // stop at the first level that fits in a single tile; it is pinned so every page has a fallback
+    numLevels = std::min(source->numMips(), tiledMipCount(source->width(), source->height()));
+
+    slots.assign(VT_CACHE_SLOTS * VT_CACHE_SLOTS, Slot());
+    lru.clear();
+    resident.clear();
+    missing.clear();
+    for (int i = 0; i < (int)slots.size(); ++i) {
+        slots[i].key = ~(uint64_t)0;
+        slots[i].lastUsed = 0;
+        slots[i].pinned = false;
+        slots[i].lruPos = lru.insert(lru.end(), i);
+    }
+    staging.resize(TILE_BYTES);
+    pageTable.assign((size_t)tilesX(0) * tilesY(0) * numLevels * 4, 0);
+
+    glGenTextures(1, &cacheTexture);
+    glBindTexture(GL_TEXTURE_2D, cacheTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, VT_CACHE_SLOTS * TILE_SLOT_SIZE, VT_CACHE_SLOTS * TILE_SLOT_SIZE, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    glGenTextures(1, &pageTableTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, pageTableTexture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8UI, tilesX(0), tilesY(0), numLevels, 0,
+                 GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+
+    unsigned int coarsest = numLevels - 1;
+    for (unsigned int ty = 0; ty < tilesY(coarsest); ++ty) {
+        for (unsigned int tx = 0; tx < tilesX(coarsest); ++tx) {
+            loadTile(tileKey(coarsest, tx, ty), allocateSlot(), true);
+        }
+    }
+    pageTableDirty = true;
+    rebuildPageTable();
+    return true;
+}
+
+void VirtualTexture::destroy(){
+    if (cacheTexture) glDeleteTextures(1, &cacheTexture);
+    if (pageTableTexture) glDeleteTextures(1, &pageTableTexture);
+    cacheTexture = pageTableTexture = 0;
+    resident.clear();
+    missing.clear();
+    source = nullptr;
+}
+
+void VirtualTexture::beginFrame(){
+    ++frame;
+    missing.clear();
+}
+
+void VirtualTexture::touch(uint64_t key){
+    auto it = resident.find(key);
+    if (it == resident.end()) {
+        missing.push_back(key); // deduplicated in update()
+        return;
+    }
+    Slot& s = slots[it->second];
+    if (s.lastUsed != frame && !s.pinned) {
+        s.lastUsed = frame;
+        lru.splice(lru.begin(), lru, s.lruPos);
+    }
+}
+
+void VirtualTexture::request(float u0, float v0, float u1, float v1, float texelsPerPixel){
+    // same level selection as the fragment shader
+    float lod = std::floor(std::log2(std::max(texelsPerPixel, 1.0f)));
+    unsigned int level = (unsigned int)std::min(lod, (float)(numLevels - 1));
+    float lw = (float)mipSize(source->width(), level);
+    float lh = (float)mipSize(source->height(), level);
+    int tx0 = (int)(std::max(0.0f, std::min(u0, u1)) * lw) / TILE_CONTENT;
+    int tx1 = (int)(std::min(1.0f, std::max(u0, u1)) * lw) / TILE_CONTENT;
+    int ty0 = (int)(std::max(0.0f, std::min(v0, v1)) * lh) / TILE_CONTENT;
+    int ty1 = (int)(std::min(1.0f, std::max(v0, v1)) * lh) / TILE_CONTENT;
+    tx1 = std::min(tx1, (int)tilesX(level) - 1);
+    ty1 = std::min(ty1, (int)tilesY(level) - 1);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            touch(tileKey(level, tx, ty));
+        }
+    }
+}
+
+int VirtualTexture::allocateSlot(){
+    // the back of the list is the least recently used slot; anything touched this frame is still on screen
+    int slot = lru.back();
+    Slot& s = slots[slot];
+    if (s.pinned || (s.lastUsed == frame && s.key != ~(uint64_t)0)) {
+        return -1;
+    }
+    if (s.key != ~(uint64_t)0) {
+        resident.erase(s.key);
+        s.key = ~(uint64_t)0;
+        pageTableDirty = true;
+    }
+    return slot;
+}
+
+void VirtualTexture::loadTile(uint64_t key, int slot, bool pinned){
+    unsigned int level = (unsigned int)(key >> 48);
+    unsigned int ty = (unsigned int)(key >> 24) & 0xFFFFFF;
+    unsigned int tx = (unsigned int)key & 0xFFFFFF;
+    const unsigned char* texels = source->mapTile(level, tx, ty);
+    if (texels == nullptr) {
+        source->readTile(level, tx, ty, &staging[0]);
+        texels = &staging[0];
+    }
+
+    glBindTexture(GL_TEXTURE_2D, cacheTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % VT_CACHE_SLOTS) * TILE_SLOT_SIZE, (slot / VT_CACHE_SLOTS) * TILE_SLOT_SIZE,
+                    TILE_SLOT_SIZE, TILE_SLOT_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+
+    Slot& s = slots[slot];
+    s.key = key;
+    s.pinned = pinned;
+    s.lastUsed = frame;
+    if (pinned) {
+        lru.erase(s.lruPos); // never a candidate for eviction
+    } else {
+        lru.splice(lru.begin(), lru, s.lruPos);
+    }
+    resident[key] = slot;
+    pageTableDirty = true;
+}
+
+void VirtualTexture::update(){
+    // coarse tiles first: each one upgrades the fallback for a large area of the board
+    std::sort(missing.begin(), missing.end(), [](uint64_t a, uint64_t b) { return a > b; });
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    unsigned int uploads = 0;
+    for (auto key : missing) {
+        if (uploads == VT_UPLOADS_PER_FRAME || lru.empty()) {
+            break;
+        }
+        int slot = allocateSlot();
+        if (slot < 0) {
+            break; // every unpinned slot is on screen; keep using coarser tiles
+        }
+        loadTile(key, slot, false);
+        ++uploads;
+    }
+    rebuildPageTable();
+}
+
+void VirtualTexture::rebuildPageTable(){
+    if (!pageTableDirty) {
+        return;
+    }
+    pageTableDirty = false;
+    unsigned int stride = tilesX(0);
+    size_t layer = (size_t)tilesX(0) * tilesY(0) * 4;
+    // coarsest to finest: a page without its own tile inherits its parent's entry
+    for (int level = numLevels - 1; level >= 0; --level) {
+        for (unsigned int ty = 0; ty < tilesY(level); ++ty) {
+            for (unsigned int tx = 0; tx < tilesX(level); ++tx) {
+                unsigned char* e = &pageTable[level * layer + ((size_t)ty * stride + tx) * 4];
+                auto it = resident.find(tileKey(level, tx, ty));
+                if (it != resident.end()) {
+                    e[0] = (unsigned char)(it->second % VT_CACHE_SLOTS);
+                    e[1] = (unsigned char)(it->second / VT_CACHE_SLOTS);
+                    e[2] = (unsigned char)level;
+                    e[3] = 0;
+                } else {
+                    unsigned int px = std::min(tx / 2, tilesX(level + 1) - 1);
+                    unsigned int py = std::min(ty / 2, tilesY(level + 1) - 1);
+                    memcpy(e, &pageTable[(level + 1) * layer + ((size_t)py * stride + px) * 4], 4);
+                }
+            }
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, pageTableTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, tilesX(0), tilesY(0), numLevels,
+                    GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, &pageTable[0]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void VirtualTexture::bind(GLuint program){
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, cacheTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, pageTableTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "tileCache"), 0);
+    glUniform1i(glGetUniformLocation(program, "pageTable"), 1);
+    glUniform2f(glGetUniformLocation(program, "virtualSize"), (float)source->width(), (float)source->height());
+    glUniform1f(glGetUniformLocation(program, "maxLevel"), (float)(numLevels - 1));
+    glUniform1f(glGetUniformLocation(program, "cacheSize"), (float)(VT_CACHE_SLOTS * TILE_SLOT_SIZE));
+}
@@ -0,0 +1,130 @@
+/*
+VIRTUAL TEXTURE
+
+Puzzle pictures larger than a single GL texture (or too big to keep resident) are split into fixed-size tiles per
+mip level. Only the tiles that the pieces on screen need at the current level of detail are streamed into one
+fixed-size cache texture; a page table (one array layer per mip level) maps every page of the virtual image to the
+cache slot holding it, or to the closest coarser tile that is resident, so a missing tile never shows as a hole.
+The least recently used tiles are evicted when the cache is full; the coarsest level is pinned.
+ */
+#ifndef PUZZLEGL_VIRTUAL_TEXTURE_H
+#define PUZZLEGL_VIRTUAL_TEXTURE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "level_bundle.h"
+#include "tile_layout.h"
+
+const int VT_CACHE_SLOTS = 16;    // the cache texture holds VT_CACHE_SLOTS x VT_CACHE_SLOTS tiles (64MB of RGBA8)
+const int VT_UPLOADS_PER_FRAME = 8;
+
+extern const char *virtualTextureFragmentShaderSource;
+
+// where tiles come from; implementations fill one cache slot (border included) with RGBA8 texels
+class TileSource {
+public:
+    virtual ~TileSource() {}
+    virtual unsigned int width() const = 0; // size of mip 0
+    virtual unsigned int height() const = 0;
+    virtual unsigned int numMips() const = 0;
+    // sources that already hold finished tiles hand them out directly instead of copying them
+    virtual const unsigned char* mapTile(unsigned int /*level*/, unsigned int /*tx*/, unsigned int /*ty*/) {
+        return nullptr;
+    }
+    virtual void readTile(unsigned int level, unsigned int tx, unsigned int ty, unsigned char* dst) = 0;
+};
+
+// tiles stored pre-cut in a tiled level of a mapped bundle (written by the streaming ingest)
+class BundleTileSource : public TileSource {
+public:
+    BundleTileSource(const LevelBundle& bundle, unsigned int index) : bundle(bundle), index(index) {}
+
+    unsigned int width() const { return bundle.level(index).width; }
+    unsigned int height() const { return bundle.level(index).height; }
+    unsigned int numMips() const { return bundle.level(index).numMips; }
+    const unsigned char* mapTile(unsigned int level, unsigned int tx, unsigned int ty);
+    void readTile(unsigned int level, unsigned int tx, unsigned int ty, unsigned char* dst);
+
+private:
+    const LevelBundle& bundle;
+    unsigned int index;
+};
+
+// tiles cut on demand from a full RGBA8 mip chain, e.g. the mip blocks of a mapped level bundle
+class MipChainTileSource : public TileSource {
+public:
+    MipChainTileSource(unsigned int width, unsigned int height) : w(width), h(height) {}
+    void addMip(const unsigned char* rgba) { mips.push_back(rgba); }
+    // keeps the pixels alive for sources that were decoded rather than mapped
+    void addOwnedMip(std::vector<unsigned char>& rgba);
+
+    unsigned int width() const { return w; }
+    unsigned int height() const { return h; }
+    unsigned int numMips() const { return mips.size(); }
+    void readTile(unsigned int level, unsigned int tx, unsigned int ty, unsigned char* dst);
+
+private:
+    unsigned int w, h;
+    std::vector<const unsigned char*> mips;
+    std::list<std::vector<unsigned char> > owned;
+};
+
+// the finest mip no larger than maxSize on either side (or the coarsest one there is) as a single RGBA8 picture,
+// e.g. for analysing the picture on the CPU
+bool readMipPicture(TileSource& source, unsigned int maxSize, std::vector<unsigned char>& rgba, unsigned int& width,
+                    unsigned int& height);
+
+class VirtualTexture {
+public:
+    VirtualTexture();
+
+    // allocates the cache and page table textures; needs a current GL context
+    bool create(TileSource* source);
+    // releases the GL objects; call before the context goes away
+    void destroy();
+
+    // per frame: beginFrame, request() every visible uv rectangle, then update() before drawing
+    void beginFrame();
+    void request(float u0, float v0, float u1, float v1, float texelsPerPixel);
+    void update();
+    // binds the cache to texture unit 0 and the page table to unit 1 and sets the lookup uniforms
+    void bind(GLuint program);
+
+    unsigned int residentTiles() const { return resident.size(); }
+    unsigned int pendingTiles() const { return missing.size(); }
+
+private:
+    struct Slot {
+        uint64_t key;
+        unsigned int lastUsed;
+        bool pinned;
+        std::list<int>::iterator lruPos;
+    };
+
+    static uint64_t tileKey(unsigned int level, unsigned int tx, unsigned int ty);
+    unsigned int tilesX(unsigned int level) const { return tilesAcross(source->width(), level); }
+    unsigned int tilesY(unsigned int level) const { return tilesAcross(source->height(), level); }
+    void touch(uint64_t key);
+    int allocateSlot();
+    void loadTile(uint64_t key, int slot, bool pinned);
+    void rebuildPageTable();
+
+    TileSource* source;
+    unsigned int numLevels;
+    GLuint cacheTexture, pageTableTexture;
+    unsigned int frame;
+    bool pageTableDirty;
+
+    std::vector<Slot> slots;
+    std::list<int> lru; // most recently used slot first
+    std::unordered_map<uint64_t, int> resident;
+    std::vector<uint64_t> missing;
+    std::vector<unsigned char> staging;
+    std::vector<unsigned char> pageTable; // RGBA8UI: slot x, slot y, resident level, unused
+};
+
+#endif //PUZZLEGL_VIRTUAL_TEXTURE_H